@@ -0,0 +1,61 @@
+#ifndef JAGCE_ROM_INDEX
+#define JAGCE_ROM_INDEX
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace jagce {
+
+	constexpr size_t ROM_BANK_SIZE = 0x4000;
+	constexpr uint32_t ROM_INDEX_MAGIC = 0x58444E49; // "INDX"
+	constexpr uint16_t ROM_INDEX_VERSION = 1;
+
+	// A run of code bytes, at the address it has when its bank is mapped
+	struct CodeRegion {
+		uint16_t start;
+		uint16_t length;
+
+		bool operator==(const CodeRegion& other) const { return start == other.start && length == other.length; }
+	};
+
+	// Everything outside the code regions of a bank is data, or code nothing reaches
+	struct BankIndex {
+		std::vector<CodeRegion> code;
+		// Addresses basic blocks start at, ascending
+		std::vector<uint16_t> blockStarts;
+
+		bool operator==(const BankIndex& other) const { return code == other.code && blockStarts == other.blockStarts; }
+	};
+
+	/**
+	 * Code regions and basic block starts of every 16 KiB bank of a ROM. Bank 0 sits at
+	 * 0x0000 and every other bank at 0x4000, where it is switched in.
+	 *
+	 * The binary form is little-endian: magic, version, a reserved half word and the bank
+	 * count, then for each bank its region and block counts, its regions as start and
+	 * length, and its block starts.
+	 */
+	struct RomIndex {
+		std::vector<BankIndex> banks;
+
+		void write(std::vector<uint8_t>& out) const;
+		// Throws std::invalid_argument when the data isn't a whole index
+		static RomIndex read(uint8_t const * data, size_t size);
+
+		bool operator==(const RomIndex& other) const { return banks == other.banks; }
+	};
+
+	/**
+	 * Finds the code of a ROM by following control flow from the restart and interrupt
+	 * vectors and the entry point, with instruction lengths from INSTRUCTION_LENGTHS.
+	 * Each bank is traced on its own thread, in rounds: branches from bank 0 into
+	 * 0x4000-0x7FFF could go to any switchable bank, so they are traced in all of them,
+	 * and branches from a switchable bank into bank 0 are traced there in the next round.
+	 * Indirect jumps through HL end a path. Zero threads uses one per hardware thread.
+	 */
+	RomIndex indexRom(uint8_t const * rom, size_t size, size_t threads = 0);
+
+}
+
+#endif
@@ -0,0 +1,294 @@
+#include "rom_index.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+#include "opcode_info.hpp"
+
+namespace jagce {
+
+	namespace {
+
+		constexpr uint8_t CODE = 0x01;
+		constexpr uint8_t INSTRUCTION_START = 0x02;
+		constexpr uint8_t BLOCK_START = 0x04;
+
+		constexpr uint16_t SWITCHABLE_BANK = 0x4000;
+		constexpr uint16_t ROM_END = 0x8000;
+
+		// The restart and interrupt vectors and the cartridge entry point
+		constexpr uint16_t ENTRY_POINTS[] = {
+			0x00, 0x08, 0x10, 0x18, 0x20, 0x28, 0x30, 0x38,
+			0x40, 0x48, 0x50, 0x58, 0x60, 0x100
+		};
+
+		struct Bank {
+			uint8_t const * bytes;
+			size_t size;
+			uint16_t base;
+			// CODE, INSTRUCTION_START and BLOCK_START of every byte
+			std::vector<uint8_t> marks;
+			std::vector<uint16_t> seeds;
+			// Branches out of the bank found by the last trace
+			std::vector<uint16_t> exits;
+		};
+
+		uint16_t read16(uint8_t const * bytes) {
+			return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+		}
+
+		// Where a branch goes, false for instructions that don't branch to a fixed address
+		bool branchTarget(uint8_t const * instruction, uint16_t address, uint16_t& target) {
+			const uint8_t opcode = instruction[0];
+			switch (opcode) {
+				case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+					target = static_cast<uint16_t>(address + 2 + static_cast<int8_t>(instruction[1]));
+					return true;
+				case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA:
+				case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC:
+					target = read16(instruction + 1);
+					return true;
+				case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+					target = opcode & 0x38;
+					return true;
+				default:
+					return false;
+			}
+		}
+
+		bool inBank(const Bank& bank, uint16_t address) {
+			return address >= bank.base && static_cast<size_t>(address - bank.base) < bank.size;
+		}
+
+		// Follows every path from the bank's seeds, leaving branches to other banks in exits
+		void trace(Bank& bank) {
+			std::vector<uint16_t> pending{};
+			pending.swap(bank.seeds);
+			bank.exits.clear();
+
+			while (!pending.empty()) {
+				uint16_t address = pending.back();
+				pending.pop_back();
+				bool blockStart = true;
+
+				while (inBank(bank, address)) {
+					const size_t offset = address - bank.base;
+					uint8_t& mark = bank.marks[offset];
+					if (mark & INSTRUCTION_START) {
+						mark |= blockStart ? BLOCK_START : 0;
+						break;
+					}
+					// Overlapping another instruction, or an opcode the CPU doesn't have
+					const uint8_t opcode = bank.bytes[offset];
+					const size_t length = INSTRUCTION_LENGTHS[opcode];
+					if (isIllegalOpcode(opcode) || offset + length > bank.size
+							|| std::any_of(&bank.marks[offset], &bank.marks[offset] + length, [](uint8_t m) { return m & CODE; })) {
+						break;
+					}
+
+					mark |= INSTRUCTION_START | (blockStart ? BLOCK_START : 0);
+					for (size_t i = 0; i < length; i++) {
+						bank.marks[offset + i] |= CODE;
+					}
+
+					uint16_t target = 0;
+					if (branchTarget(bank.bytes + offset, address, target)) {
+						(inBank(bank, target) ? pending : bank.exits).push_back(target);
+					}
+					if (isUnconditionalTransfer(opcode)) {
+						break;
+					}
+					blockStart = endsBasicBlock(opcode);
+					address = static_cast<uint16_t>(address + length);
+				}
+			}
+		}
+
+		template <typename Function>
+		void forEachInParallel(std::vector<Bank*>& banks, size_t threads, Function function) {
+			std::atomic<size_t> next{0};
+			const auto work = [&banks, &next, &function] {
+				for (size_t i = next++; i < banks.size(); i = next++) {
+					function(*banks[i]);
+				}
+			};
+
+			std::vector<std::thread> workers{};
+			for (size_t i = 1; i < std::min(threads, banks.size()); i++) {
+				workers.emplace_back(work);
+			}
+			work();
+			for (std::thread& worker : workers) {
+				worker.join();
+			}
+		}
+
+		BankIndex toIndex(const Bank& bank) {
+			BankIndex index{};
+			for (size_t offset = 0; offset < bank.size; offset++) {
+				const uint8_t mark = bank.marks[offset];
+				if (mark & BLOCK_START) {
+					index.blockStarts.push_back(static_cast<uint16_t>(bank.base + offset));
+				}
+				if (!(mark & CODE)) {
+					continue;
+				}
+				const uint16_t address = static_cast<uint16_t>(bank.base + offset);
+				if (!index.code.empty() && index.code.back().start + index.code.back().length == address) {
+					index.code.back().length++;
+				} else {
+					index.code.push_back({address, 1});
+				}
+			}
+			return index;
+		}
+
+		void put16(std::vector<uint8_t>& out, uint16_t value) {
+			out.push_back(static_cast<uint8_t>(value));
+			out.push_back(static_cast<uint8_t>(value >> 8));
+		}
+
+		void put32(std::vector<uint8_t>& out, uint32_t value) {
+			put16(out, static_cast<uint16_t>(value));
+			put16(out, static_cast<uint16_t>(value >> 16));
+		}
+
+		class Reader {
+		public:
+			Reader(uint8_t const * data, size_t size) : data{data}, size{size}, position{0} {}
+
+			uint16_t get16() {
+				need(2);
+				const uint16_t value = read16(data + position);
+				position += 2;
+				return value;
+			}
+
+			uint32_t get32() {
+				const uint16_t low = get16();
+				return low | (static_cast<uint32_t>(get16()) << 16);
+			}
+
+			// Checks count items of itemSize bytes remain before anything is allocated for them
+			void need(size_t count, size_t itemSize = 1) {
+				if (count > (size - position) / itemSize) {
+					throw std::invalid_argument("ROM index is truncated");
+				}
+			}
+
+			bool done() const { return position == size; }
+
+		private:
+			uint8_t const * data;
+			size_t size;
+			size_t position;
+		};
+
+	}
+
+	void RomIndex::write(std::vector<uint8_t>& out) const {
+		put32(out, ROM_INDEX_MAGIC);
+		put16(out, ROM_INDEX_VERSION);
+		put16(out, 0);
+		put32(out, static_cast<uint32_t>(banks.size()));
+		for (const BankIndex& bank : banks) {
+			put32(out, static_cast<uint32_t>(bank.code.size()));
+			put32(out, static_cast<uint32_t>(bank.blockStarts.size()));
+			for (const CodeRegion& region : bank.code) {
+				put16(out, region.start);
+				put16(out, region.length);
+			}
+			for (uint16_t start : bank.blockStarts) {
+				put16(out, start);
+			}
+		}
+	}
+
+	RomIndex RomIndex::read(uint8_t const * data, size_t size) {
+		Reader in{data, size};
+		if (in.get32() != ROM_INDEX_MAGIC) {
+			throw std::invalid_argument("Not a ROM index");
+		}
+		if (in.get16() != ROM_INDEX_VERSION) {
+			throw std::invalid_argument("Unsupported ROM index version");
+		}
+		in.get16();
+
+		RomIndex index{};
+		const uint32_t bankCount = in.get32();
+		// Every bank has at least its two counts
+		in.need(bankCount, 8);
+		index.banks.resize(bankCount);
+		for (BankIndex& bank : index.banks) {
+			const uint32_t regions = in.get32();
+			const uint32_t blocks = in.get32();
+			in.need(regions, 4);
+			bank.code.reserve(regions);
+			for (uint32_t i = 0; i < regions; i++) {
+				const uint16_t start = in.get16();
+				bank.code.push_back({start, in.get16()});
+			}
+			in.need(blocks, 2);
+			bank.blockStarts.reserve(blocks);
+			for (uint32_t i = 0; i < blocks; i++) {
+				bank.blockStarts.push_back(in.get16());
+			}
+		}
+		if (!in.done()) {
+			throw std::invalid_argument("ROM index has trailing bytes");
+		}
+		return index;
+	}
+
+	RomIndex indexRom(uint8_t const * rom, size_t size, size_t threads) {
+		if (threads == 0) {
+			threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+		}
+
+		std::vector<Bank> banks((size + ROM_BANK_SIZE - 1) / ROM_BANK_SIZE);
+		for (size_t i = 0; i < banks.size(); i++) {
+			Bank& bank = banks[i];
+			bank.bytes = rom + i * ROM_BANK_SIZE;
+			bank.size = std::min(ROM_BANK_SIZE, size - i * ROM_BANK_SIZE);
+			bank.base = i == 0 ? 0 : SWITCHABLE_BANK;
+			bank.marks.resize(bank.size);
+		}
+		if (!banks.empty()) {
+			banks[0].seeds.assign(std::begin(ENTRY_POINTS), std::end(ENTRY_POINTS));
+		}
+
+		while (true) {
+			std::vector<Bank*> seeded{};
+			for (Bank& bank : banks) {
+				if (!bank.seeds.empty()) {
+					seeded.push_back(&bank);
+				}
+			}
+			if (seeded.empty()) {
+				break;
+			}
+			forEachInParallel(seeded, threads, trace);
+
+			for (Bank* bank : seeded) {
+				for (uint16_t target : bank->exits) {
+					if (target < SWITCHABLE_BANK) {
+						banks[0].seeds.push_back(target);
+					} else if (target < ROM_END && bank == &banks[0]) {
+						for (size_t i = 1; i < banks.size(); i++) {
+							banks[i].seeds.push_back(target);
+						}
+					}
+				}
+			}
+		}
+
+		RomIndex index{};
+		for (const Bank& bank : banks) {
+			index.banks.push_back(toIndex(bank));
+		}
+		return index;
+	}
+
+}
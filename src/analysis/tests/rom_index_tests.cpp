@@ -0,0 +1,91 @@
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include "rom_index.hpp"
+
+namespace {
+
+	void put(std::vector<uint8_t>& rom, size_t offset, const std::vector<uint8_t>& bytes) {
+		std::copy(bytes.begin(), bytes.end(), rom.begin() + offset);
+	}
+
+	// Three banks of code calling between bank 0 and bank 1, with bank 2 all data
+	std::vector<uint8_t> makeRom() {
+		std::vector<uint8_t> rom(3 * jagce::ROM_BANK_SIZE, 0xD3);
+		for (size_t vector = 0; vector <= 0x60; vector += 8) {
+			rom[vector] = 0xC9;
+		}
+		// NOP; JP 0x150
+		put(rom, 0x100, { 0x00, 0xC3, 0x50, 0x01 });
+		// LD A,1; CALL 0x4000; JR NZ,+2; JR -2; RET
+		put(rom, 0x150, { 0x3E, 0x01, 0xCD, 0x00, 0x40, 0x20, 0x02, 0x18, 0xFE, 0xC9 });
+		// XOR A; RET
+		put(rom, 0x200, { 0xAF, 0xC9 });
+		// Bank 1: LD B,2; CALL 0x200; RET
+		put(rom, jagce::ROM_BANK_SIZE, { 0x06, 0x02, 0xCD, 0x00, 0x02, 0xC9 });
+		return rom;
+	}
+
+}
+
+TEST_CASE("ROM index follows control flow across banks", "[analysis], [rom_index]") {
+	const std::vector<uint8_t> rom = makeRom();
+	const jagce::RomIndex index = jagce::indexRom(rom.data(), rom.size(), GENERATE(1, 4));
+	REQUIRE(index.banks.size() == 3);
+
+	const jagce::BankIndex& bank0 = index.banks[0];
+	CHECK(bank0.code.size() == 13 + 3);
+	CHECK(bank0.code.at(13) == jagce::CodeRegion{0x100, 4});
+	CHECK(bank0.code.at(14) == jagce::CodeRegion{0x150, 10});
+	CHECK(bank0.code.at(15) == jagce::CodeRegion{0x200, 2});
+	const std::vector<uint16_t> afterVectors(bank0.blockStarts.begin() + 13, bank0.blockStarts.end());
+	CHECK(afterVectors == std::vector<uint16_t>{ 0x100, 0x150, 0x155, 0x157, 0x159, 0x200 });
+
+	CHECK(index.banks[1].code == std::vector<jagce::CodeRegion>{ {0x4000, 6} });
+	CHECK(index.banks[1].blockStarts == std::vector<uint16_t>{ 0x4000, 0x4005 });
+
+	// The call from bank 0 could land in bank 2, which has no instruction there
+	CHECK(index.banks[2].code.empty());
+	CHECK(index.banks[2].blockStarts.empty());
+}
+
+TEST_CASE("ROM index handles ROMs that end mid-bank", "[analysis], [rom_index]") {
+	// JP 0x104 at the entry point, running off the end of the ROM
+	std::vector<uint8_t> rom(0x106, 0xD3);
+	rom[0x100] = 0xC3;
+	rom[0x101] = 0x04;
+	rom[0x102] = 0x01;
+	rom[0x104] = 0x01;
+	rom[0x105] = 0x34;
+
+	const jagce::RomIndex index = jagce::indexRom(rom.data(), rom.size(), 1);
+	REQUIRE(index.banks.size() == 1);
+	CHECK(index.banks[0].code == std::vector<jagce::CodeRegion>{ {0x100, 3} });
+}
+
+TEST_CASE("ROM index round trips through its binary form", "[analysis], [rom_index]") {
+	const std::vector<uint8_t> rom = makeRom();
+	const jagce::RomIndex index = jagce::indexRom(rom.data(), rom.size(), 2);
+
+	std::vector<uint8_t> bytes{};
+	index.write(bytes);
+	CHECK(jagce::RomIndex::read(bytes.data(), bytes.size()) == index);
+
+	SECTION("truncated indexes are rejected") {
+		CHECK_THROWS_AS(jagce::RomIndex::read(bytes.data(), bytes.size() - 1), std::invalid_argument);
+		CHECK_THROWS_AS(jagce::RomIndex::read(bytes.data(), 6), std::invalid_argument);
+	}
+
+	SECTION("other files are rejected") {
+		bytes[0] ^= 0xFF;
+		CHECK_THROWS_AS(jagce::RomIndex::read(bytes.data(), bytes.size()), std::invalid_argument);
+	}
+
+	SECTION("huge counts are rejected before allocating") {
+		bytes[8] = 0xFF;
+		bytes[9] = 0xFF;
+		bytes[10] = 0xFF;
+		CHECK_THROWS_AS(jagce::RomIndex::read(bytes.data(), bytes.size()), std::invalid_argument);
+	}
+}
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "byte_cursor.hpp"
+#include "decoder.hpp"
+#include "mapped_rom.hpp"
+#include "micro_op.hpp"
+#include "opcode_info.hpp"
+#include "rom_index.hpp"
+
+namespace {
+
+	const char* const KIND_NAMES[] = {
+		"DEC8", "INC8", "CP8", "XOR8", "OR8", "AND8", "SUB8", "ADD8", "PUSH", "POP",
+		"SHIFT", "LD8", "LD16", "NOP", "ADD_HL", "ADD_SP", "INC16", "DEC16"
+	};
+
+	void usage() {
+		std::cerr << "Usage: romindex [--threads N] [--list] ROM [INDEX]\n"
+			<< "Finds the code of a ROM, prints a summary of each bank and writes the index to INDEX.\n"
+			<< "  --threads N  trace banks on N threads, by default one per hardware thread\n"
+			<< "  --list       print every basic block with its decoded instructions\n";
+	}
+
+	// Decodes a block up to the end of its code region
+	void listBlock(const jagce::Decoder& decoder, uint8_t const * bank, size_t bankSize, uint16_t base,
+			uint16_t start, uint16_t end) {
+		std::cout << std::hex;
+		for (size_t offset = start - base; offset < end - base && offset < bankSize;) {
+			const size_t length = jagce::INSTRUCTION_LENGTHS[bank[offset]];
+			if (offset + length > bankSize || jagce::isIllegalOpcode(bank[offset])) {
+				break;
+			}
+			jagce::ByteCursor cursor{bank + offset, length};
+			const jagce::MicroOp op = decoder.decodeMicroOp(cursor);
+
+			std::cout << "  " << std::setw(4) << base + offset << "  ";
+			for (size_t i = 0; i < jagce::MAX_INSTRUCTION_LENGTH; i++) {
+				if (i < length) {
+					std::cout << std::setw(2) << static_cast<unsigned>(bank[offset + i]) << ' ';
+				} else {
+					std::cout << "   ";
+				}
+			}
+			std::cout << ' ' << KIND_NAMES[static_cast<size_t>(op.kind)] << '\n';
+
+			if (jagce::endsBasicBlock(bank[offset])) {
+				break;
+			}
+			offset += length;
+		}
+		std::cout << std::dec;
+	}
+
+}
+
+int main(int argc, char** argv) {
+	size_t threads = 0;
+	bool list = false;
+	std::vector<std::string> paths{};
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threads = std::strtoul(argv[++i], nullptr, 10);
+		} else if (std::strcmp(argv[i], "--list") == 0) {
+			list = true;
+		} else if (argv[i][0] == '-') {
+			usage();
+			return 2;
+		} else {
+			paths.push_back(argv[i]);
+		}
+	}
+	if (paths.empty() || paths.size() > 2) {
+		usage();
+		return 2;
+	}
+
+	std::cout << std::setfill('0');
+	try {
+		const auto rom = jagce::MappedFile::open(paths[0]);
+		const jagce::RomIndex index = jagce::indexRom(rom->data(), rom->size(), threads);
+		const jagce::Decoder decoder{};
+
+		for (size_t bank = 0; bank < index.banks.size(); bank++) {
+			const jagce::BankIndex& bankIndex = index.banks[bank];
+			size_t codeBytes = 0;
+			for (const jagce::CodeRegion& region : bankIndex.code) {
+				codeBytes += region.length;
+			}
+			std::cout << "bank " << bank << ": " << codeBytes << " code bytes in " << bankIndex.code.size()
+				<< " regions, " << bankIndex.blockStarts.size() << " blocks\n";
+
+			if (!list) {
+				continue;
+			}
+			uint8_t const * bytes = rom->data() + bank * jagce::ROM_BANK_SIZE;
+			const size_t bankSize = std::min(jagce::ROM_BANK_SIZE, rom->size() - bank * jagce::ROM_BANK_SIZE);
+			const uint16_t base = bank == 0 ? 0x0000 : 0x4000;
+			for (uint16_t start : bankIndex.blockStarts) {
+				// The region holding the block bounds it
+				uint16_t end = start;
+				for (const jagce::CodeRegion& region : bankIndex.code) {
+					if (region.start <= start && start < region.start + region.length) {
+						end = static_cast<uint16_t>(region.start + region.length);
+					}
+				}
+				std::cout << std::hex << " block " << std::setw(2) << bank << ':' << std::setw(4) << start << std::dec << '\n';
+				listBlock(decoder, bytes, bankSize, base, start, end);
+			}
+		}
+
+		if (paths.size() == 2) {
+			std::vector<uint8_t> out{};
+			index.write(out);
+			std::ofstream file{paths[1], std::ios::binary};
+			file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+			if (!file) {
+				std::cerr << "Could not write " << paths[1] << '\n';
+				return 1;
+			}
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,34 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "batch_runner.hpp"
+
+namespace {
+
+	// Register arithmetic that the idle loop detector leaves alone, falling through
+	// the whole of memory below the I/O page
+	void load(jagce::Machine& machine, size_t index) {
+		const std::vector<uint8_t> code{ 0x06, static_cast<uint8_t>(index), 0x80, 0x0C, 0xA9, 0x04, 0x13 };
+		for (size_t address = 0; address + code.size() < 0xFF00; address += code.size()) {
+			machine.getMemory().writeBytes(address, code.data(), code.size());
+		}
+		machine.getMemory().writeByte(jagce::Lcd::LCDC, 0x91);
+	}
+
+}
+
+static void BM_BatchRunFrame(benchmark::State& state) {
+	constexpr size_t INSTANCES = 256;
+	jagce::BatchRunner runner{INSTANCES, static_cast<size_t>(state.range(0))};
+	for (size_t i = 0; i < INSTANCES; i++) {
+		load(runner.instance(i), i);
+	}
+
+	for (auto _ : state) {
+		runner.runFrames(1);
+	}
+	state.SetItemsProcessed(state.iterations() * INSTANCES);
+	state.counters["steals"] = static_cast<double>(runner.getSteals());
+}
+BENCHMARK(BM_BatchRunFrame)->RangeMultiplier(2)->Range(1, 16)->UseRealTime()->Unit(benchmark::kMillisecond);
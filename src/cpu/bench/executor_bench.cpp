@@ -0,0 +1,147 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "executor.hpp"
+#include "memory_bus.hpp"
+#include "static_ram.hpp"
+
+namespace {
+
+	constexpr size_t INSTRUCTIONS_PER_BATCH = 4096;
+
+	// Random instructions from the main opcode page, decoded once up front
+	std::vector<jagce::DecodedInstruction> makeInstructions() {
+		std::mt19937 rng{0x5EED};
+		std::uniform_int_distribution<int> byteDistribution{0x00, 0xFF};
+		jagce::Decoder decoder{};
+
+		std::vector<jagce::DecodedInstruction> instructions{};
+		for (size_t i = 0; i < INSTRUCTIONS_PER_BATCH; i++) {
+			uint8_t bytes[3];
+			for (uint8_t& byte : bytes) {
+				byte = static_cast<uint8_t>(byteDistribution(rng));
+			}
+			if (bytes[0] == 0xCB || bytes[0] == 0xDD || bytes[0] == 0xED || bytes[0] == 0xFD) {
+				bytes[0] = 0x00;
+			}
+
+			jagce::ByteCursor in{bytes, sizeof(bytes)};
+			const jagce::Event event = decoder.decodeEvent(in);
+			instructions.push_back({event, jagce::toMicroOp(event), 0, bytes[0], static_cast<uint8_t>(in.position())});
+		}
+		return instructions;
+	}
+
+}
+
+template <typename Memory>
+static void BM_ExecuteMicroOp(benchmark::State& state) {
+	const std::vector<jagce::DecodedInstruction> instructions = makeInstructions();
+	auto ram = std::make_unique<jagce::StaticRAM<0x10000>>();
+	jagce::Registers registers{};
+	jagce::BasicExecutor<Memory> executor{registers, *ram};
+	int64_t executed = 0;
+
+	for (auto _ : state) {
+		for (const jagce::DecodedInstruction& instruction : instructions) {
+			executor.execute(instruction.op);
+			benchmark::DoNotOptimize(registers);
+		}
+		executed += instructions.size();
+	}
+	state.SetItemsProcessed(executed);
+}
+BENCHMARK_TEMPLATE(BM_ExecuteMicroOp, jagce::RandomAccessMemory);
+BENCHMARK_TEMPLATE(BM_ExecuteMicroOp, jagce::StaticRAM<0x10000>);
+
+static void BM_ExecuteMicroOpBus(benchmark::State& state) {
+	const std::vector<jagce::DecodedInstruction> instructions = makeInstructions();
+	std::vector<uint8_t> ram(0x10000);
+	jagce::MemoryBus bus{};
+	bus.map(0x0000, ram.size(), ram.data());
+	jagce::Registers registers{};
+	jagce::BasicExecutor<jagce::MemoryBus> executor{registers, bus};
+	int64_t executed = 0;
+
+	for (auto _ : state) {
+		for (const jagce::DecodedInstruction& instruction : instructions) {
+			executor.execute(instruction.op);
+			benchmark::DoNotOptimize(registers);
+		}
+		executed += instructions.size();
+	}
+	state.SetItemsProcessed(executed);
+}
+BENCHMARK(BM_ExecuteMicroOpBus);
+
+static void BM_ExecuteEvent(benchmark::State& state) {
+	const std::vector<jagce::DecodedInstruction> instructions = makeInstructions();
+	jagce::StaticRAM<0x10000> memory{};
+	jagce::Registers registers{};
+	jagce::Executor executor{registers, memory};
+	int64_t executed = 0;
+
+	for (auto _ : state) {
+		for (const jagce::DecodedInstruction& instruction : instructions) {
+			executor.execute(instruction.event);
+			benchmark::DoNotOptimize(registers);
+		}
+		executed += instructions.size();
+	}
+	state.SetItemsProcessed(executed);
+}
+BENCHMARK(BM_ExecuteEvent);
+
+// Argument is the Dispatch of run
+static void BM_RunBlock(benchmark::State& state) {
+	const jagce::Dispatch dispatch = static_cast<jagce::Dispatch>(state.range(0));
+	if (dispatch == jagce::Dispatch::COMPUTED_GOTO && !jagce::computedGotoSupported) {
+		state.SkipWithError("Computed goto is not supported");
+		return;
+	}
+	jagce::StaticRAM<0x10000> memory{};
+	jagce::Registers registers{};
+	jagce::Executor executor{registers, memory};
+	executor.setDispatch(dispatch);
+	const jagce::DecodedBlock block{0, INSTRUCTIONS_PER_BATCH, makeInstructions()};
+	int64_t executed = 0;
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(executor.run(block));
+		executed += block.instructions.size();
+	}
+	state.SetItemsProcessed(executed);
+}
+BENCHMARK(BM_RunBlock)
+	->Arg(static_cast<int>(jagce::Dispatch::TABLE))
+	->Arg(static_cast<int>(jagce::Dispatch::TAIL_CALL))
+	->Arg(static_cast<int>(jagce::Dispatch::COMPUTED_GOTO));
+
+// Argument is whether fusion is on, over an unrolled 16 byte copy as used for VRAM uploads
+static void BM_RunUnrolledCopy(benchmark::State& state) {
+	auto ram = std::make_unique<jagce::StaticRAM<0x10000>>();
+	std::vector<uint8_t> code{};
+	for (size_t i = 0; i < 16; i++) {
+		// LD A,(HL+); LD (DE),A; INC DE
+		code.insert(code.end(), { 0x2A, 0x12, 0x13 });
+	}
+	code.push_back(0xC9);
+	ram->writeBytes(0x100, code.data(), code.size());
+	jagce::WatchedMemory memory{*ram};
+	jagce::BlockCache cache{memory};
+	jagce::Registers registers{};
+	jagce::Executor executor{registers, memory};
+	executor.setFusion(state.range(0) != 0);
+	const jagce::DecodedBlock& block = cache.getBlock(0x100);
+
+	for (auto _ : state) {
+		registers.set16(jagce::RegisterNames::HL.getId(), 0xC000);
+		registers.set16(jagce::RegisterNames::DE.getId(), 0x8000);
+		benchmark::DoNotOptimize(executor.run(block));
+	}
+	state.SetItemsProcessed(state.iterations() * block.instructions.size());
+}
+BENCHMARK(BM_RunUnrolledCopy)->Arg(0)->Arg(1);
@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "jit.hpp"
+#include "static_ram.hpp"
+
+namespace {
+
+	// Register arithmetic of the kind hot loops are made of, ending in JR
+	const std::vector<uint8_t> CODE{
+		0x3E, 0x12, 0x06, 0x34, 0x80, 0x0C, 0xA9, 0xB0, 0x03, 0x23, 0x09, 0xD6, 0x05,
+		0x47, 0x88, 0x15, 0x1C, 0xFE, 0x40, 0xAB, 0x13, 0x29, 0x3D, 0x4F, 0x18, 0xE6
+	};
+
+	struct Machine {
+		std::unique_ptr<jagce::StaticRAM<0x10000>> ram = std::make_unique<jagce::StaticRAM<0x10000>>();
+		jagce::WatchedMemory memory{*ram};
+		jagce::BlockCache cache{memory};
+		jagce::Registers registers{};
+
+		Machine() {
+			ram->writeBytes(0x100, CODE.data(), CODE.size());
+		}
+	};
+
+}
+
+static void BM_InterpretBlock(benchmark::State& state) {
+	Machine machine{};
+	jagce::Executor executor{machine.registers, machine.memory};
+	executor.setDispatch(jagce::threadedDispatch);
+	const jagce::DecodedBlock& block = machine.cache.getBlock(0x100);
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(executor.run(block));
+	}
+	state.SetItemsProcessed(state.iterations() * block.instructions.size());
+}
+BENCHMARK(BM_InterpretBlock);
+
+static void BM_JitBlock(benchmark::State& state) {
+	Machine machine{};
+	jagce::Jit jit{machine.registers, machine.memory, machine.cache, 0};
+	const size_t instructions = machine.cache.getBlock(0x100).instructions.size();
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(jit.run(0x100));
+	}
+	state.SetItemsProcessed(state.iterations() * instructions);
+}
+BENCHMARK(BM_JitBlock);
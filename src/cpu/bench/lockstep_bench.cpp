@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "lockstep.hpp"
+#include "static_ram.hpp"
+
+namespace {
+
+	constexpr size_t LANES = 32;
+
+	// Register arithmetic of the kind hot loops are made of, ending in JR
+	const std::vector<uint8_t> CODE{
+		0x3E, 0x12, 0x06, 0x34, 0x80, 0x0C, 0xA9, 0xB0, 0xD6, 0x05, 0x47, 0x88, 0x1C,
+		0xFE, 0x40, 0xAB, 0x3D, 0x4F, 0x91, 0xE6, 0x7F, 0x2C, 0x85, 0x9A, 0x18, 0xE6
+	};
+
+	struct Instances {
+		std::vector<std::unique_ptr<jagce::StaticRAM<0x10000>>> rams;
+		std::vector<jagce::RandomAccessMemory*> memories;
+
+		Instances() {
+			for (size_t lane = 0; lane < LANES; lane++) {
+				rams.push_back(std::make_unique<jagce::StaticRAM<0x10000>>());
+				rams.back()->writeBytes(0x100, CODE.data(), CODE.size());
+				memories.push_back(rams.back().get());
+			}
+		}
+	};
+
+}
+
+static void BM_ScalarInstances(benchmark::State& state) {
+	Instances instances{};
+	jagce::WatchedMemory shared{*instances.rams[0]};
+	jagce::BlockCache cache{shared};
+	const jagce::DecodedBlock& block = cache.getBlock(0x100);
+
+	std::vector<jagce::Registers> registers(LANES);
+	std::vector<std::unique_ptr<jagce::Executor>> executors{};
+	for (size_t lane = 0; lane < LANES; lane++) {
+		executors.push_back(std::make_unique<jagce::Executor>(registers[lane], *instances.memories[lane]));
+	}
+
+	for (auto _ : state) {
+		for (auto& executor : executors) {
+			benchmark::DoNotOptimize(executor->run(block));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * LANES * block.instructions.size());
+}
+BENCHMARK(BM_ScalarInstances);
+
+static void BM_LockstepInstances(benchmark::State& state) {
+	Instances instances{};
+	jagce::WatchedMemory shared{*instances.rams[0]};
+	jagce::BlockCache cache{shared};
+	const jagce::DecodedBlock& block = cache.getBlock(0x100);
+	jagce::LockstepExecutor<LANES> lockstep{instances.memories};
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(lockstep.run(block, jagce::LockstepExecutor<LANES>::ALL_LANES));
+	}
+	state.SetItemsProcessed(state.iterations() * LANES * block.instructions.size());
+}
+BENCHMARK(BM_LockstepInstances);
@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "machine.hpp"
+#include "ppu.hpp"
+#include "static_ram.hpp"
+
+namespace {
+
+	// Noise in video memory and OAM, with every sprite on screen
+	void fillVideoMemory(jagce::RandomAccessMemory& memory) {
+		uint32_t seed = 12345;
+		for (size_t i = 0; i < jagce::Ppu::VRAM_SIZE; i++) {
+			seed = seed * 1103515245 + 12345;
+			memory.writeByte(jagce::Ppu::VRAM + i, static_cast<uint8_t>(seed >> 16));
+		}
+		for (size_t i = 0; i < jagce::Ppu::OAM_SIZE / 4; i++) {
+			memory.writeByte(jagce::Ppu::OAM + i * 4, static_cast<uint8_t>(16 + (i * 37) % 144));
+			memory.writeByte(jagce::Ppu::OAM + i * 4 + 1, static_cast<uint8_t>(8 + (i * 53) % 160));
+			memory.writeByte(jagce::Ppu::OAM + i * 4 + 2, static_cast<uint8_t>(i));
+			memory.writeByte(jagce::Ppu::OAM + i * 4 + 3, static_cast<uint8_t>(i * 0x10));
+		}
+	}
+
+}
+
+static void BM_RenderFrame(benchmark::State& state) {
+	auto memory = std::make_unique<jagce::StaticRAM<0x10000>>();
+	fillVideoMemory(*memory);
+	jagce::Scheduler scheduler{};
+	jagce::Interrupts interrupts{};
+	jagce::Lcd lcd{scheduler, interrupts};
+	// Background, window and sprites all on
+	lcd.write(jagce::Lcd::LCDC, 0xF3);
+	lcd.write(jagce::Lcd::WY, 72);
+	lcd.write(jagce::Lcd::WX, 87);
+	lcd.write(jagce::Lcd::BGP, 0xE4);
+	jagce::Ppu ppu{*memory};
+
+	for (auto _ : state) {
+		for (uint8_t line = 0; line < jagce::Ppu::HEIGHT; line++) {
+			ppu.renderLine(line, lcd);
+		}
+		benchmark::DoNotOptimize(ppu.getFrame().data());
+	}
+	state.SetItemsProcessed(state.iterations() * jagce::Ppu::WIDTH * jagce::Ppu::HEIGHT);
+}
+BENCHMARK(BM_RenderFrame);
+
+// A frame of running NOPs with the LCD off, or on and rendering every line
+static void BM_MachineFrame(benchmark::State& state) {
+	jagce::Machine machine{};
+	fillVideoMemory(machine.getMemory());
+	machine.getMemory().writeByte(jagce::Lcd::LCDC, state.range(0) != 0 ? 0xF3 : 0x00);
+	constexpr uint64_t FRAME_CYCLES = jagce::Lcd::LINE_CYCLES * jagce::Lcd::LINES;
+
+	for (auto _ : state) {
+		machine.getRegisters().pc = 0x0000;
+		machine.run(FRAME_CYCLES);
+	}
+}
+BENCHMARK(BM_MachineFrame)->Arg(0)->Arg(1);
@@ -0,0 +1,59 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "rewind.hpp"
+#include "static_ram.hpp"
+
+namespace {
+
+	constexpr size_t CAPTURES = 600;
+
+	// A frame's worth of writes: a sprite table, some of the stack and scattered variables
+	void runFrame(jagce::RandomAccessMemory& memory, size_t frame) {
+		for (size_t i = 0; i < 160; i++) {
+			memory.writeByte(0xFE00 + i, static_cast<uint8_t>(frame + i));
+		}
+		for (size_t i = 0; i < 32; i++) {
+			memory.writeByte(0xFFC0 + i, static_cast<uint8_t>(frame * i));
+			memory.writeByte(0xC000 + (frame * 977 + i * 131) % 0x2000, static_cast<uint8_t>(frame + i));
+		}
+	}
+
+}
+
+static void BM_RewindCapture(benchmark::State& state) {
+	auto memory = std::make_unique<jagce::StaticRAM<0x10000, 256>>();
+	jagce::Registers registers{};
+	jagce::RewindBuffer rewind{registers, CAPTURES, 8 << 20};
+	rewind.addMemory(*memory);
+
+	size_t frame = 0;
+	for (auto _ : state) {
+		runFrame(*memory, frame++);
+		rewind.capture();
+	}
+	state.counters["bytes_per_capture"] = static_cast<double>(rewind.bytesUsed()) / static_cast<double>(rewind.size());
+}
+BENCHMARK(BM_RewindCapture);
+
+static void BM_RewindStepBack(benchmark::State& state) {
+	auto memory = std::make_unique<jagce::StaticRAM<0x10000, 256>>();
+	jagce::Registers registers{};
+	jagce::RewindBuffer rewind{registers, CAPTURES, 8 << 20};
+	rewind.addMemory(*memory);
+
+	size_t frame = 0;
+	for (auto _ : state) {
+		state.PauseTiming();
+		if (rewind.empty()) {
+			for (size_t i = 0; i < CAPTURES; i++) {
+				runFrame(*memory, frame++);
+				rewind.capture();
+			}
+		}
+		state.ResumeTiming();
+		rewind.stepBack();
+	}
+}
+BENCHMARK(BM_RewindStepBack);
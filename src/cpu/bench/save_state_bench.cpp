@@ -0,0 +1,43 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "save_state.hpp"
+#include "static_ram.hpp"
+
+static void BM_SaveState(benchmark::State& state) {
+	const bool compress = state.range(0) != 0;
+	auto memory = std::make_unique<jagce::StaticRAM<0x10000>>();
+	jagce::Registers registers{};
+	jagce::SaveState saveState{registers};
+	saveState.addMemory(*memory);
+	for (size_t i = 0; i < memory->size(); i += 61) {
+		memory->writeByte(i, static_cast<uint8_t>(i));
+	}
+	std::vector<uint8_t> data{};
+
+	for (auto _ : state) {
+		saveState.save(data, compress);
+		benchmark::DoNotOptimize(data.data());
+	}
+	state.SetBytesProcessed(state.iterations() * saveState.size());
+}
+BENCHMARK(BM_SaveState)->Arg(0)->Arg(1);
+
+static void BM_LoadState(benchmark::State& state) {
+	const bool compress = state.range(0) != 0;
+	auto memory = std::make_unique<jagce::StaticRAM<0x10000>>();
+	jagce::Registers registers{};
+	jagce::SaveState saveState{registers};
+	saveState.addMemory(*memory);
+	std::vector<uint8_t> data{};
+	saveState.save(data, compress);
+
+	for (auto _ : state) {
+		saveState.load(data);
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(state.iterations() * saveState.size());
+}
+BENCHMARK(BM_LoadState)->Arg(0)->Arg(1);
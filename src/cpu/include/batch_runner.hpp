@@ -0,0 +1,94 @@
+#ifndef JAGCE_BATCH_RUNNER
+#define JAGCE_BATCH_RUNNER
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cache_line.hpp"
+#include "machine.hpp"
+
+namespace jagce {
+
+	// What a batch left an instance in, written only by the thread that ran it
+	struct alignas(CACHE_LINE_SIZE) BatchResult {
+		uint64_t cycles;
+		Registers registers;
+		bool halted;
+	};
+
+	/**
+	 * Owns independent Machines and runs all of them for a cycle budget on a pool of
+	 * threads. Each thread starts a batch with an even share of the instances and, once
+	 * it runs out, steals half of what's left of another thread's share. The shares are
+	 * ranges of instance indices packed into one atomic word, so taking and stealing
+	 * are single compare-and-swaps.
+	 *
+	 * Instances, results and shares each sit on their own cache lines, so threads never
+	 * write to a line another thread is using.
+	 */
+	class BatchRunner {
+	public:
+		constexpr static uint64_t FRAME_CYCLES = Lcd::LINE_CYCLES * Lcd::LINES;
+
+		// Zero threads uses one per hardware thread
+		explicit BatchRunner(size_t instances, size_t threads = 0);
+		~BatchRunner();
+		BatchRunner(const BatchRunner&) = delete;
+		BatchRunner& operator=(const BatchRunner&) = delete;
+
+		size_t size() const { return instances.size(); }
+		size_t threadCount() const { return workers.size(); }
+		Machine& instance(size_t index) { return instances[index]->machine; }
+		const BatchResult& result(size_t index) const { return results[index]; }
+
+		// Runs every instance for at least the cycles and fills its result. Rethrows the
+		// first exception an instance threw, after the others finished.
+		void run(uint64_t cycles);
+		void runFrames(uint64_t frames) { run(frames * FRAME_CYCLES); }
+
+		// Shares taken from another thread over the runner's lifetime
+		uint64_t getSteals() const { return steals.load(std::memory_order_relaxed); }
+
+	private:
+		struct alignas(CACHE_LINE_SIZE) Instance {
+			Machine machine;
+		};
+
+		// Instance indices [begin, end) as end << 32 | begin
+		struct alignas(CACHE_LINE_SIZE) Share {
+			std::atomic<uint64_t> range;
+		};
+
+		static uint64_t pack(uint32_t begin, uint32_t end) { return static_cast<uint64_t>(end) << 32 | begin; }
+
+		void work(size_t worker);
+		bool take(size_t worker, size_t& index);
+		bool steal(size_t worker);
+		void runInstance(size_t index);
+
+		std::vector<std::unique_ptr<Instance>> instances;
+		std::vector<BatchResult> results;
+		std::unique_ptr<Share[]> shares;
+		std::vector<std::thread> workers;
+
+		std::mutex mutex;
+		std::condition_variable started;
+		std::condition_variable finished;
+		uint64_t batch;
+		size_t running;
+		bool stopping;
+		uint64_t batchCycles;
+		std::exception_ptr error;
+		std::atomic<uint64_t> steals;
+	};
+
+}
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef JAGCE_BLOCK_CACHE
+#define JAGCE_BLOCK_CACHE
+
+#include <unordered_map>
+#include <vector>
+
+#include "decoder.hpp"
+#include "micro_op.hpp"
+#include "watched_memory.hpp"
+
+namespace jagce {
+
+	struct DecodedInstruction {
+		Event event;
+		// The event packed for the executor
+		MicroOp op;
+		uint16_t address;
+		// Opcode byte, or 0xCB00 plus the opcode for the CB page
+		uint16_t opcode;
+		uint8_t length;
+	};
+
+	// Idioms a run of instructions can be fused into
+	enum class FusedKind : uint8_t {
+		// LD A,(HL+); LD (DE),A; INC DE, repeated, with the last INC DE optional
+		COPY,
+		// LD (HL+),A, repeated
+		FILL_INCREMENT,
+		// LD (HL-),A, repeated
+		FILL_DECREMENT
+	};
+
+	/**
+	 * Instructions from first to first + count that execute as one superinstruction moving
+	 * bytes bytes. Cycles are the sum of the instructions', so timing is unchanged.
+	 */
+	struct FusedRun {
+		FusedKind kind;
+		uint16_t first;
+		uint16_t count;
+		uint16_t bytes;
+		uint32_t cycles;
+	};
+
+	// Finds the runs of instructions that can be fused, in order
+	std::vector<FusedRun> fuseInstructions(const std::vector<DecodedInstruction>& instructions);
+
+	/**
+	 * A block ending in a branch back to its own start whose every iteration leaves the same
+	 * registers, as it writes no memory and sets each register it reads from memory or
+	 * constants first. Once its branch is taken it repeats exactly until the memory it
+	 * reads changes, such as a loop polling LY or an interrupt flag.
+	 */
+	struct IdleLoop {
+		bool detected;
+		// Whether it may read DIV or TIMA, which count up without an event to wait for.
+		// Reads through registers may be of any address, so they count too.
+		bool readsTimer;
+		// Flag the branch tests, zero for an unconditional branch
+		uint8_t flag;
+		// Whether the branch is taken with the flag set or with it clear
+		bool takenWhenSet;
+
+		bool taken(uint8_t f) const {
+			return flag == 0 || ((f & flag) != 0) == takenWhenSet;
+		}
+	};
+
+	// Where a direct-threaded instruction jumps to, a label for computed goto or a function
+	// tail called by the previous handler, cast to void (*)() from the executor's own type
+	union ThreadedHandler {
+		void const * label;
+		void (*function)();
+	};
+
+	struct ThreadedInstruction {
+		ThreadedHandler handler;
+		MicroOp op;
+		// PC while the instruction executes
+		uint16_t nextPC;
+		uint16_t opcode;
+	};
+
+	/**
+	 * Instructions of a block threaded for one executor, each naming its own handler so
+	 * handlers jump straight to the next one. A final instruction ends the block.
+	 */
+	struct ThreadedCode {
+		// Handler table the code was threaded with, identifying the executor and dispatch
+		void const * owner = nullptr;
+		std::vector<ThreadedInstruction> instructions;
+	};
+
+	// A run of a compiled block, either native code covering count instructions from first
+	// or, when code is null, the instruction at first left to the interpreter
+	struct CompiledStep {
+		void const * code;
+		uint16_t first;
+		uint16_t count;
+		// Clock cycles of the instructions covered by native code
+		uint32_t cycles;
+	};
+
+	struct CompiledCode {
+		// Code buffer generation the steps were compiled into, zero until compiled
+		uint64_t generation = 0;
+		// Interpreted runs, counted until the block is hot enough to compile
+		uint32_t runs = 0;
+		std::vector<CompiledStep> steps;
+	};
+
+	/**
+	 * A run of straight-line instructions starting at start and ending before end. Runs end
+	 * after an instruction that transfers control, at MAX_BLOCK_INSTRUCTIONS, or at the end
+	 * of memory.
+	 */
+	struct DecodedBlock {
+		size_t start;
+		size_t end;
+		std::vector<DecodedInstruction> instructions;
+		std::vector<FusedRun> fused;
+		IdleLoop idleLoop;
+		// Set once a write to the block's memory has dropped it from the cache, which an
+		// executor running the block checks after each write to stop before stale code
+		mutable bool invalidated = false;
+		// Filled by the executor the first time it runs the block threaded, and dropped with
+		// the block when its memory is written
+		mutable ThreadedCode threaded;
+		// Filled by the Jit once the block is hot
+		mutable CompiledCode compiled;
+	};
+
+	// Instructions of a block that ran, which end at the one before PC when a write to
+	// the block's own memory stopped it
+	inline size_t executedInstructions(const DecodedBlock& block, uint16_t pc) {
+		if (block.invalidated) {
+			for (size_t i = 0; i < block.instructions.size(); i++) {
+				const DecodedInstruction& instruction = block.instructions[i];
+				if (static_cast<uint16_t>(instruction.address + instruction.length) == pc) {
+					return i + 1;
+				}
+			}
+		}
+		return block.instructions.size();
+	}
+
+	// Checks whether a block is an idle loop, reading its closing branch from memory
+	IdleLoop detectIdleLoop(const DecodedBlock& block, const RandomAccessMemory& memory);
+
+	/**
+	 * Caches decoded blocks by start address so hot code is decoded once and replayed.
+	 * The cache watches the pages its blocks were decoded from and drops every block
+	 * overlapping a write to them, marking it invalidated.
+	 *
+	 * Dropped blocks are kept alive until the next getBlock or clear, so a block that
+	 * writes its own memory can be run to that write. References returned by getBlock are
+	 * only valid until the next getBlock or clear after their block is dropped.
+	 */
+	class BlockCache : public MemoryWriteObserver {
+	public:
+		constexpr static size_t MAX_BLOCK_INSTRUCTIONS = 64;
+
+		BlockCache(WatchedMemory& memory);
+		~BlockCache();
+		BlockCache(const BlockCache&) = delete;
+		BlockCache& operator=(const BlockCache&) = delete;
+
+		const DecodedBlock& getBlock(size_t address);
+		bool contains(size_t address) const;
+		size_t size() const;
+
+		void invalidate(size_t index, size_t num);
+		void clear();
+
+		void memoryWritten(size_t index, size_t num) override;
+
+	private:
+		DecodedBlock decodeBlock(size_t address) const;
+		void erase(size_t start);
+
+		WatchedMemory& memory;
+		Decoder decoder;
+		std::unordered_map<size_t, DecodedBlock> blocks;
+		// Dropped blocks still referenced, extracted so they stay where they are
+		std::vector<std::unordered_map<size_t, DecodedBlock>::node_type> dropped;
+		// Start addresses of the blocks overlapping each page
+		std::vector<std::vector<size_t>> blocksByPage;
+	};
+
+}
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef JAGCE_CACHE_LINE
+#define JAGCE_CACHE_LINE
+
+#include <cstddef>
+
+namespace jagce {
+
+	// Destructive interference size, spelled out as GCC warns about the standard constant
+	constexpr size_t CACHE_LINE_SIZE = 64;
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef JAGCE_CYCLES
+#define JAGCE_CYCLES
+
+#include <array>
+
+#include "lazy_flags.hpp"
+
+namespace jagce {
+
+	// Clock cycles of every opcode with conditional branches not taken. Zero marks the
+	// opcodes the CPU doesn't have, and 0xCB is only the prefix of the CB page.
+	constexpr std::array<uint8_t, 256> MAIN_CYCLES{
+		 4, 12,  8,  8,  4,  4,  8,  4, 20,  8,  8,  8,  4,  4,  8,  4,
+		 4, 12,  8,  8,  4,  4,  8,  4, 12,  8,  8,  8,  4,  4,  8,  4,
+		 8, 12,  8,  8,  4,  4,  8,  4,  8,  8,  8,  8,  4,  4,  8,  4,
+		 8, 12,  8,  8, 12, 12, 12,  4,  8,  8,  8,  8,  4,  4,  8,  4,
+		 4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+		 4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+		 4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+		 8,  8,  8,  8,  8,  8,  4,  8,  4,  4,  4,  4,  4,  4,  8,  4,
+		 4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+		 4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+		 4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+		 4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+		 8, 12, 12, 16, 12, 16,  8, 16,  8, 16, 12,  4, 12, 24,  8, 16,
+		 8, 12, 12,  0, 12, 16,  8, 16,  8, 16, 12,  0, 12,  0,  8, 16,
+		12, 12,  8,  0,  0, 16,  8, 16, 16,  4, 16,  0,  0,  0,  8, 16,
+		12, 12,  8,  4,  0, 16,  8, 16, 12,  8, 16,  4,  0,  0,  8, 16,
+	};
+
+	namespace detail {
+
+		constexpr std::array<uint8_t, 256> makeCbCycles() {
+			std::array<uint8_t, 256> cycles{};
+			for (size_t opcode = 0; opcode < cycles.size(); opcode++) {
+				if ((opcode & 0x07) != 0x06) {
+					cycles[opcode] = 8;
+				} else {
+					// BIT only reads (HL), the others read and write it back
+					cycles[opcode] = opcode >= 0x40 && opcode < 0x80 ? 12 : 16;
+				}
+			}
+			return cycles;
+		}
+
+		constexpr std::array<uint8_t, 256> makeTakenCycles() {
+			std::array<uint8_t, 256> cycles{};
+			for (size_t opcode = 0; opcode < cycles.size(); opcode++) {
+				cycles[opcode] = MAIN_CYCLES[opcode];
+			}
+			for (uint8_t opcode : {0x20, 0x28, 0x30, 0x38}) {
+				cycles[opcode] = 12;
+			}
+			for (uint8_t opcode : {0xC2, 0xCA, 0xD2, 0xDA}) {
+				cycles[opcode] = 16;
+			}
+			for (uint8_t opcode : {0xC4, 0xCC, 0xD4, 0xDC}) {
+				cycles[opcode] = 24;
+			}
+			for (uint8_t opcode : {0xC0, 0xC8, 0xD0, 0xD8}) {
+				cycles[opcode] = 20;
+			}
+			return cycles;
+		}
+
+	}
+
+	// Clock cycles of every opcode on the CB page, including the prefix fetch
+	constexpr std::array<uint8_t, 256> CB_CYCLES = detail::makeCbCycles();
+
+	// Clock cycles of every opcode with conditional branches taken
+	constexpr std::array<uint8_t, 256> MAIN_TAKEN_CYCLES = detail::makeTakenCycles();
+
+	/**
+	 * Clock cycles of an opcode as held by DecodedInstruction: the opcode byte, or 0xCB00
+	 * plus the opcode for the CB page. Only conditional branches depend on taken.
+	 */
+	constexpr unsigned opcodeCycles(uint16_t opcode, bool taken = false) {
+		if ((opcode & 0xFF00) == 0xCB00) {
+			return CB_CYCLES[opcode & 0xFF];
+		}
+		return taken ? MAIN_TAKEN_CYCLES[opcode & 0xFF] : MAIN_CYCLES[opcode & 0xFF];
+	}
+
+	constexpr bool isConditionalBranch(uint16_t opcode) {
+		return opcode < 0x100 && MAIN_TAKEN_CYCLES[opcode] != MAIN_CYCLES[opcode];
+	}
+
+	// Whether a conditional branch is taken with flags f. Bits 3 and 4 of the opcode pick
+	// its condition, NZ, Z, NC or C.
+	constexpr bool branchTaken(uint16_t opcode, uint8_t f) {
+		const unsigned condition = (opcode >> 3) & 0x03;
+		const uint8_t flag = (condition & 0x02) ? FLAG_C : FLAG_Z;
+		return ((f & flag) != 0) == ((condition & 0x01) != 0);
+	}
+
+	static_assert(opcodeCycles(0x00) == 4 && opcodeCycles(0xCD) == 24 && opcodeCycles(0xCB46) == 12);
+	static_assert(opcodeCycles(0x20) == 8 && opcodeCycles(0x20, true) == 12);
+	static_assert(isConditionalBranch(0xC0) && !isConditionalBranch(0xC9) && !isConditionalBranch(0xCB20));
+	static_assert(branchTaken(0x20, 0) && !branchTaken(0x28, 0) && branchTaken(0xDA, FLAG_C) && !branchTaken(0xD0, FLAG_C));
+
+}
+
+#endif
@@ -0,0 +1,707 @@
+#ifndef JAGCE_EXECUTOR
+#define JAGCE_EXECUTOR
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "block_cache.hpp"
+#include "cycles.hpp"
+#include "histogram.hpp"
+#include "micro_op.hpp"
+#include "ram.hpp"
+#include "registers.hpp"
+
+// Computed goto is a GNU extension, define JAGCE_NO_COMPUTED_GOTO to use tail calls instead
+#if defined(__GNUC__) && !defined(JAGCE_NO_COMPUTED_GOTO)
+#define JAGCE_COMPUTED_GOTO
+#endif
+
+namespace jagce {
+
+	// How run dispatches the instructions of a block
+	enum class Dispatch : uint8_t {
+		// Through the handler table by the kind of each instruction
+		TABLE,
+		// Direct-threaded, each handler tail calling the next
+		TAIL_CALL,
+		// Direct-threaded, each handler jumping to the label of the next
+		COMPUTED_GOTO
+	};
+
+#ifdef JAGCE_COMPUTED_GOTO
+	constexpr bool computedGotoSupported = true;
+#else
+	constexpr bool computedGotoSupported = false;
+#endif
+
+	// Fastest direct-threaded dispatch the compiler supports
+	constexpr Dispatch threadedDispatch = computedGotoSupported ? Dispatch::COMPUTED_GOTO : Dispatch::TAIL_CALL;
+
+	/**
+	 * Applies decoded instructions to a register file and memory. Each MicroOpKind has its
+	 * own handler, reached through a table generated at compile time. Clock cycles are
+	 * those of the opcode each DecodedInstruction was decoded from, with conditional
+	 * branches taken or not as their condition holds on F.
+	 *
+	 * Memory accesses are made on the Memory type directly. Instantiated on a final memory
+	 * class such as StaticRAM or MemoryBus they bind statically and inline, while Executor
+	 * goes through the virtual RandomAccessMemory interface and accepts any memory.
+	 *
+	 * Table dispatch runs the fused runs of a block, such as unrolled copies and fills, as
+	 * one operation each, moving their bytes in bulk where the memory allows.
+	 *
+	 * Blocks can also be run direct-threaded, where each block is translated once into the
+	 * handler of every instruction and handlers go straight to the next without returning
+	 * to a central dispatch.
+	 */
+	template <typename Memory>
+	class BasicExecutor {
+		static_assert(isByteMemory<Memory>, "Executor memory must have the byte accessors of RandomAccessMemory");
+
+	public:
+		BasicExecutor(Registers& registers, Memory& memory);
+
+		// The op is taken by value, as a write may drop the block holding it
+		void execute(MicroOp op);
+		void execute(const Event& event);
+		// Returns the clock cycles taken
+		unsigned execute(const DecodedInstruction& instruction);
+
+		// Executes every instruction of the block, keeping PC at the instruction after the
+		// one executing. A write that invalidates the block ends the run after the writing
+		// instruction. Returns the clock cycles taken.
+		uint64_t run(const DecodedBlock& block);
+
+		/**
+		 * Runs a block, and if it is an idle loop whose branch is taken, skips the iterations
+		 * that would follow up to cyclesUntilEvent, when the memory it polls may next change.
+		 * Taking the branch leaves PC at the start of the block. Returns the cycles taken,
+		 * including those skipped.
+		 */
+		uint64_t runIdleLoop(const DecodedBlock& block, uint64_t cyclesUntilEvent);
+
+		// Throws std::invalid_argument for COMPUTED_GOTO when it is not supported
+		void setDispatch(Dispatch dispatch);
+		Dispatch getDispatch() const { return dispatch; }
+
+		// Whether table dispatch executes fused runs as one operation, on by default
+		void setFusion(bool fusion) { this->fusion = fusion; }
+		bool getFusion() const { return fusion; }
+
+	private:
+		using Handler = void (*)(BasicExecutor& executor, MicroOp op);
+		using TailCallHandler = uint64_t (*)(BasicExecutor& executor, ThreadedInstruction const * next, uint64_t cycles);
+		using ThreadedHandlerTable = std::array<ThreadedHandler, std::variant_size_v<Event> + 1>;
+
+		template <MicroOpKind K>
+		static void executeKind(BasicExecutor& executor, MicroOp op);
+
+		template <size_t... K>
+		constexpr static std::array<Handler, sizeof...(K)> makeHandlers(std::index_sequence<K...>) {
+			return {{ &executeKind<static_cast<MicroOpKind>(K)>... }};
+		}
+
+		using HandlerTable = std::array<Handler, std::variant_size_v<Event>>;
+		static const HandlerTable handlers;
+
+		template <MicroOpKind K>
+		static uint64_t tailCallKind(BasicExecutor& executor, ThreadedInstruction const * next, uint64_t cycles);
+		static uint64_t tailCallEnd(BasicExecutor& executor, ThreadedInstruction const * next, uint64_t cycles);
+
+		template <size_t... K>
+		static ThreadedHandlerTable makeTailCallHandlers(std::index_sequence<K...>);
+
+		// Handlers of each kind followed by the handler ending a block
+		static const ThreadedHandlerTable tailCallHandlers;
+
+		static ThreadedInstruction const * threadedCode(const DecodedBlock& block, const ThreadedHandlerTable& handlers);
+
+		uint64_t runTable(const DecodedBlock& block);
+		unsigned runFused(const FusedRun& run);
+		uint64_t runTailCall(const DecodedBlock& block);
+		uint64_t runComputedGoto(const DecodedBlock& block);
+
+		// Cycles of an instruction once executed, when F decides its branch
+		unsigned cyclesAfter(uint16_t opcode) const {
+			return isConditionalBranch(opcode) ? opcodeCycles(opcode, branchTaken(opcode, registers.f())) : opcodeCycles(opcode);
+		}
+
+		// Cycles of an instruction of kind K, where only NOP holds conditional branches
+		template <MicroOpKind K>
+		unsigned cyclesAfter(uint16_t opcode) const {
+			return K == MicroOpKind::NOP ? cyclesAfter(opcode) : opcodeCycles(opcode);
+		}
+
+		// Kinds with an operand that may be memory, after which a block can be invalidated
+		constexpr static bool mayWrite(MicroOpKind kind) {
+			switch (kind) {
+				case MicroOpKind::LOAD8:
+				case MicroOpKind::LOAD16:
+				case MicroOpKind::ADD8:
+				case MicroOpKind::INCREMENT8:
+				case MicroOpKind::DECREMENT8:
+				case MicroOpKind::PUSH:
+					return true;
+				default:
+					return false;
+			}
+		}
+
+		template <typename E>
+		constexpr static FlagMasks eventFlagMasks = flagMasks(encodeFlagStateChange(E::flagStates));
+
+		constexpr static int A = RegisterNames::A.getId();
+		constexpr static int BC = RegisterNames::BC.getId();
+		constexpr static int DE = RegisterNames::DE.getId();
+		constexpr static int HL = RegisterNames::HL.getId();
+
+		static uint8_t zeroFlag(uint8_t result) {
+			return result == 0 ? FLAG_Z : 0;
+		}
+
+		static uint8_t payload(uint8_t operand) {
+			return operand & 0x0F;
+		}
+
+		static OperandKind operandKind(uint8_t operand) {
+			return static_cast<OperandKind>(operand >> 4);
+		}
+
+		static uint8_t shift(uint8_t value, uint8_t aux, uint8_t& carry);
+
+		uint16_t indirectAddress(uint8_t operand);
+		uint16_t operandAddress(const MicroOp& op, uint8_t operand);
+		uint8_t read8(const MicroOp& op, uint8_t operand);
+		void write8(const MicroOp& op, uint8_t operand, uint8_t value);
+		uint8_t carryIn(const MicroOp& op, uint8_t operand) const;
+		uint16_t read16(const MicroOp& op, uint8_t operand);
+		void write16(const MicroOp& op, uint8_t operand, uint16_t value);
+		void push(uint16_t value);
+		uint16_t pop();
+
+		Registers& registers;
+		Memory& memory;
+		Dispatch dispatch;
+		bool fusion;
+		// Block being run by tail calls
+		const DecodedBlock* running;
+	};
+
+	using Executor = BasicExecutor<RandomAccessMemory>;
+
+	template <typename Memory>
+	const typename BasicExecutor<Memory>::HandlerTable BasicExecutor<Memory>::handlers =
+		BasicExecutor<Memory>::makeHandlers(std::make_index_sequence<std::variant_size_v<Event>>{});
+
+	template <typename Memory>
+	const typename BasicExecutor<Memory>::ThreadedHandlerTable BasicExecutor<Memory>::tailCallHandlers =
+		BasicExecutor<Memory>::makeTailCallHandlers(std::make_index_sequence<std::variant_size_v<Event>>{});
+
+	template <typename Memory>
+	BasicExecutor<Memory>::BasicExecutor(Registers& registers, Memory& memory)
+		: registers{registers}, memory{memory}, dispatch{Dispatch::TABLE}, fusion{true}, running{nullptr} {
+		if (memory.size() < 0x10000) {
+			throw std::invalid_argument("Executor memory must cover the 16-bit address space");
+		}
+	}
+
+	template <typename Memory>
+	void BasicExecutor<Memory>::execute(MicroOp op) {
+		handlers[static_cast<size_t>(op.kind)](*this, op);
+	}
+
+	template <typename Memory>
+	void BasicExecutor<Memory>::execute(const Event& event) {
+		execute(toMicroOp(event));
+	}
+
+	template <typename Memory>
+	unsigned BasicExecutor<Memory>::execute(const DecodedInstruction& instruction) {
+		const uint16_t opcode = instruction.opcode;
+		execute(instruction.op);
+		return cyclesAfter(opcode);
+	}
+
+	template <typename Memory>
+	uint64_t BasicExecutor<Memory>::run(const DecodedBlock& block) {
+		uint64_t cycles = 0;
+		switch (dispatch) {
+			case Dispatch::TAIL_CALL:
+				cycles = runTailCall(block);
+				break;
+			case Dispatch::COMPUTED_GOTO:
+				cycles = runComputedGoto(block);
+				break;
+			default:
+				cycles = runTable(block);
+				break;
+		}
+		// PC is after the last instruction that ran, also when a write stopped the block
+		countExecuted(block, registers.pc);
+		return cycles;
+	}
+
+	template <typename Memory>
+	uint64_t BasicExecutor<Memory>::runTable(const DecodedBlock& block) {
+		const size_t runs = fusion ? block.fused.size() : 0;
+		size_t nextRun = 0;
+
+		uint64_t cycles = 0;
+		for (size_t i = 0; i < block.instructions.size();) {
+			if (nextRun < runs && block.fused[nextRun].first == i) {
+				const FusedRun& run = block.fused[nextRun++];
+				const DecodedInstruction& last = block.instructions[i + run.count - 1];
+				registers.pc = static_cast<uint16_t>(last.address + last.length);
+				cycles += runFused(run);
+				i += run.count;
+			} else {
+				const DecodedInstruction& instruction = block.instructions[i++];
+				registers.pc = static_cast<uint16_t>(instruction.address + instruction.length);
+				cycles += execute(instruction);
+			}
+			if (block.invalidated) {
+				break;
+			}
+		}
+		return cycles;
+	}
+
+	template <typename Memory>
+	unsigned BasicExecutor<Memory>::runFused(const FusedRun& run) {
+		const size_t bytes = run.bytes;
+		const uint16_t hl = registers.get16(HL);
+
+		if (run.kind == FusedKind::COPY) {
+			const uint16_t de = registers.get16(DE);
+			uint8_t last = 0;
+			bool bulk = false;
+			if constexpr (std::is_base_of_v<RandomAccessMemory, Memory>) {
+				// Byte by byte when the ranges overlap, where later reads see earlier writes
+				bulk = (hl + bytes <= de || de + bytes <= hl) && hl + bytes <= 0x10000 && de + bytes <= 0x10000;
+				if (bulk) {
+					uint8_t const * source = memory.readBytes(hl, bytes);
+					last = source[bytes - 1];
+					memory.writeBytes(de, source, bytes);
+				}
+			}
+			if (!bulk) {
+				for (size_t i = 0; i < bytes; i++) {
+					last = memory.readByte(static_cast<uint16_t>(hl + i));
+					memory.writeByte(static_cast<uint16_t>(de + i), last);
+				}
+			}
+
+			registers.set8(A, last);
+			registers.set16(HL, static_cast<uint16_t>(hl + bytes));
+			// Every byte but a last without INC DE moves DE on
+			registers.set16(DE, static_cast<uint16_t>(de + run.count / 3));
+			return run.cycles;
+		}
+
+		const uint8_t a = registers.get8(A);
+		const bool increment = run.kind == FusedKind::FILL_INCREMENT;
+		bool bulk = false;
+		if constexpr (std::is_base_of_v<RandomAccessMemory, Memory>) {
+			const size_t first = increment ? hl : static_cast<size_t>(hl) - (bytes - 1);
+			bulk = first <= hl && first + bytes <= 0x10000;
+			if (bulk) {
+				std::array<uint8_t, BlockCache::MAX_BLOCK_INSTRUCTIONS> fill;
+				fill.fill(a);
+				memory.writeBytes(first, fill.data(), bytes);
+			}
+		}
+		if (!bulk) {
+			for (size_t i = 0; i < bytes; i++) {
+				memory.writeByte(static_cast<uint16_t>(increment ? hl + i : hl - i), a);
+			}
+		}
+
+		registers.set16(HL, static_cast<uint16_t>(increment ? hl + bytes : hl - bytes));
+		return run.cycles;
+	}
+
+	template <typename Memory>
+	uint64_t BasicExecutor<Memory>::runIdleLoop(const DecodedBlock& block, uint64_t cyclesUntilEvent) {
+		uint64_t cycles = run(block);
+		if (!block.idleLoop.detected || cycles == 0 || block.invalidated) {
+			return cycles;
+		}
+		if (!block.idleLoop.taken(registers.f())) {
+			return cycles;
+		}
+
+		registers.pc = static_cast<uint16_t>(block.start);
+		if (cyclesUntilEvent <= cycles) {
+			return cycles;
+		}
+		// Whole iterations only, so the loop is back at its start when the event arrives
+		const uint64_t skipped = (cyclesUntilEvent - cycles) / cycles;
+		if (skipped != 0) {
+			countExecuted(block, registers.pc, skipped);
+		}
+		return cycles + skipped * cycles;
+	}
+
+	template <typename Memory>
+	void BasicExecutor<Memory>::setDispatch(Dispatch dispatch) {
+		if (dispatch == Dispatch::COMPUTED_GOTO && !computedGotoSupported) {
+			throw std::invalid_argument("Computed goto dispatch is not supported by this compiler");
+		}
+		this->dispatch = dispatch;
+	}
+
+	template <typename Memory>
+	ThreadedInstruction const * BasicExecutor<Memory>::threadedCode(const DecodedBlock& block, const ThreadedHandlerTable& handlers) {
+		ThreadedCode& threaded = block.threaded;
+		if (threaded.owner != &handlers) {
+			threaded.instructions.clear();
+			threaded.instructions.reserve(block.instructions.size() + 1);
+			for (const DecodedInstruction& instruction : block.instructions) {
+				threaded.instructions.push_back({handlers[static_cast<size_t>(instruction.op.kind)], instruction.op,
+					static_cast<uint16_t>(instruction.address + instruction.length), instruction.opcode});
+			}
+			threaded.instructions.push_back({handlers.back(), MicroOp{}, 0, 0});
+			threaded.owner = &handlers;
+		}
+		return threaded.instructions.data();
+	}
+
+	template <typename Memory>
+	template <size_t... K>
+	typename BasicExecutor<Memory>::ThreadedHandlerTable BasicExecutor<Memory>::makeTailCallHandlers(std::index_sequence<K...>) {
+		const std::array<TailCallHandler, sizeof...(K) + 1> functions{{ &tailCallKind<static_cast<MicroOpKind>(K)>..., &tailCallEnd }};
+		ThreadedHandlerTable table{};
+		for (size_t i = 0; i < functions.size(); i++) {
+			table[i].function = reinterpret_cast<void (*)()>(functions[i]);
+		}
+		return table;
+	}
+
+	template <typename Memory>
+	template <MicroOpKind K>
+	uint64_t BasicExecutor<Memory>::tailCallKind(BasicExecutor& executor, ThreadedInstruction const * next, uint64_t cycles) {
+		executor.registers.pc = next->nextPC;
+		executeKind<K>(executor, next->op);
+		cycles += executor.template cyclesAfter<K>(next->opcode);
+		if (mayWrite(K) && executor.running->invalidated) {
+			return cycles;
+		}
+		next++;
+		return reinterpret_cast<TailCallHandler>(next->handler.function)(executor, next, cycles);
+	}
+
+	template <typename Memory>
+	uint64_t BasicExecutor<Memory>::tailCallEnd(BasicExecutor&, ThreadedInstruction const *, uint64_t cycles) {
+		return cycles;
+	}
+
+	template <typename Memory>
+	uint64_t BasicExecutor<Memory>::runTailCall(const DecodedBlock& block) {
+		ThreadedInstruction const * next = threadedCode(block, tailCallHandlers);
+		running = &block;
+		return reinterpret_cast<TailCallHandler>(next->handler.function)(*this, next, 0);
+	}
+
+	template <typename Memory>
+	uint64_t BasicExecutor<Memory>::runComputedGoto(const DecodedBlock& block) {
+#ifdef JAGCE_COMPUTED_GOTO
+#define JAGCE_THREADED_LABEL(KIND) \
+		KIND##_LABEL: \
+			registers.pc = next->nextPC; \
+			executeKind<MicroOpKind::KIND>(*this, next->op); \
+			cycles += cyclesAfter<MicroOpKind::KIND>(next->opcode); \
+			if (mayWrite(MicroOpKind::KIND) && block.invalidated) { \
+				goto END_LABEL; \
+			} \
+			next++; \
+			goto *next->handler.label;
+
+		// In MicroOpKind order, followed by the end of the block
+		static const ThreadedHandlerTable labels{{
+			{&&DECREMENT8_LABEL}, {&&INCREMENT8_LABEL}, {&&COMPARE8_LABEL}, {&&XOR8_LABEL}, {&&OR8_LABEL},
+			{&&AND8_LABEL}, {&&SUB8_LABEL}, {&&ADD8_LABEL}, {&&PUSH_LABEL}, {&&POP_LABEL},
+			{&&REGISTER_SHIFT_LABEL}, {&&LOAD8_LABEL}, {&&LOAD16_LABEL}, {&&NOP_LABEL}, {&&ADD_HL_LABEL},
+			{&&ADD_SP_LABEL}, {&&INCREMENT16_LABEL}, {&&DECREMENT16_LABEL}, {&&END_LABEL}
+		}};
+		static_assert(static_cast<size_t>(MicroOpKind::DECREMENT16) + 2 == std::tuple_size_v<ThreadedHandlerTable>,
+				"Every MicroOpKind needs a label");
+
+		ThreadedInstruction const * next = threadedCode(block, labels);
+		uint64_t cycles = 0;
+		goto *next->handler.label;
+
+		JAGCE_THREADED_LABEL(DECREMENT8)
+		JAGCE_THREADED_LABEL(INCREMENT8)
+		JAGCE_THREADED_LABEL(COMPARE8)
+		JAGCE_THREADED_LABEL(XOR8)
+		JAGCE_THREADED_LABEL(OR8)
+		JAGCE_THREADED_LABEL(AND8)
+		JAGCE_THREADED_LABEL(SUB8)
+		JAGCE_THREADED_LABEL(ADD8)
+		JAGCE_THREADED_LABEL(PUSH)
+		JAGCE_THREADED_LABEL(POP)
+		JAGCE_THREADED_LABEL(REGISTER_SHIFT)
+		JAGCE_THREADED_LABEL(LOAD8)
+		JAGCE_THREADED_LABEL(LOAD16)
+		JAGCE_THREADED_LABEL(NOP)
+		JAGCE_THREADED_LABEL(ADD_HL)
+		JAGCE_THREADED_LABEL(ADD_SP)
+		JAGCE_THREADED_LABEL(INCREMENT16)
+		JAGCE_THREADED_LABEL(DECREMENT16)
+
+	END_LABEL:
+		return cycles;
+#undef JAGCE_THREADED_LABEL
+#else
+		return runTailCall(block);
+#endif
+	}
+
+	template <typename Memory>
+	template <MicroOpKind K>
+	void BasicExecutor<Memory>::executeKind(BasicExecutor& executor, MicroOp op) {
+		using E = std::variant_alternative_t<static_cast<size_t>(K), Event>;
+		Registers& r = executor.registers;
+
+		if constexpr (K == MicroOpKind::LOAD8) {
+			executor.write8(op, op.a, executor.read8(op, op.b));
+		} else if constexpr (K == MicroOpKind::LOAD16) {
+			if (operandKind(op.b) == OperandKind::REGISTER16_PLUS_VALUE) {
+				// The value is the signed 8-bit immediate of LD HL,SP+e
+				const uint16_t base = r.get16(payload(op.b));
+				const uint8_t e = static_cast<uint8_t>(op.immediate);
+				executor.write16(op, op.a, static_cast<uint16_t>(base + static_cast<int8_t>(e)));
+				r.deferFlags(flagMasks(op.flagEffects), FlagWidth::BITS8, base, e, base + e);
+			} else {
+				executor.write16(op, op.a, executor.read16(op, op.b));
+				if (op.flagEffects != 0) {
+					r.deferFlags(flagMasks(op.flagEffects), FlagWidth::BITS8, 0, 0, 0);
+				}
+			}
+		} else if constexpr (K == MicroOpKind::PUSH) {
+			executor.push(executor.read16(op, op.a));
+		} else if constexpr (K == MicroOpKind::POP) {
+			executor.write16(op, op.a, executor.pop());
+		} else if constexpr (K == MicroOpKind::ADD8) {
+			const uint8_t x = executor.read8(op, op.a);
+			const uint8_t y = executor.read8(op, op.b);
+			const uint8_t c = executor.carryIn(op, op.b);
+			const uint32_t result = x + y + c;
+			executor.write8(op, op.a, static_cast<uint8_t>(result));
+			r.deferFlags(eventFlagMasks<E>, FlagWidth::BITS8, x, y, result);
+		} else if constexpr (K == MicroOpKind::SUB8 || K == MicroOpKind::COMPARE8) {
+			const uint8_t x = r.get8(A);
+			const uint8_t y = executor.read8(op, op.a);
+			const uint8_t c = executor.carryIn(op, op.a);
+			const uint32_t result = static_cast<uint32_t>(x - y - c);
+			if constexpr (K == MicroOpKind::SUB8) {
+				r.set8(A, static_cast<uint8_t>(result));
+			}
+			r.deferFlags(eventFlagMasks<E>, FlagWidth::BITS8, x, y, result);
+		} else if constexpr (K == MicroOpKind::AND8 || K == MicroOpKind::OR8 || K == MicroOpKind::XOR8) {
+			const uint8_t y = executor.read8(op, op.a);
+			uint8_t result = r.get8(A);
+			if constexpr (K == MicroOpKind::AND8) {
+				result &= y;
+			} else if constexpr (K == MicroOpKind::OR8) {
+				result |= y;
+			} else {
+				result ^= y;
+			}
+			r.set8(A, result);
+			r.deferFlags(eventFlagMasks<E>, FlagWidth::BITS8, 0, 0, result);
+		} else if constexpr (K == MicroOpKind::INCREMENT8 || K == MicroOpKind::DECREMENT8) {
+			const uint8_t value = executor.read8(op, op.a);
+			if constexpr (K == MicroOpKind::INCREMENT8) {
+				const uint32_t result = value + 1;
+				executor.write8(op, op.a, static_cast<uint8_t>(result));
+				r.deferFlags(eventFlagMasks<E>, FlagWidth::BITS8, value, 1, result);
+			} else {
+				const uint32_t result = static_cast<uint32_t>(value - 1);
+				executor.write8(op, op.a, static_cast<uint8_t>(result));
+				r.deferFlags(eventFlagMasks<E>, FlagWidth::BITS8, value, 1, result);
+			}
+		} else if constexpr (K == MicroOpKind::ADD_HL) {
+			const uint16_t hl = r.get16(HL);
+			const uint16_t value = r.get16(payload(op.a));
+			const uint32_t result = hl + value;
+			r.set16(HL, static_cast<uint16_t>(result));
+			r.deferFlags(eventFlagMasks<E>, FlagWidth::BITS16, hl, value, result);
+		} else if constexpr (K == MicroOpKind::ADD_SP) {
+			const uint8_t e = static_cast<uint8_t>(op.immediate);
+			const uint16_t sp = r.sp;
+			r.sp = static_cast<uint16_t>(sp + static_cast<int8_t>(e));
+			r.deferFlags(eventFlagMasks<E>, FlagWidth::BITS8, sp, e, sp + e);
+		} else if constexpr (K == MicroOpKind::INCREMENT16) {
+			r.set16(payload(op.a), static_cast<uint16_t>(r.get16(payload(op.a)) + 1));
+		} else if constexpr (K == MicroOpKind::DECREMENT16) {
+			r.set16(payload(op.a), static_cast<uint16_t>(r.get16(payload(op.a)) - 1));
+		} else if constexpr (K == MicroOpKind::REGISTER_SHIFT) {
+			uint8_t carry = (r.f() & FLAG_C) ? 1 : 0;
+			const uint8_t result = shift(r.get8(payload(op.a)), op.aux, carry);
+			r.set8(payload(op.a), result);
+			r.setF(static_cast<uint8_t>(zeroFlag(result) | (carry ? FLAG_C : 0)));
+		}
+	}
+
+	template <typename Memory>
+	uint16_t BasicExecutor<Memory>::indirectAddress(uint8_t operand) {
+		switch (static_cast<Indirect>(payload(operand))) {
+			case Indirect::BC:
+				return registers.get16(BC);
+			case Indirect::DE:
+				return registers.get16(DE);
+			case Indirect::HLI:
+				{
+					const uint16_t hl = registers.get16(HL);
+					registers.set16(HL, static_cast<uint16_t>(hl + 1));
+					return hl;
+				}
+			case Indirect::HLD:
+				{
+					const uint16_t hl = registers.get16(HL);
+					registers.set16(HL, static_cast<uint16_t>(hl - 1));
+					return hl;
+				}
+			default:
+				return registers.get16(HL);
+		}
+	}
+
+	template <typename Memory>
+	uint16_t BasicExecutor<Memory>::operandAddress(const MicroOp& op, uint8_t operand) {
+		switch (operandKind(operand)) {
+			case OperandKind::ADDRESS:
+				return op.immediate;
+			case OperandKind::PARTIAL_ADDRESS:
+				{
+					uint8_t msb = static_cast<uint8_t>(op.immediate >> 8);
+					uint8_t lsb = static_cast<uint8_t>(op.immediate);
+					if (payload(operand) & PARTIAL_ADDRESS_MSB_REGISTER) {
+						msb = registers.get8(msb);
+					}
+					if (payload(operand) & PARTIAL_ADDRESS_LSB_REGISTER) {
+						lsb = registers.get8(lsb);
+					}
+					return static_cast<uint16_t>((msb << 8) | lsb);
+				}
+			default:
+				return indirectAddress(operand);
+		}
+	}
+
+	template <typename Memory>
+	uint8_t BasicExecutor<Memory>::read8(const MicroOp& op, uint8_t operand) {
+		switch (operandKind(operand)) {
+			case OperandKind::REGISTER:
+			case OperandKind::REGISTER8_PLUS_FLAG:
+				return registers.get8(payload(operand));
+			case OperandKind::IMMEDIATE8:
+			case OperandKind::IMMEDIATE8_PLUS_FLAG:
+				return static_cast<uint8_t>(op.immediate);
+			default:
+				return memory.readByte(operandAddress(op, operand));
+		}
+	}
+
+	template <typename Memory>
+	void BasicExecutor<Memory>::write8(const MicroOp& op, uint8_t operand, uint8_t value) {
+		if (operandKind(operand) == OperandKind::REGISTER) {
+			registers.set8(payload(operand), value);
+		} else {
+			memory.writeByte(operandAddress(op, operand), value);
+		}
+	}
+
+	template <typename Memory>
+	uint8_t BasicExecutor<Memory>::carryIn(const MicroOp& op, uint8_t operand) const {
+		switch (operandKind(operand)) {
+			case OperandKind::REGISTER8_PLUS_FLAG:
+			case OperandKind::INDIRECT_PLUS_FLAG:
+			case OperandKind::IMMEDIATE8_PLUS_FLAG:
+				return (registers.f() & flagBit(static_cast<FlagName>(op.aux))) ? 1 : 0;
+			default:
+				return 0;
+		}
+	}
+
+	template <typename Memory>
+	uint16_t BasicExecutor<Memory>::read16(const MicroOp& op, uint8_t operand) {
+		switch (operandKind(operand)) {
+			case OperandKind::REGISTER:
+				return registers.get16(payload(operand));
+			case OperandKind::IMMEDIATE16:
+				return op.immediate;
+			default:
+				{
+					const uint16_t address = operandAddress(op, operand);
+					return static_cast<uint16_t>(memory.readByte(address) | (memory.readByte(static_cast<uint16_t>(address + 1)) << 8));
+				}
+		}
+	}
+
+	template <typename Memory>
+	void BasicExecutor<Memory>::write16(const MicroOp& op, uint8_t operand, uint16_t value) {
+		if (operandKind(operand) == OperandKind::REGISTER) {
+			registers.set16(payload(operand), value);
+		} else {
+			const uint16_t address = operandAddress(op, operand);
+			memory.writeByte(address, static_cast<uint8_t>(value));
+			memory.writeByte(static_cast<uint16_t>(address + 1), static_cast<uint8_t>(value >> 8));
+		}
+	}
+
+	template <typename Memory>
+	void BasicExecutor<Memory>::push(uint16_t value) {
+		registers.sp = static_cast<uint16_t>(registers.sp - 2);
+		memory.writeByte(registers.sp, static_cast<uint8_t>(value));
+		memory.writeByte(static_cast<uint16_t>(registers.sp + 1), static_cast<uint8_t>(value >> 8));
+	}
+
+	template <typename Memory>
+	uint16_t BasicExecutor<Memory>::pop() {
+		const uint16_t value = static_cast<uint16_t>(memory.readByte(registers.sp) | (memory.readByte(static_cast<uint16_t>(registers.sp + 1)) << 8));
+		registers.sp = static_cast<uint16_t>(registers.sp + 2);
+		return value;
+	}
+
+	template <typename Memory>
+	uint8_t BasicExecutor<Memory>::shift(uint8_t value, uint8_t aux, uint8_t& carry) {
+		const ShiftDirection direction = static_cast<ShiftDirection>(aux & 0x01);
+		const ShiftType type = static_cast<ShiftType>((aux >> 1) & 0x03);
+		const unsigned int amount = aux >> 3;
+
+		for (unsigned int i = 0; i < amount; i++) {
+			if (direction == ShiftDirection::LEFT) {
+				const uint8_t out = value >> 7;
+				switch (type) {
+					case ShiftType::ROTATE: value = static_cast<uint8_t>((value << 1) | out); break;
+					case ShiftType::ROTATE_THROUGH_CARRY: value = static_cast<uint8_t>((value << 1) | carry); break;
+					default: value = static_cast<uint8_t>(value << 1); break;
+				}
+				carry = out;
+			} else {
+				const uint8_t out = value & 0x01;
+				switch (type) {
+					case ShiftType::ROTATE: value = static_cast<uint8_t>((value >> 1) | (out << 7)); break;
+					case ShiftType::ROTATE_THROUGH_CARRY: value = static_cast<uint8_t>((value >> 1) | (carry << 7)); break;
+					case ShiftType::ARITHMETIC: value = static_cast<uint8_t>((value >> 1) | (value & 0x80)); break;
+					default: value = static_cast<uint8_t>(value >> 1); break;
+				}
+				carry = out;
+			}
+		}
+
+		return value;
+	}
+
+	// Instantiated once in executor.cpp
+	extern template class BasicExecutor<RandomAccessMemory>;
+
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef JAGCE_HISTOGRAM
+#define JAGCE_HISTOGRAM
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <variant>
+
+#include "decoder.hpp"
+#include "micro_op.hpp"
+
+namespace jagce {
+
+#ifdef JAGCE_HISTOGRAM_ENABLED
+	constexpr bool histogramEnabled = true;
+#else
+	constexpr bool histogramEnabled = false;
+#endif
+
+	/**
+	 * How many times each opcode and each Event alternative was decoded into a block and
+	 * executed. Opcodes 0x00-0xFF are the main page and 0x100-0x1FF the CB page.
+	 */
+	struct OpcodeHistogram {
+		constexpr static size_t OPCODES = 0x200;
+		constexpr static size_t EVENTS = std::variant_size_v<Event>;
+
+		std::array<uint64_t, OPCODES> decodedOpcodes;
+		std::array<uint64_t, OPCODES> executedOpcodes;
+		std::array<uint64_t, EVENTS> decodedEvents;
+		std::array<uint64_t, EVENTS> executedEvents;
+
+		// Index of an opcode as held by DecodedInstruction, 0xCB00 plus the opcode for the CB page
+		constexpr static size_t indexOf(uint16_t opcode) {
+			return (opcode & 0xFF00) == 0xCB00 ? 0x100 + (opcode & 0xFF) : opcode & 0xFF;
+		}
+
+		void merge(const OpcodeHistogram& other);
+
+		// Rows for the opcodes and events with a count, as CSV with a header or as JSON
+		void writeCsv(std::ostream& out) const;
+		void writeJson(std::ostream& out) const;
+	};
+
+	/**
+	 * Counters of one thread. Only the owning thread writes them, with plain loads and
+	 * stores that the atomics just make safe to read from another thread while it runs.
+	 */
+	class ThreadHistogram {
+	public:
+		void decoded(uint16_t opcode, MicroOpKind kind) {
+			bump(decodedOpcodes[OpcodeHistogram::indexOf(opcode)]);
+			bump(decodedEvents[static_cast<size_t>(kind)]);
+		}
+
+		void executed(uint16_t opcode, MicroOpKind kind, uint64_t times = 1) {
+			bump(executedOpcodes[OpcodeHistogram::indexOf(opcode)], times);
+			bump(executedEvents[static_cast<size_t>(kind)], times);
+		}
+
+		void addTo(OpcodeHistogram& histogram) const;
+		void clear();
+
+	private:
+		static void bump(std::atomic<uint64_t>& counter, uint64_t times = 1) {
+			counter.store(counter.load(std::memory_order_relaxed) + times, std::memory_order_relaxed);
+		}
+
+		std::array<std::atomic<uint64_t>, OpcodeHistogram::OPCODES> decodedOpcodes{};
+		std::array<std::atomic<uint64_t>, OpcodeHistogram::OPCODES> executedOpcodes{};
+		std::array<std::atomic<uint64_t>, OpcodeHistogram::EVENTS> decodedEvents{};
+		std::array<std::atomic<uint64_t>, OpcodeHistogram::EVENTS> executedEvents{};
+	};
+
+	// The calling thread's counters, which are kept in the totals when it exits
+	ThreadHistogram& threadHistogram();
+
+	// Sums the counters of every thread
+	OpcodeHistogram collectHistogram();
+
+	// Zeroes every thread's counters. Counts made by threads running meanwhile may survive.
+	void resetHistogram();
+
+	// Instrumentation points, which compile to nothing unless JAGCE_HISTOGRAM_ENABLED is defined
+	inline void countDecoded(uint16_t opcode, MicroOpKind kind) {
+		if constexpr (histogramEnabled) {
+			threadHistogram().decoded(opcode, kind);
+		}
+	}
+
+	// Counts the instructions of a block that ran up to PC, times over
+	template <typename Block>
+	inline void countExecuted(const Block& block, uint16_t pc, uint64_t times = 1) {
+		if constexpr (histogramEnabled) {
+			ThreadHistogram& histogram = threadHistogram();
+			const size_t count = executedInstructions(block, pc);
+			for (size_t i = 0; i < count; i++) {
+				histogram.executed(block.instructions[i].opcode, block.instructions[i].op.kind, times);
+			}
+		}
+	}
+
+}
+
+#endif
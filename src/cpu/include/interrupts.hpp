@@ -0,0 +1,36 @@
+#ifndef JAGCE_INTERRUPTS
+#define JAGCE_INTERRUPTS
+
+#include <cstdint>
+
+namespace jagce {
+
+	constexpr uint8_t INTERRUPT_VBLANK = 0x01;
+	constexpr uint8_t INTERRUPT_STAT = 0x02;
+	constexpr uint8_t INTERRUPT_TIMER = 0x04;
+	constexpr uint8_t INTERRUPT_SERIAL = 0x08;
+	constexpr uint8_t INTERRUPT_JOYPAD = 0x10;
+
+	/**
+	 * The interrupt flag (IF, 0xFF0F) and enable (IE, 0xFFFF) registers. Devices request
+	 * interrupts by setting their IF bit, which wakes a halted CPU once IE enables it.
+	 */
+	struct Interrupts {
+		constexpr static uint16_t IF_ADDRESS = 0xFF0F;
+		constexpr static uint16_t IE_ADDRESS = 0xFFFF;
+		constexpr static uint8_t ALL = 0x1F;
+
+		uint8_t flags;
+		uint8_t enabled;
+
+		void request(uint8_t interrupt) { flags |= interrupt; }
+		uint8_t pending() const { return flags & enabled & ALL; }
+
+		// Unused IF bits read as set
+		uint8_t readFlags() const { return flags | static_cast<uint8_t>(~ALL); }
+		void writeFlags(uint8_t value) { flags = value & ALL; }
+	};
+
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef JAGCE_JIT
+#define JAGCE_JIT
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "block_cache.hpp"
+#include "executor.hpp"
+#include "registers.hpp"
+#include "watched_memory.hpp"
+
+#if defined(__x86_64__) && defined(__unix__) && !defined(JAGCE_NO_JIT)
+#define JAGCE_JIT_X86_64
+#endif
+
+namespace jagce {
+
+#ifdef JAGCE_JIT_X86_64
+	constexpr bool jitSupported = true;
+#else
+	constexpr bool jitSupported = false;
+#endif
+
+	struct JitStats {
+		uint64_t compiledBlocks;
+		uint64_t nativeInstructions;
+		uint64_t interpretedInstructions;
+		// Times the code buffer filled up and every compiled block was dropped
+		uint64_t flushes;
+	};
+
+	/**
+	 * Runs cached blocks, compiling the ones run more than a threshold number of times to
+	 * x86-64 code. Register-only loads, arithmetic and logic are compiled with the guest
+	 * registers held in host registers for each run of them, while instructions that touch
+	 * memory or the stack are left to the interpreter, between runs of native code.
+	 *
+	 * Compiled code belongs to its DecodedBlock, so writes to a block's memory drop its code
+	 * along with it. A write made by the block itself ends the run at the instruction after
+	 * the write. Where the host is not x86-64 every block is interpreted.
+	 */
+	class Jit {
+	public:
+		constexpr static uint32_t DEFAULT_COMPILE_THRESHOLD = 4;
+		constexpr static size_t DEFAULT_CODE_SIZE = 1 << 20;
+
+		Jit(Registers& registers, WatchedMemory& memory, BlockCache& cache,
+				uint32_t compileThreshold = DEFAULT_COMPILE_THRESHOLD, size_t codeSize = DEFAULT_CODE_SIZE);
+		~Jit();
+		Jit(const Jit&) = delete;
+		Jit& operator=(const Jit&) = delete;
+
+		// Runs the block at address, leaving PC after the last instruction run. Returns the
+		// clock cycles taken.
+		uint64_t run(size_t address);
+
+		// Drops all compiled code
+		void flush();
+
+		const JitStats& getStats() const { return stats; }
+
+	private:
+		uint64_t interpret(const DecodedBlock& block);
+		void compile(const DecodedBlock& block);
+
+		Registers& registers;
+		BlockCache& cache;
+		BasicExecutor<WatchedMemory> executor;
+		const uint32_t compileThreshold;
+
+		uint8_t* code;
+		size_t codeSize;
+		size_t codeUsed;
+		uint64_t generation;
+		// Code of the block being compiled, copied into the code buffer when complete
+		std::vector<uint8_t> assembly;
+		JitStats stats;
+	};
+
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef JAGCE_LAZY_FLAGS
+#define JAGCE_LAZY_FLAGS
+
+#include <cstddef>
+#include <cstdint>
+
+#include "register_names.hpp"
+
+namespace jagce {
+
+	constexpr uint8_t FLAG_Z = 0x80;
+	constexpr uint8_t FLAG_N = 0x40;
+	constexpr uint8_t FLAG_H = 0x20;
+	constexpr uint8_t FLAG_C = 0x10;
+
+	// Bit of F holding a flag, the Z80-only flags have none
+	constexpr uint8_t flagBit(FlagName flag) {
+		switch (flag) {
+			case FlagName::Z: return FLAG_Z;
+			case FlagName::N: return FLAG_N;
+			case FlagName::H: return FLAG_H;
+			case FlagName::C: return FLAG_C;
+			default: return 0;
+		}
+	}
+
+	// Flags an instruction sets, resets and leaves to be computed from its operands, as bits of F
+	struct FlagMasks {
+		uint8_t set;
+		uint8_t reset;
+		uint8_t computed;
+
+		constexpr uint8_t written() const { return set | reset | computed; }
+	};
+
+	constexpr FlagMasks flagMasks(uint16_t flagEffects) {
+		FlagMasks masks{0, 0, 0};
+		for (size_t i = 0; i < 8; i++) {
+			const uint8_t bit = flagBit(static_cast<FlagName>(i));
+			switch (static_cast<FlagState>((flagEffects >> (i * 2)) & 0x03)) {
+				case FlagState::SET: masks.set |= bit; break;
+				case FlagState::RESET: masks.reset |= bit; break;
+				case FlagState::DEFER: masks.computed |= bit; break;
+				default: break;
+			}
+		}
+		return masks;
+	}
+
+	// Width of the additions and subtractions flags are computed from, as the number of
+	// bits half carry and carry are moved down by to sit at bits 4 and 8
+	enum class FlagWidth : uint8_t {
+		BITS8 = 0,
+		BITS16 = 8
+	};
+
+	/**
+	 * Inputs and result of the last flag-setting operation. Only the flags in mask are taken
+	 * from it, and they are computed each time they are read rather than when the operation
+	 * runs, as most are overwritten by the next ALU operation before anything looks at them.
+	 * Bitwise operations record their result with zero inputs, which only defines Z.
+	 */
+	struct LazyFlags {
+		uint16_t x;
+		uint16_t y;
+		// x + y or x - y, including any carry, without truncation
+		uint32_t result;
+		uint8_t mask;
+		FlagWidth width;
+
+		constexpr uint8_t evaluate() const {
+			// Bit n of x ^ y ^ result is the carry or borrow into bit n
+			const uint32_t carries = (x ^ y ^ result) >> static_cast<uint8_t>(width);
+			uint8_t f = (result & 0xFF) == 0 ? FLAG_Z : 0;
+			f |= static_cast<uint8_t>((carries & 0x10) << 1);
+			f |= static_cast<uint8_t>((carries & 0x100) >> 4);
+			return f & mask;
+		}
+	};
+
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef JAGCE_LCD
+#define JAGCE_LCD
+
+#include <array>
+#include <cstdint>
+
+#include "interrupts.hpp"
+#include "scheduler.hpp"
+
+namespace jagce {
+
+	class Ppu;
+
+	enum class LcdMode : uint8_t {
+		HBLANK = 0,
+		VBLANK = 1,
+		OAM_SEARCH = 2,
+		TRANSFER = 3,
+	};
+
+	/**
+	 * LCD timing and registers 0xFF40 to 0xFF4B. Each mode transition is a scheduled
+	 * LCD_MODE event rather than a per-cycle count, so LY and the STAT mode only change
+	 * at the cycle of a transition. Requests the VBlank interrupt on entering line 144 and
+	 * the STAT interrupt for the sources enabled in STAT. With a Ppu set, each visible line
+	 * is rendered as its transfer ends, with the registers as they are then.
+	 */
+	class Lcd {
+	public:
+		constexpr static uint16_t FIRST_REGISTER = 0xFF40;
+		constexpr static uint16_t LAST_REGISTER = 0xFF4B;
+		constexpr static uint16_t LCDC = 0xFF40;
+		constexpr static uint16_t STAT = 0xFF41;
+		constexpr static uint16_t SCY = 0xFF42;
+		constexpr static uint16_t SCX = 0xFF43;
+		constexpr static uint16_t LY = 0xFF44;
+		constexpr static uint16_t LYC = 0xFF45;
+		constexpr static uint16_t BGP = 0xFF47;
+		constexpr static uint16_t OBP0 = 0xFF48;
+		constexpr static uint16_t OBP1 = 0xFF49;
+		constexpr static uint16_t WY = 0xFF4A;
+		constexpr static uint16_t WX = 0xFF4B;
+
+		constexpr static uint64_t OAM_SEARCH_CYCLES = 80;
+		constexpr static uint64_t TRANSFER_CYCLES = 172;
+		constexpr static uint64_t HBLANK_CYCLES = 204;
+		constexpr static uint64_t LINE_CYCLES = OAM_SEARCH_CYCLES + TRANSFER_CYCLES + HBLANK_CYCLES;
+		constexpr static uint8_t VISIBLE_LINES = 144;
+		constexpr static uint8_t LINES = 154;
+
+		Lcd(Scheduler& scheduler, Interrupts& interrupts);
+
+		uint8_t read(uint16_t address) const;
+		void write(uint16_t address, uint8_t value);
+
+		// Handles LCD_MODE
+		void nextMode();
+
+		LcdMode getMode() const { return mode; }
+		uint8_t getLine() const { return line; }
+		bool isOn() const { return registers[LCDC - FIRST_REGISTER] & 0x80; }
+
+		// The renderer of visible lines, or nullptr for none
+		void setPpu(Ppu* ppu) { this->ppu = ppu; }
+
+	private:
+		void enterMode(LcdMode mode, uint64_t cycles);
+		void setLine(uint8_t line);
+		bool statEnabled(uint8_t bit) const { return registers[STAT - FIRST_REGISTER] & bit; }
+
+		Scheduler& scheduler;
+		Interrupts& interrupts;
+		std::array<uint8_t, LAST_REGISTER - FIRST_REGISTER + 1> registers;
+		LcdMode mode;
+		uint8_t line;
+		// Cycle the pending mode transition is due
+		uint64_t transition;
+		Ppu* ppu;
+	};
+
+}
+
+#endif
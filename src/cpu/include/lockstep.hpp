@@ -0,0 +1,348 @@
+#ifndef JAGCE_LOCKSTEP
+#define JAGCE_LOCKSTEP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "block_cache.hpp"
+#include "cycles.hpp"
+#include "executor.hpp"
+#include "registers.hpp"
+
+namespace jagce {
+
+	// Bit n set for lane n
+	using LaneMask = uint64_t;
+
+	// One element per lane, as a GCC vector the compiler maps onto SSE, AVX2 or AVX-512
+	// registers depending on the target
+	template <typename T, size_t LANES>
+	struct LaneVectorOf {
+		typedef T type __attribute__((vector_size(sizeof(T) * LANES)));
+	};
+
+	template <typename T, size_t LANES>
+	using LaneVector = typename LaneVectorOf<T, LANES>::type;
+
+	/**
+	 * Register files of many instances in struct-of-arrays form: each 8-bit register is a
+	 * vector holding that register of every lane. F is kept whole rather than lazily.
+	 */
+	template <size_t LANES>
+	struct LaneRegisters {
+		using Bytes = LaneVector<uint8_t, LANES>;
+
+		std::array<Bytes, 8> r8;
+		std::array<uint16_t, LANES> sp;
+		std::array<uint16_t, LANES> pc;
+
+		Registers get(size_t lane) const {
+			Registers registers{};
+			for (size_t i = 0; i < REGISTER_F; i++) {
+				registers.r8[i] = r8[i][lane];
+			}
+			registers.setF(r8[REGISTER_F][lane]);
+			registers.sp = sp[lane];
+			registers.pc = pc[lane];
+			return registers;
+		}
+
+		void set(size_t lane, const Registers& registers) {
+			for (size_t i = 0; i < REGISTER_F; i++) {
+				r8[i][lane] = registers.r8[i];
+			}
+			r8[REGISTER_F][lane] = registers.f();
+			sp[lane] = registers.sp;
+			pc[lane] = registers.pc;
+		}
+	};
+
+	/**
+	 * Runs the same decoded blocks on many instances at once, one per SIMD lane. Loads
+	 * between registers and 8-bit arithmetic and logic on registers and immediates are
+	 * lane-wise vector operations, with flags computed as LazyFlags would. Other
+	 * instructions, which touch memory or 16-bit registers, run on each active lane in
+	 * turn through a scalar executor on that lane's memory.
+	 *
+	 * Lanes whose PC isn't at the block being run are masked off and left unchanged.
+	 * Blocks are decoded once from a shared cache, so the instances must run the same
+	 * code and must not modify it.
+	 */
+	template <size_t LANES>
+	class LockstepExecutor {
+		static_assert(LANES >= 8 && LANES <= 64 && (LANES & (LANES - 1)) == 0,
+				"Lanes must be a power of two from 8 to 64");
+
+	public:
+		using Bytes = LaneVector<uint8_t, LANES>;
+		using Words = LaneVector<uint16_t, LANES>;
+		constexpr static LaneMask ALL_LANES = LANES == 64 ? ~LaneMask{0} : (LaneMask{1} << LANES) - 1;
+
+		// One memory per lane, each holding the whole address space
+		explicit LockstepExecutor(const std::vector<RandomAccessMemory*>& memories);
+
+		LaneRegisters<LANES>& getRegisters() { return registers; }
+		const LaneRegisters<LANES>& getRegisters() const { return registers; }
+
+		LaneMask lanesAt(uint16_t pc) const;
+
+		// Runs the block on the lanes in active, leaving their PC after it. Returns the
+		// clock cycles each lane took, counting a conditional branch closing the block as
+		// not taken since lanes may disagree on it.
+		uint64_t run(const DecodedBlock& block, LaneMask active);
+
+		/**
+		 * Runs the block at the lowest PC of any lane on every lane at that PC, so lanes
+		 * that diverged catch up with the others and run together again once their PCs
+		 * meet. Returns the lanes that ran.
+		 */
+		LaneMask step(BlockCache& cache);
+
+	private:
+		struct Lane {
+			Registers registers;
+			Executor executor;
+
+			explicit Lane(RandomAccessMemory& memory) : registers{}, executor{registers, memory} {}
+		};
+
+		constexpr static int A = RegisterNames::A.getId();
+
+		static uint8_t payload(uint8_t operand) {
+			return operand & 0x0F;
+		}
+
+		static OperandKind operandKind(uint8_t operand) {
+			return static_cast<OperandKind>(operand >> 4);
+		}
+
+		static Bytes broadcast(uint8_t value) { return Bytes{} + value; }
+		static Bytes select(Bytes mask, Bytes a, Bytes b) { return (a & mask) | (b & ~mask); }
+
+		static bool isVectorOp(const MicroOp& op);
+		Bytes read8(const MicroOp& op, uint8_t operand) const;
+		Bytes carryIn(const MicroOp& op, uint8_t operand) const;
+		void write8(uint8_t operand, Bytes value, Bytes mask);
+		void arithmetic(const MicroOp& op, Bytes x, Bytes y, Bytes carry, bool subtract, int destination, Bytes mask);
+		void flags(const MicroOp& op, Bytes result, Bytes carries, Bytes mask);
+		void executeScalar(const MicroOp& op, LaneMask active);
+
+		LaneRegisters<LANES> registers;
+		std::vector<std::unique_ptr<Lane>> lanes;
+	};
+
+	template <size_t LANES>
+	LockstepExecutor<LANES>::LockstepExecutor(const std::vector<RandomAccessMemory*>& memories)
+		: registers{}, lanes{} {
+		if (memories.size() != LANES) {
+			throw std::invalid_argument("Lockstep executor needs one memory per lane");
+		}
+		for (RandomAccessMemory* memory : memories) {
+			lanes.push_back(std::make_unique<Lane>(*memory));
+		}
+	}
+
+	template <size_t LANES>
+	LaneMask LockstepExecutor<LANES>::lanesAt(uint16_t pc) const {
+		LaneMask lanes = 0;
+		for (size_t lane = 0; lane < LANES; lane++) {
+			lanes |= static_cast<LaneMask>(registers.pc[lane] == pc) << lane;
+		}
+		return lanes;
+	}
+
+	template <size_t LANES>
+	uint64_t LockstepExecutor<LANES>::run(const DecodedBlock& block, LaneMask active) {
+		active &= ALL_LANES;
+		Bytes mask{};
+		for (size_t lane = 0; lane < LANES; lane++) {
+			mask[lane] = (active >> lane) & 1 ? 0xFF : 0x00;
+		}
+
+		uint64_t cycles = 0;
+		for (const DecodedInstruction& instruction : block.instructions) {
+			const MicroOp& op = instruction.op;
+			cycles += opcodeCycles(instruction.opcode);
+			if (!isVectorOp(op)) {
+				executeScalar(op, active);
+				continue;
+			}
+
+			switch (op.kind) {
+				case MicroOpKind::LOAD8:
+					write8(op.a, read8(op, op.b), mask);
+					break;
+				case MicroOpKind::ADD8:
+					arithmetic(op, read8(op, op.a), read8(op, op.b), carryIn(op, op.b), false, payload(op.a), mask);
+					break;
+				case MicroOpKind::SUB8:
+					arithmetic(op, registers.r8[A], read8(op, op.a), carryIn(op, op.a), true, A, mask);
+					break;
+				case MicroOpKind::COMPARE8:
+					arithmetic(op, registers.r8[A], read8(op, op.a), Bytes{}, true, -1, mask);
+					break;
+				case MicroOpKind::INCREMENT8:
+					arithmetic(op, read8(op, op.a), broadcast(1), Bytes{}, false, payload(op.a), mask);
+					break;
+				case MicroOpKind::DECREMENT8:
+					arithmetic(op, read8(op, op.a), broadcast(1), Bytes{}, true, payload(op.a), mask);
+					break;
+				case MicroOpKind::AND8:
+				case MicroOpKind::OR8:
+				case MicroOpKind::XOR8:
+					{
+						const Bytes y = read8(op, op.a);
+						const Bytes x = registers.r8[A];
+						const Bytes result = op.kind == MicroOpKind::AND8 ? (x & y)
+							: op.kind == MicroOpKind::OR8 ? (x | y) : (x ^ y);
+						registers.r8[A] = select(mask, result, x);
+						flags(op, result, Bytes{}, mask);
+						break;
+					}
+				default:
+					break;
+			}
+		}
+
+		const uint16_t end = static_cast<uint16_t>(block.end);
+		for (size_t lane = 0; lane < LANES; lane++) {
+			if ((active >> lane) & 1) {
+				registers.pc[lane] = end;
+			}
+		}
+		return cycles;
+	}
+
+	template <size_t LANES>
+	LaneMask LockstepExecutor<LANES>::step(BlockCache& cache) {
+		uint16_t lowest = registers.pc[0];
+		for (size_t lane = 1; lane < LANES; lane++) {
+			lowest = std::min(lowest, registers.pc[lane]);
+		}
+		const LaneMask active = lanesAt(lowest);
+		run(cache.getBlock(lowest), active);
+		return active;
+	}
+
+	template <size_t LANES>
+	bool LockstepExecutor<LANES>::isVectorOp(const MicroOp& op) {
+		const auto isValue = [](uint8_t operand) {
+			switch (operandKind(operand)) {
+				case OperandKind::REGISTER:
+				case OperandKind::REGISTER8_PLUS_FLAG:
+					return payload(operand) < REGISTER_F;
+				case OperandKind::IMMEDIATE8:
+				case OperandKind::IMMEDIATE8_PLUS_FLAG:
+					return true;
+				default:
+					return false;
+			}
+		};
+		const auto isRegister = [](uint8_t operand) {
+			return operandKind(operand) == OperandKind::REGISTER && payload(operand) < REGISTER_F;
+		};
+
+		switch (op.kind) {
+			case MicroOpKind::NOP:
+				return true;
+			case MicroOpKind::LOAD8:
+				return isRegister(op.a) && isValue(op.b);
+			case MicroOpKind::ADD8:
+				return isRegister(op.a) && isValue(op.b);
+			case MicroOpKind::SUB8:
+			case MicroOpKind::COMPARE8:
+			case MicroOpKind::AND8:
+			case MicroOpKind::OR8:
+			case MicroOpKind::XOR8:
+				return isValue(op.a);
+			case MicroOpKind::INCREMENT8:
+			case MicroOpKind::DECREMENT8:
+				return isRegister(op.a);
+			default:
+				return false;
+		}
+	}
+
+	template <size_t LANES>
+	typename LockstepExecutor<LANES>::Bytes LockstepExecutor<LANES>::read8(const MicroOp& op, uint8_t operand) const {
+		switch (operandKind(operand)) {
+			case OperandKind::IMMEDIATE8:
+			case OperandKind::IMMEDIATE8_PLUS_FLAG:
+				return broadcast(static_cast<uint8_t>(op.immediate));
+			default:
+				return registers.r8[payload(operand)];
+		}
+	}
+
+	template <size_t LANES>
+	typename LockstepExecutor<LANES>::Bytes LockstepExecutor<LANES>::carryIn(const MicroOp& op, uint8_t operand) const {
+		switch (operandKind(operand)) {
+			case OperandKind::REGISTER8_PLUS_FLAG:
+			case OperandKind::IMMEDIATE8_PLUS_FLAG:
+				{
+					const Bytes bit = registers.r8[REGISTER_F] & flagBit(static_cast<FlagName>(op.aux));
+					return static_cast<Bytes>(bit != 0) & 1;
+				}
+			default:
+				return Bytes{};
+		}
+	}
+
+	template <size_t LANES>
+	void LockstepExecutor<LANES>::write8(uint8_t operand, Bytes value, Bytes mask) {
+		Bytes& destination = registers.r8[payload(operand)];
+		destination = select(mask, value, destination);
+	}
+
+	template <size_t LANES>
+	void LockstepExecutor<LANES>::arithmetic(const MicroOp& op, Bytes x, Bytes y, Bytes carry, bool subtract,
+			int destination, Bytes mask) {
+		// Widened so bit 8 holds the carry or borrow out
+		const Words wx = __builtin_convertvector(x, Words);
+		const Words wy = __builtin_convertvector(y, Words);
+		const Words wc = __builtin_convertvector(carry, Words);
+		const Words result = subtract ? wx - wy - wc : wx + wy + wc;
+		const Words carries = (wx ^ wy ^ result) >> 4;
+
+		const Bytes truncated = __builtin_convertvector(result, Bytes);
+		if (destination >= 0) {
+			write8(static_cast<uint8_t>(destination), truncated, mask);
+		}
+		// Bits 0 and 4 of carries are the half carry and carry, moved to H and C
+		const Words packed = ((carries & 0x01) << 5) | ((carries & 0x10));
+		flags(op, truncated, __builtin_convertvector(packed, Bytes), mask);
+	}
+
+	template <size_t LANES>
+	void LockstepExecutor<LANES>::flags(const MicroOp& op, Bytes result, Bytes carries, Bytes mask) {
+		const FlagMasks masks = flagMasks(op.flagEffects);
+		if (masks.written() == 0) {
+			return;
+		}
+		const Bytes zero = static_cast<Bytes>(result == 0) & FLAG_Z;
+		const Bytes computed = (zero | carries) & masks.computed;
+		Bytes& f = registers.r8[REGISTER_F];
+		f = select(mask, (f & static_cast<uint8_t>(~masks.written())) | masks.set | computed, f);
+	}
+
+	template <size_t LANES>
+	void LockstepExecutor<LANES>::executeScalar(const MicroOp& op, LaneMask active) {
+		for (size_t lane = 0; lane < LANES; lane++) {
+			if (!((active >> lane) & 1)) {
+				continue;
+			}
+			Lane& scalar = *lanes[lane];
+			scalar.registers = registers.get(lane);
+			scalar.executor.execute(op);
+			registers.set(lane, scalar.registers);
+		}
+	}
+
+}
+
+#endif
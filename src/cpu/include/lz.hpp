@@ -0,0 +1,26 @@
+#ifndef JAGCE_LZ
+#define JAGCE_LZ
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace jagce {
+
+	/**
+	 * Byte-oriented LZ77 compression in the style of LZ4 blocks. Each sequence is a token
+	 * holding the literal and match lengths, the literals, and a 16-bit offset back into
+	 * the output for the match. It is built for speed over ratio; emulator memory is mostly
+	 * runs and repeats and compresses well regardless.
+	 */
+
+	// Appends the compressed form of the input to out, returning the number of bytes appended
+	size_t lzCompress(uint8_t const * in, size_t size, std::vector<uint8_t>& out);
+
+	// Decompresses exactly outSize bytes, throwing std::invalid_argument if the input is
+	// corrupt or doesn't decompress to exactly outSize bytes
+	void lzDecompress(uint8_t const * in, size_t size, uint8_t* out, size_t outSize);
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef JAGCE_MACHINE
+#define JAGCE_MACHINE
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "block_cache.hpp"
+#include "executor.hpp"
+#include "interrupts.hpp"
+#include "lcd.hpp"
+#include "memory_bus.hpp"
+#include "ppu.hpp"
+#include "registers.hpp"
+#include "scheduler.hpp"
+#include "timer.hpp"
+#include "trace.hpp"
+#include "watched_memory.hpp"
+
+namespace jagce {
+
+	/**
+	 * The CPU together with the timer, LCD and interrupt registers on one clock. The CPU
+	 * runs cached blocks in bursts up to the next scheduled event, skipping the iterations
+	 * of idle loops, and the events due are handled between bursts. A HALT jumps the clock
+	 * straight to the next event until an enabled interrupt is requested.
+	 *
+	 * Memory below 0xFF00 is plain RAM, the 0xFF00 page holds the I/O registers and HRAM.
+	 * The PPU renders each visible line from it as the LCD finishes transferring the line.
+	 *
+	 * With a TraceWriter set, every instruction run is recorded, and idle loops run each
+	 * of their iterations instead of skipping them so the trace misses none.
+	 */
+	class Machine {
+	public:
+		Machine();
+		Machine(const Machine&) = delete;
+		Machine& operator=(const Machine&) = delete;
+
+		// Runs for at least the given clock cycles, returns the cycles actually run
+		uint64_t run(uint64_t cycles);
+
+		Registers& getRegisters() { return registers; }
+		RandomAccessMemory& getMemory() { return memory; }
+		Scheduler& getScheduler() { return scheduler; }
+		Interrupts& getInterrupts() { return interrupts; }
+		const Lcd& getLcd() const { return lcd; }
+		const Ppu& getPpu() const { return ppu; }
+		bool isHalted() const { return halted; }
+
+		// The trace to record to, or nullptr to stop tracing. The writer must outlive its use.
+		void setTrace(TraceWriter* trace) { this->trace = trace; }
+
+	private:
+		class IoPorts : public MemoryHandler {
+		public:
+			IoPorts(Machine& machine) : machine{machine}, other{} {}
+			uint8_t read(uint16_t address) override;
+			void write(uint16_t address, uint8_t value) override;
+
+		private:
+			Machine& machine;
+			// Registers without a device yet, and HRAM
+			std::array<uint8_t, 0x100> other;
+		};
+
+		void handleDueEvents();
+
+		Registers registers;
+		Scheduler scheduler;
+		Interrupts interrupts;
+		Timer timer;
+		Lcd lcd;
+		IoPorts io;
+		std::vector<uint8_t> ram;
+		MemoryBus bus;
+		WatchedMemory memory;
+		BlockCache cache;
+		BasicExecutor<WatchedMemory> executor;
+		Ppu ppu;
+		bool halted;
+		TraceWriter* trace;
+	};
+
+}
+
+#endif
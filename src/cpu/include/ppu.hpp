@@ -0,0 +1,59 @@
+#ifndef JAGCE_PPU
+#define JAGCE_PPU
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "lcd.hpp"
+#include "ram.hpp"
+
+namespace jagce {
+
+	/**
+	 * Pixel indices of a row of a 2bpp tile, leftmost in the lowest byte. The row is two
+	 * bit planes, lo holding bit 0 of each pixel and hi bit 1, leftmost in bit 7.
+	 */
+	uint64_t decodeTileRow(uint8_t lo, uint8_t hi);
+
+	/**
+	 * Renders the background, window and sprites a line at a time from video memory and
+	 * OAM, read through a RandomAccessMemory. The frame holds shades from 0 (white) to
+	 * 3 (black) after the palettes are applied.
+	 *
+	 * Tile rows are decoded several tiles at a time by spreading the bit planes across
+	 * vector lanes with byte shuffles, and palettes and sprite priority are applied to
+	 * whole vectors of pixels.
+	 */
+	class Ppu {
+	public:
+		constexpr static size_t WIDTH = 160;
+		constexpr static size_t HEIGHT = Lcd::VISIBLE_LINES;
+		constexpr static uint16_t VRAM = 0x8000;
+		constexpr static size_t VRAM_SIZE = 0x2000;
+		constexpr static uint16_t OAM = 0xFE00;
+		constexpr static size_t OAM_SIZE = 0xA0;
+		constexpr static size_t SPRITES_PER_LINE = 10;
+
+		using Frame = std::array<uint8_t, WIDTH * HEIGHT>;
+
+		explicit Ppu(const RandomAccessMemory& memory);
+
+		// Renders a visible line with the LCD's registers
+		void renderLine(uint8_t line, const Lcd& lcd);
+
+		const Frame& getFrame() const { return frame; }
+		// Frames whose last line has been rendered
+		uint64_t getFrameCount() const { return frames; }
+
+	private:
+		const RandomAccessMemory& memory;
+		Frame frame;
+		// Line of the window to draw next, which only advances on lines showing it
+		uint8_t windowLine;
+		uint64_t frames;
+	};
+
+}
+
+#endif
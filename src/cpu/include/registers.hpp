@@ -0,0 +1,94 @@
+#ifndef JAGCE_REGISTERS
+#define JAGCE_REGISTERS
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "lazy_flags.hpp"
+#include "register_names.hpp"
+
+namespace jagce {
+
+	// F sits after the 8-bit registers, which are indexed by their RegisterName id
+	constexpr size_t REGISTER_F = 7;
+
+	/**
+	 * CPU register file. The 8-bit registers and the register pairs are accessed by the
+	 * id of their RegisterName. Flags written by ALU operations are kept in lazyFlags and
+	 * only computed when F is read, the bits of F they cover are always zero in r8.
+	 */
+	struct Registers {
+		std::array<uint8_t, 8> r8;
+		uint16_t sp;
+		uint16_t pc;
+		LazyFlags lazyFlags;
+
+		uint8_t get8(int id) const { return r8[id]; }
+		void set8(int id, uint8_t value) { r8[id] = value; }
+
+		uint8_t f() const { return r8[REGISTER_F] | lazyFlags.evaluate(); }
+
+		void setF(uint8_t value) {
+			r8[REGISTER_F] = value & 0xF0;
+			lazyFlags.mask = 0;
+		}
+
+		// Applies the flag effects of an operation, leaving the computed flags to be
+		// evaluated from its inputs and result when F is next read
+		void deferFlags(FlagMasks masks, FlagWidth width, uint16_t x, uint16_t y, uint32_t result) {
+			if (lazyFlags.mask & ~masks.written()) {
+				// Flags of the previous operation that this one leaves unchanged
+				r8[REGISTER_F] |= lazyFlags.evaluate();
+			}
+			r8[REGISTER_F] = static_cast<uint8_t>((r8[REGISTER_F] & ~masks.written()) | masks.set);
+			lazyFlags = LazyFlags{x, y, result, masks.computed, width};
+		}
+
+		uint16_t get16(int id) const {
+			switch (id) {
+				case RegisterNames::SP.getId(): return sp;
+				case RegisterNames::PC.getId(): return pc;
+				case RegisterNames::AF.getId(): return static_cast<uint16_t>((r8[pairHigh(id)] << 8) | f());
+				default: return static_cast<uint16_t>((r8[pairHigh(id)] << 8) | r8[pairLow(id)]);
+			}
+		}
+
+		void set16(int id, uint16_t value) {
+			switch (id) {
+				case RegisterNames::SP.getId(): sp = value; break;
+				case RegisterNames::PC.getId(): pc = value; break;
+				default:
+					r8[pairHigh(id)] = static_cast<uint8_t>(value >> 8);
+					r8[pairLow(id)] = static_cast<uint8_t>(value);
+					if (id == RegisterNames::AF.getId()) {
+						setF(static_cast<uint8_t>(value));
+					}
+			}
+		}
+
+		bool operator==(const Registers& other) const {
+			for (size_t i = 0; i < REGISTER_F; i++) {
+				if (this->r8[i] != other.r8[i]) {
+					return false;
+				}
+			}
+			return this->f() == other.f() && this->sp == other.sp && this->pc == other.pc;
+		}
+
+	private:
+		// Halves of AF, BC, DE and HL, by 16-bit register id
+		constexpr static size_t pairHigh(int id) {
+			constexpr std::array<size_t, 4> high{ 0, 1, 3, 5 };
+			return high[id - RegisterNames::AF.getId()];
+		}
+
+		constexpr static size_t pairLow(int id) {
+			constexpr std::array<size_t, 4> low{ REGISTER_F, 2, 4, 6 };
+			return low[id - RegisterNames::AF.getId()];
+		}
+	};
+
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef JAGCE_REWIND
+#define JAGCE_REWIND
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "ram.hpp"
+#include "registers.hpp"
+#include "save_state.hpp"
+#include "static_ram.hpp"
+
+namespace jagce {
+
+	/**
+	 * Keeps the most recent captures of the registers and memory regions in a fixed amount
+	 * of storage, dropping the oldest captures to make room. Every keyframeInterval-th
+	 * capture is a keyframe holding the whole of memory; the others only hold the bytes
+	 * that differ from their keyframe. Both are stored as runs of XOR against the keyframe
+	 * (against zero for keyframes themselves), so unchanged memory costs almost nothing.
+	 *
+	 * Nothing is allocated after the regions are added. Stepping back to a capture made
+	 * after the same keyframe only writes the bytes in the two deltas, plus the pages
+	 * written since, when a region is a StaticRAM with dirty pages and the deltas are
+	 * small enough for that to be cheaper. Otherwise the whole region is written. The
+	 * dirty pages of such a StaticRAM are cleared by every capture and step.
+	 *
+	 * Like a SaveState load, restoring writes memory through the regions given, so caches
+	 * built from memory are only invalidated if the regions are the memory they watch.
+	 * Also like a SaveState, only registers and memory are captured; the scheduler, timer,
+	 * LCD and interrupt state of a Machine are left as they are when stepping back.
+	 */
+	class RewindBuffer {
+	public:
+		constexpr static size_t DEFAULT_KEYFRAME_INTERVAL = 30;
+
+		// Holds at most maxCaptures captures in storageSize bytes
+		RewindBuffer(Registers& registers, size_t maxCaptures, size_t storageSize,
+			size_t keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+
+		// Regions can't be added after the first capture, throws std::logic_error
+		void addMemory(RandomAccessMemory& memory);
+
+		template <size_t N, size_t DIRTY_PAGE_SIZE>
+		void addMemory(StaticRAM<N, DIRTY_PAGE_SIZE>& ram) {
+			if constexpr (DIRTY_PAGE_SIZE == 0) {
+				addMemory(static_cast<RandomAccessMemory&>(ram));
+			} else {
+				addRegion(ram, DIRTY_PAGE_SIZE, [&ram](size_t page) { return ram.isPageDirty(page); },
+					[&ram]() { ram.clearDirtyPages(); });
+			}
+		}
+
+		// Throws std::length_error if a keyframe doesn't fit in the storage
+		void capture();
+
+		// Restores the most recent capture and drops it, false when there are none left
+		bool stepBack();
+
+		void clear();
+
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+		// Bytes of storage used by the captures held
+		size_t bytesUsed() const { return used; }
+
+	private:
+		struct Region {
+			RandomAccessMemory* memory;
+			// Of the region in the concatenation of all regions
+			size_t offset;
+			size_t size;
+			// Dirty page tracking, with a page size of 0 when the memory has none
+			size_t pageSize;
+			std::function<bool(size_t)> isPageDirty;
+			std::function<void()> clearDirtyPages;
+			// Pages dirty when a step started, as restoring dirties pages itself
+			std::vector<uint8_t> dirty;
+		};
+
+		struct Capture {
+			uint64_t sequence;
+			uint64_t keyframeSequence;
+			// Captures since the keyframe
+			size_t sinceKeyframe;
+			// Of the encoded runs in storage
+			size_t offset;
+			size_t size;
+			// Of the keyframe's runs, which outlive the captures depending on them
+			size_t keyframeOffset;
+			size_t keyframeSize;
+			RegisterState registers;
+
+			bool isKeyframe() const { return sequence == keyframeSequence; }
+		};
+
+		void addRegion(RandomAccessMemory& memory, size_t pageSize, std::function<bool(size_t)> isPageDirty,
+			std::function<void()> clearDirtyPages);
+
+		Capture& at(size_t i) { return captures[(first + i) % captures.size()]; }
+		void capture(bool asKeyframe);
+		size_t allocate(size_t size);
+		void dropOldest();
+		void decodeKeyframe(const Capture& capture);
+		uint8_t const * xorIntoClean(const Region& region, uint8_t const * runs);
+		void restoreDirty(const Region& region, uint8_t const * runs);
+
+		Registers& registers;
+		std::vector<Region> regions;
+		size_t keyframeInterval;
+
+		std::vector<Capture> captures;
+		size_t first;
+		size_t count;
+
+		std::vector<uint8_t> storage;
+		// Where the next capture goes, unless it has to wrap around
+		size_t head;
+		size_t used;
+		uint64_t nextSequence;
+
+		// The keyframe deltas are taken against, with every region concatenated
+		std::vector<uint8_t> keyframe;
+		uint64_t keyframeSequence;
+		// Runs of a capture before they are copied to storage, and the state being restored
+		std::vector<uint8_t> scratch;
+
+		// The capture memory last matched, apart from dirty pages
+		Capture synced;
+		bool isSynced;
+	};
+
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef JAGCE_SAVE_STATE
+#define JAGCE_SAVE_STATE
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ram.hpp"
+#include "registers.hpp"
+
+namespace jagce {
+
+	constexpr uint32_t SAVE_STATE_MAGIC = 0x5353474A; // "JGSS"
+	constexpr uint16_t SAVE_STATE_VERSION = 1;
+
+	enum class SaveStateSection : uint32_t {
+		REGISTERS = 1,
+		// Memory regions follow in the order they were added, as MEMORY + their index
+		MEMORY = 0x100
+	};
+
+	/**
+	 * Fixed header of a save state, written as is in host byte order. Everything after it is
+	 * the payload of sections, compressed with lzCompress when COMPRESSED is set.
+	 */
+	struct SaveStateHeader {
+		static constexpr uint16_t COMPRESSED = 0x0001;
+
+		uint32_t magic;
+		uint16_t version;
+		uint16_t flags;
+		uint32_t sectionCount;
+		uint32_t reserved;
+		uint64_t payloadSize;
+		uint64_t storedSize;
+	};
+
+	// Sections are padded to SECTION_ALIGNMENT so their data can be copied from aligned storage
+	struct SaveStateSectionHeader {
+		static constexpr size_t SECTION_ALIGNMENT = 8;
+
+		SaveStateSection id;
+		uint32_t reserved;
+		uint64_t size;
+	};
+
+	// Register file with the deferred flags folded into F, so its layout doesn't depend on LazyFlags
+	struct RegisterState {
+		std::array<uint8_t, 8> r8;
+		uint16_t sp;
+		uint16_t pc;
+	};
+
+	static_assert(sizeof(SaveStateHeader) == 32, "Save state header layout is part of the format");
+	static_assert(sizeof(SaveStateSectionHeader) == 16, "Section header layout is part of the format");
+	static_assert(sizeof(RegisterState) == 12, "Register state layout is part of the format");
+
+	/**
+	 * Saves and restores the registers and memory regions of an emulator. The decoder is
+	 * stateless and the executor only holds references to the registers and memory, so for
+	 * a bare executor these are the whole of the state; caches built from memory such as a
+	 * BlockCache are left to be invalidated by the writes a load makes.
+	 *
+	 * A Machine holds more: the clock and pending events of its scheduler, the timer, LCD
+	 * and interrupt registers, and whether it is halted. None of that is saved, so a
+	 * Machine restored from a save resumes with the peripheral timing it had before loading.
+	 *
+	 * Memory regions are copied with readBytes and writeBytes, so saving and loading are a
+	 * copy of each region unless compression is asked for.
+	 */
+	class SaveState {
+	public:
+		explicit SaveState(Registers& registers);
+
+		// Regions are identified by the order they are added, which must match between save and load
+		void addMemory(RandomAccessMemory& memory);
+
+		// Size of a save without compression
+		size_t size() const;
+
+		// Replaces the contents of out with a save, reusing its capacity
+		void save(std::vector<uint8_t>& out, bool compress = false) const;
+
+		// Throws std::invalid_argument if the data is not a save of this version with the
+		// same regions, in which case nothing has been changed
+		void load(uint8_t const * data, size_t size);
+		void load(const std::vector<uint8_t>& data) { load(data.data(), data.size()); }
+
+	private:
+		Registers& registers;
+		std::vector<RandomAccessMemory*> memories;
+		// Uncompressed payload of compressed saves and loads, kept to avoid reallocating each time
+		mutable std::vector<uint8_t> payload;
+
+		size_t payloadSize() const;
+		void writePayload(uint8_t* out) const;
+		void readPayload(uint8_t const * in, size_t size, uint32_t sectionCount);
+	};
+
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef JAGCE_SCHEDULER
+#define JAGCE_SCHEDULER
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace jagce {
+
+	// Hardware events that happen at a known clock cycle, at most one of each pending
+	enum class ScheduledEvent : uint8_t {
+		TIMER_OVERFLOW,
+		LCD_MODE,
+	};
+
+	/**
+	 * Clock of the emulated machine and the events due on it, kept in a binary min-heap
+	 * indexed by event so rescheduling and cancelling don't search. Events due at the same
+	 * cycle come out in the order of ScheduledEvent.
+	 */
+	class Scheduler {
+	public:
+		constexpr static size_t EVENT_COUNT = 2;
+		constexpr static uint64_t NEVER = UINT64_MAX;
+
+		Scheduler();
+
+		uint64_t now() const { return time; }
+		void advance(uint64_t cycles) { time += cycles; }
+
+		// Cycle of the earliest pending event, NEVER without one
+		uint64_t nextTime() const { return count == 0 ? NEVER : heap[0].time; }
+
+		// Replaces any pending occurrence of the event
+		void schedule(ScheduledEvent event, uint64_t time);
+		void scheduleIn(ScheduledEvent event, uint64_t cycles) { schedule(event, time + cycles); }
+		void cancel(ScheduledEvent event);
+		bool isScheduled(ScheduledEvent event) const;
+		uint64_t timeOf(ScheduledEvent event) const;
+
+		// Removes and returns the earliest event due by now
+		std::optional<ScheduledEvent> popDue();
+
+	private:
+		struct Entry {
+			uint64_t time;
+			ScheduledEvent event;
+
+			bool operator<(const Entry& other) const {
+				return time < other.time || (time == other.time && event < other.event);
+			}
+		};
+
+		constexpr static uint8_t NOT_SCHEDULED = 0xFF;
+
+		void remove(size_t index);
+		void siftUp(size_t index);
+		void siftDown(size_t index);
+		void place(size_t index, Entry entry);
+
+		uint64_t time;
+		std::array<Entry, EVENT_COUNT> heap;
+		// Index of each event in heap, NOT_SCHEDULED when it isn't pending
+		std::array<uint8_t, EVENT_COUNT> positions;
+		size_t count;
+	};
+
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef JAGCE_TIMER
+#define JAGCE_TIMER
+
+#include <cstdint>
+
+#include "interrupts.hpp"
+#include "scheduler.hpp"
+
+namespace jagce {
+
+	/**
+	 * DIV, TIMA, TMA and TAC. Nothing is done per cycle: DIV is the scheduler clock since
+	 * it was last reset, and TIMA is brought up to date from the clock when it's accessed.
+	 * The cycle TIMA overflows is scheduled as TIMER_OVERFLOW, whose handler reloads TMA
+	 * and requests the timer interrupt.
+	 */
+	class Timer {
+	public:
+		constexpr static uint16_t DIV = 0xFF04;
+		constexpr static uint16_t TIMA = 0xFF05;
+		constexpr static uint16_t TMA = 0xFF06;
+		constexpr static uint16_t TAC = 0xFF07;
+
+		Timer(Scheduler& scheduler, Interrupts& interrupts);
+
+		uint8_t read(uint16_t address);
+		void write(uint16_t address, uint8_t value);
+
+		// Handles TIMER_OVERFLOW
+		void overflow();
+
+		// Cycles until DIV, or TIMA while it is enabled, next counts up
+		uint64_t cyclesUntilCount() const;
+
+	private:
+		bool enabled() const { return tac & 0x04; }
+		// Cycles per TIMA increment, which happen as this bit of the divider falls
+		uint64_t period() const;
+		uint64_t divider() const { return scheduler.now() - divReset; }
+
+		void sync();
+		void reschedule();
+
+		Scheduler& scheduler;
+		Interrupts& interrupts;
+		uint64_t divReset;
+		// Clock TIMA was last brought up to date at
+		uint64_t synced;
+		uint8_t tima;
+		uint8_t tma;
+		uint8_t tac;
+	};
+
+}
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef JAGCE_TRACE
+#define JAGCE_TRACE
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "block_cache.hpp"
+#include "cache_line.hpp"
+#include "mapped_rom.hpp"
+#include "micro_op.hpp"
+
+namespace jagce {
+
+	constexpr uint32_t TRACE_MAGIC = 0x5254474A; // "JGTR"
+	constexpr uint16_t TRACE_VERSION = 1;
+
+	// One executed instruction, with the clock cycle it started on
+	struct TraceRecord {
+		uint64_t cycle;
+		uint16_t pc;
+		// Opcode byte, or 0xCB00 plus the opcode for the CB page
+		uint16_t opcode;
+		uint32_t reserved;
+		MicroOp op;
+	};
+	static_assert(sizeof(TraceRecord) == 24, "Trace files hold records back to back");
+	static_assert(std::is_trivially_copyable_v<TraceRecord>, "Trace records are copied as bytes");
+
+	/**
+	 * Fixed header of a trace file, written as is in host byte order and followed by
+	 * recordCount TraceRecords, so a mapped file can be read in place.
+	 */
+	struct TraceHeader {
+		uint32_t magic;
+		uint16_t version;
+		uint16_t recordSize;
+		uint64_t recordCount;
+	};
+
+	/**
+	 * Lock-free ring of trace records between one producer and one consumer thread. Each
+	 * side owns one index and only reads the other's, keeping its own copy of it to go
+	 * back to the shared line only when the ring looks full or empty.
+	 */
+	class TraceRing {
+	public:
+		// Capacity is rounded up to a power of two
+		explicit TraceRing(size_t capacity);
+
+		size_t capacity() const { return records.size(); }
+
+		// Producer side, false when the ring is full
+		bool tryPush(const TraceRecord& record) {
+			const size_t head = producer.head;
+			if (head - producer.cachedTail == records.size()) {
+				producer.cachedTail = tail.load(std::memory_order_acquire);
+				if (head - producer.cachedTail == records.size()) {
+					return false;
+				}
+			}
+			records[head & mask] = record;
+			producer.head = head + 1;
+			this->head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer side, moves up to max records to out and returns how many
+		size_t pop(TraceRecord* out, size_t max);
+
+	private:
+		struct alignas(CACHE_LINE_SIZE) Producer {
+			size_t head;
+			size_t cachedTail;
+		};
+
+		struct alignas(CACHE_LINE_SIZE) Consumer {
+			size_t tail;
+			size_t cachedHead;
+		};
+
+		std::vector<TraceRecord> records;
+		size_t mask;
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> head;
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail;
+		Producer producer;
+		Consumer consumer;
+	};
+
+	/**
+	 * Writes the trace records pushed by the executing thread to a file from a background
+	 * thread. The executing thread only waits when it gets a whole ring ahead of the disk.
+	 */
+	class TraceWriter {
+	public:
+		constexpr static size_t DEFAULT_CAPACITY = 1 << 16;
+
+		// Throws std::runtime_error when the file can't be created
+		TraceWriter(const std::string& path, size_t capacity = DEFAULT_CAPACITY);
+		~TraceWriter();
+		TraceWriter(const TraceWriter&) = delete;
+		TraceWriter& operator=(const TraceWriter&) = delete;
+
+		void record(const TraceRecord& record) {
+			while (!ring.tryPush(record)) {
+				stalls++;
+				std::this_thread::yield();
+			}
+			recorded++;
+		}
+
+		// Records the first count instructions of a block that ran from the given cycle
+		void recordBlock(const DecodedBlock& block, uint64_t cycle, size_t count);
+
+		// Writes the rest of the ring and the header, rethrowing any error the writer thread had
+		void close();
+
+		uint64_t getRecorded() const { return recorded; }
+		// How many times the ring was full when recording
+		uint64_t getStalls() const { return stalls; }
+
+	private:
+		void drain();
+
+		TraceRing ring;
+		std::FILE* file;
+		std::atomic<bool> closing;
+		std::exception_ptr error;
+		uint64_t recorded;
+		uint64_t stalls;
+		uint64_t written;
+		std::thread writer;
+	};
+
+	// A trace file mapped read-only, throws std::runtime_error when it isn't a complete trace
+	class TraceFile {
+	public:
+		explicit TraceFile(const std::string& path);
+
+		size_t size() const { return count; }
+		TraceRecord const * begin() const { return records; }
+		TraceRecord const * end() const { return records + count; }
+		const TraceRecord& operator[](size_t i) const { return records[i]; }
+
+	private:
+		std::shared_ptr<const MappedFile> file;
+		TraceRecord const * records;
+		size_t count;
+	};
+
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include "batch_runner.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace jagce {
+
+	BatchRunner::BatchRunner(size_t instanceCount, size_t threads)
+		: instances{}, results(instanceCount), shares{}, workers{}, mutex{}, started{}, finished{},
+		batch{0}, running{0}, stopping{false}, batchCycles{0}, error{}, steals{0} {
+		if (instanceCount > std::numeric_limits<uint32_t>::max()) {
+			throw std::invalid_argument("Too many instances for a batch");
+		}
+		if (threads == 0) {
+			threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+		}
+
+		instances.reserve(instanceCount);
+		for (size_t i = 0; i < instanceCount; i++) {
+			instances.push_back(std::make_unique<Instance>());
+		}
+
+		shares = std::make_unique<Share[]>(threads);
+		for (size_t i = 0; i < threads; i++) {
+			shares[i].range.store(pack(0, 0));
+		}
+		workers.reserve(threads);
+		for (size_t i = 0; i < threads; i++) {
+			workers.emplace_back(&BatchRunner::work, this, i);
+		}
+	}
+
+	BatchRunner::~BatchRunner() {
+		{
+			std::lock_guard<std::mutex> lock{mutex};
+			stopping = true;
+		}
+		started.notify_all();
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+
+	void BatchRunner::run(uint64_t cycles) {
+		const size_t threads = workers.size();
+		std::unique_lock<std::mutex> lock{mutex};
+		for (size_t i = 0; i < threads; i++) {
+			const uint32_t begin = static_cast<uint32_t>(instances.size() * i / threads);
+			const uint32_t end = static_cast<uint32_t>(instances.size() * (i + 1) / threads);
+			shares[i].range.store(pack(begin, end), std::memory_order_relaxed);
+		}
+		batchCycles = cycles;
+		error = nullptr;
+		running = threads;
+		batch++;
+		started.notify_all();
+
+		finished.wait(lock, [this] { return running == 0; });
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	void BatchRunner::work(size_t worker) {
+		uint64_t seen = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock{mutex};
+				started.wait(lock, [this, seen] { return stopping || batch != seen; });
+				if (stopping) {
+					return;
+				}
+				seen = batch;
+			}
+
+			size_t index = 0;
+			while (take(worker, index) || (steal(worker) && take(worker, index))) {
+				runInstance(index);
+			}
+
+			std::lock_guard<std::mutex> lock{mutex};
+			if (--running == 0) {
+				finished.notify_one();
+			}
+		}
+	}
+
+	bool BatchRunner::take(size_t worker, size_t& index) {
+		std::atomic<uint64_t>& range = shares[worker].range;
+		uint64_t current = range.load(std::memory_order_acquire);
+		while (true) {
+			const uint32_t begin = static_cast<uint32_t>(current);
+			const uint32_t end = static_cast<uint32_t>(current >> 32);
+			if (begin >= end) {
+				return false;
+			}
+			if (range.compare_exchange_weak(current, pack(begin + 1, end), std::memory_order_acq_rel)) {
+				index = begin;
+				return true;
+			}
+		}
+	}
+
+	bool BatchRunner::steal(size_t worker) {
+		const size_t threads = workers.size();
+		for (size_t offset = 1; offset < threads; offset++) {
+			std::atomic<uint64_t>& victim = shares[(worker + offset) % threads].range;
+			uint64_t current = victim.load(std::memory_order_acquire);
+			while (true) {
+				const uint32_t begin = static_cast<uint32_t>(current);
+				const uint32_t end = static_cast<uint32_t>(current >> 32);
+				if (begin >= end) {
+					break;
+				}
+				// The back half, leaving the victim the instances it's about to take
+				const uint32_t middle = begin + (end - begin) / 2;
+				if (victim.compare_exchange_weak(current, pack(begin, middle), std::memory_order_acq_rel)) {
+					shares[worker].range.store(pack(middle, end), std::memory_order_release);
+					steals.fetch_add(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	void BatchRunner::runInstance(size_t index) {
+		Machine& machine = instances[index]->machine;
+		BatchResult& result = results[index];
+		try {
+			result.cycles = machine.run(batchCycles);
+		} catch (...) {
+			result.cycles = 0;
+			std::lock_guard<std::mutex> lock{mutex};
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+		result.registers = machine.getRegisters();
+		result.halted = machine.isHalted();
+	}
+
+}
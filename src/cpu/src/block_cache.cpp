@@ -0,0 +1,131 @@
+#include "block_cache.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "histogram.hpp"
+#include "opcode_info.hpp"
+
+namespace jagce {
+
+	BlockCache::BlockCache(WatchedMemory& memory)
+		: memory{memory}, decoder{}, blocks{}, dropped{},
+		blocksByPage((memory.size() + WatchedMemory::PAGE_SIZE - 1) / WatchedMemory::PAGE_SIZE) {
+		memory.setObserver(this);
+	}
+
+	BlockCache::~BlockCache() {
+		memory.setObserver(nullptr);
+	}
+
+	const DecodedBlock& BlockCache::getBlock(size_t address) {
+		dropped.clear();
+		auto it = blocks.find(address);
+		if (it != blocks.end()) {
+			return it->second;
+		}
+
+		DecodedBlock block = decodeBlock(address);
+		for (size_t page = block.start / WatchedMemory::PAGE_SIZE; page <= (block.end - 1) / WatchedMemory::PAGE_SIZE; page++) {
+			blocksByPage[page].push_back(block.start);
+			memory.watchPage(page);
+		}
+
+		return blocks.emplace(address, std::move(block)).first->second;
+	}
+
+	bool BlockCache::contains(size_t address) const {
+		return blocks.find(address) != blocks.end();
+	}
+
+	size_t BlockCache::size() const {
+		return blocks.size();
+	}
+
+	void BlockCache::invalidate(size_t index, size_t num) {
+		if (num == 0) {
+			return;
+		}
+
+		const size_t last = index + num - 1;
+		for (size_t page = index / WatchedMemory::PAGE_SIZE; page <= last / WatchedMemory::PAGE_SIZE && page < blocksByPage.size(); page++) {
+			// erase modifies the page's list, so work from a copy
+			const std::vector<size_t> starts = blocksByPage[page];
+			for (size_t start : starts) {
+				const DecodedBlock& block = blocks.at(start);
+				if (block.start <= last && index < block.end) {
+					erase(start);
+				}
+			}
+		}
+	}
+
+	void BlockCache::clear() {
+		blocks.clear();
+		dropped.clear();
+		for (size_t page = 0; page < blocksByPage.size(); page++) {
+			if (!blocksByPage[page].empty()) {
+				blocksByPage[page].clear();
+				memory.unwatchPage(page);
+			}
+		}
+	}
+
+	void BlockCache::memoryWritten(size_t index, size_t num) {
+		invalidate(index, num);
+	}
+
+	DecodedBlock BlockCache::decodeBlock(size_t address) const {
+		if (address >= memory.size()) {
+			throw std::out_of_range("Attempted decode of block at " + std::to_string(address) + " outside of memory");
+		}
+
+		const size_t available = std::min(memory.size() - address, MAX_BLOCK_INSTRUCTIONS * MAX_INSTRUCTION_LENGTH);
+		ByteCursor cursor{memory.readBytes(address, available), available};
+
+		DecodedBlock block{address, address, {}, {}, {}};
+		while (block.instructions.size() < MAX_BLOCK_INSTRUCTIONS && !cursor.empty()) {
+			const size_t offset = cursor.position();
+			const uint8_t firstByte = cursor.peek();
+
+			// Leave an instruction truncated by the end of memory to a block of its own, which throws
+			if (cursor.size() < instructionLength(firstByte) && !block.instructions.empty()) {
+				break;
+			}
+
+			uint16_t opcode = firstByte;
+			if (firstByte == CB_PREFIX && cursor.size() > 1) {
+				opcode = static_cast<uint16_t>((CB_PREFIX << 8) | cursor.data()[1]);
+			}
+
+			Event event = decoder.decodeEvent(cursor);
+			const uint8_t length = static_cast<uint8_t>(cursor.position() - offset);
+			block.instructions.push_back({event, toMicroOp(event), static_cast<uint16_t>(address + offset), opcode, length});
+			countDecoded(opcode, block.instructions.back().op.kind);
+
+			if (endsBasicBlock(firstByte)) {
+				break;
+			}
+		}
+
+		block.end = address + cursor.position();
+		block.fused = fuseInstructions(block.instructions);
+		block.idleLoop = detectIdleLoop(block, memory);
+		return block;
+	}
+
+	void BlockCache::erase(size_t start) {
+		const DecodedBlock& block = blocks.at(start);
+		for (size_t page = block.start / WatchedMemory::PAGE_SIZE; page <= (block.end - 1) / WatchedMemory::PAGE_SIZE; page++) {
+			std::vector<size_t>& starts = blocksByPage[page];
+			starts.erase(std::remove(starts.begin(), starts.end(), start), starts.end());
+			if (starts.empty()) {
+				memory.unwatchPage(page);
+			}
+		}
+		block.invalidated = true;
+		dropped.push_back(blocks.extract(start));
+	}
+
+}
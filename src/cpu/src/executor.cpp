@@ -0,0 +1,7 @@
+#include "executor.hpp"
+
+namespace jagce {
+
+	template class BasicExecutor<RandomAccessMemory>;
+
+}
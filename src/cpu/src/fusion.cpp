@@ -0,0 +1,87 @@
+#include "block_cache.hpp"
+
+#include <utility>
+#include <vector>
+
+#include "cycles.hpp"
+
+namespace jagce {
+
+	namespace {
+
+		constexpr uint16_t LD_A_HLI = 0x2A;
+		constexpr uint16_t LD_DE_A = 0x12;
+		constexpr uint16_t INC_DE = 0x13;
+		constexpr uint16_t LD_HLI_A = 0x22;
+		constexpr uint16_t LD_HLD_A = 0x32;
+
+		// Shortest fills worth fusing, a single store gains nothing
+		constexpr size_t MIN_FILL = 2;
+
+		bool opcodeAt(const std::vector<DecodedInstruction>& instructions, size_t i, uint16_t opcode) {
+			return i < instructions.size() && instructions[i].opcode == opcode;
+		}
+
+		// Instructions in the copy starting at i, and the bytes it copies
+		std::pair<size_t, size_t> matchCopy(const std::vector<DecodedInstruction>& instructions, size_t i) {
+			size_t count = 0;
+			size_t bytes = 0;
+			while (opcodeAt(instructions, i + count, LD_A_HLI) && opcodeAt(instructions, i + count + 1, LD_DE_A)) {
+				bytes++;
+				if (!opcodeAt(instructions, i + count + 2, INC_DE)) {
+					// Copies to the same DE can't repeat
+					count += 2;
+					break;
+				}
+				count += 3;
+			}
+			return {count, bytes};
+		}
+
+		size_t matchFill(const std::vector<DecodedInstruction>& instructions, size_t i, uint16_t opcode) {
+			size_t count = 0;
+			while (opcodeAt(instructions, i + count, opcode)) {
+				count++;
+			}
+			return count;
+		}
+
+	}
+
+	std::vector<FusedRun> fuseInstructions(const std::vector<DecodedInstruction>& instructions) {
+		std::vector<FusedRun> runs{};
+
+		for (size_t i = 0; i < instructions.size();) {
+			FusedRun run{FusedKind::COPY, static_cast<uint16_t>(i), 0, 0, 0};
+
+			const std::pair<size_t, size_t> copy = matchCopy(instructions, i);
+			if (copy.second != 0) {
+				run.count = static_cast<uint16_t>(copy.first);
+				run.bytes = static_cast<uint16_t>(copy.second);
+			} else {
+				for (FusedKind kind : { FusedKind::FILL_INCREMENT, FusedKind::FILL_DECREMENT }) {
+					const size_t fill = matchFill(instructions, i, kind == FusedKind::FILL_INCREMENT ? LD_HLI_A : LD_HLD_A);
+					if (fill >= MIN_FILL) {
+						run.kind = kind;
+						run.count = static_cast<uint16_t>(fill);
+						run.bytes = static_cast<uint16_t>(fill);
+					}
+				}
+			}
+
+			if (run.count == 0) {
+				i++;
+				continue;
+			}
+
+			for (size_t j = i; j < i + run.count; j++) {
+				run.cycles += opcodeCycles(instructions[j].opcode);
+			}
+			runs.push_back(run);
+			i += run.count;
+		}
+
+		return runs;
+	}
+
+}
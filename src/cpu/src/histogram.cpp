@@ -0,0 +1,157 @@
+#include "histogram.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace jagce {
+
+	namespace {
+
+		// In Event order
+		const char* const EVENT_NAMES[] = {
+			"DecrementEvent8", "IncrementEvent8", "CompareEvent8", "XorEvent8", "OrEvent8", "AndEvent8",
+			"SubEvent8", "AddEvent8", "PushEvent", "PopEvent", "RegisterShiftEvent", "LoadEvent8",
+			"LoadEvent16", "NopEvent", "AddHLEvent", "AddSPEvent", "IncrementEvent16", "DecrementEvent16"
+		};
+		static_assert(std::size(EVENT_NAMES) == OpcodeHistogram::EVENTS, "Every Event alternative needs a name");
+
+		// Every thread's counters, and the totals of threads that have exited
+		struct Registry {
+			std::mutex mutex;
+			std::vector<ThreadHistogram*> threads;
+			OpcodeHistogram exited{};
+		};
+
+		Registry& registry() {
+			// Never destroyed, as threads may exit after static destruction starts
+			static Registry* registry = new Registry{};
+			return *registry;
+		}
+
+		struct RegisteredHistogram {
+			ThreadHistogram histogram;
+
+			RegisteredHistogram() {
+				Registry& r = registry();
+				std::lock_guard<std::mutex> lock{r.mutex};
+				r.threads.push_back(&histogram);
+			}
+
+			~RegisteredHistogram() {
+				Registry& r = registry();
+				std::lock_guard<std::mutex> lock{r.mutex};
+				histogram.addTo(r.exited);
+				r.threads.erase(std::remove(r.threads.begin(), r.threads.end(), &histogram), r.threads.end());
+			}
+		};
+
+		std::string opcodeName(size_t index) {
+			std::ostringstream name{};
+			name << "0x" << std::hex << std::uppercase << std::setfill('0')
+				<< std::setw(index >= 0x100 ? 4 : 2) << (index >= 0x100 ? 0xCB00 + (index - 0x100) : index);
+			return name.str();
+		}
+
+	}
+
+	void OpcodeHistogram::merge(const OpcodeHistogram& other) {
+		for (size_t i = 0; i < OPCODES; i++) {
+			decodedOpcodes[i] += other.decodedOpcodes[i];
+			executedOpcodes[i] += other.executedOpcodes[i];
+		}
+		for (size_t i = 0; i < EVENTS; i++) {
+			decodedEvents[i] += other.decodedEvents[i];
+			executedEvents[i] += other.executedEvents[i];
+		}
+	}
+
+	void OpcodeHistogram::writeCsv(std::ostream& out) const {
+		out << "kind,name,decoded,executed\n";
+		for (size_t i = 0; i < OPCODES; i++) {
+			if (decodedOpcodes[i] != 0 || executedOpcodes[i] != 0) {
+				out << "opcode," << opcodeName(i) << ',' << decodedOpcodes[i] << ',' << executedOpcodes[i] << '\n';
+			}
+		}
+		for (size_t i = 0; i < EVENTS; i++) {
+			if (decodedEvents[i] != 0 || executedEvents[i] != 0) {
+				out << "event," << EVENT_NAMES[i] << ',' << decodedEvents[i] << ',' << executedEvents[i] << '\n';
+			}
+		}
+	}
+
+	void OpcodeHistogram::writeJson(std::ostream& out) const {
+		out << "{\"opcodes\":[";
+		bool first = true;
+		for (size_t i = 0; i < OPCODES; i++) {
+			if (decodedOpcodes[i] != 0 || executedOpcodes[i] != 0) {
+				out << (first ? "" : ",") << "{\"opcode\":\"" << opcodeName(i) << "\",\"decoded\":" << decodedOpcodes[i]
+					<< ",\"executed\":" << executedOpcodes[i] << '}';
+				first = false;
+			}
+		}
+		out << "],\"events\":[";
+		first = true;
+		for (size_t i = 0; i < EVENTS; i++) {
+			if (decodedEvents[i] != 0 || executedEvents[i] != 0) {
+				out << (first ? "" : ",") << "{\"event\":\"" << EVENT_NAMES[i] << "\",\"decoded\":" << decodedEvents[i]
+					<< ",\"executed\":" << executedEvents[i] << '}';
+				first = false;
+			}
+		}
+		out << "]}\n";
+	}
+
+	void ThreadHistogram::addTo(OpcodeHistogram& histogram) const {
+		for (size_t i = 0; i < OpcodeHistogram::OPCODES; i++) {
+			histogram.decodedOpcodes[i] += decodedOpcodes[i].load(std::memory_order_relaxed);
+			histogram.executedOpcodes[i] += executedOpcodes[i].load(std::memory_order_relaxed);
+		}
+		for (size_t i = 0; i < OpcodeHistogram::EVENTS; i++) {
+			histogram.decodedEvents[i] += decodedEvents[i].load(std::memory_order_relaxed);
+			histogram.executedEvents[i] += executedEvents[i].load(std::memory_order_relaxed);
+		}
+	}
+
+	void ThreadHistogram::clear() {
+		for (auto* counters : { &decodedOpcodes, &executedOpcodes }) {
+			for (std::atomic<uint64_t>& counter : *counters) {
+				counter.store(0, std::memory_order_relaxed);
+			}
+		}
+		for (auto* counters : { &decodedEvents, &executedEvents }) {
+			for (std::atomic<uint64_t>& counter : *counters) {
+				counter.store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	ThreadHistogram& threadHistogram() {
+		thread_local RegisteredHistogram registered{};
+		return registered.histogram;
+	}
+
+	OpcodeHistogram collectHistogram() {
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock{r.mutex};
+		OpcodeHistogram total = r.exited;
+		for (const ThreadHistogram* histogram : r.threads) {
+			histogram->addTo(total);
+		}
+		return total;
+	}
+
+	void resetHistogram() {
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock{r.mutex};
+		r.exited = OpcodeHistogram{};
+		for (ThreadHistogram* histogram : r.threads) {
+			histogram->clear();
+		}
+	}
+
+}
@@ -0,0 +1,216 @@
+#include "block_cache.hpp"
+
+#include "lazy_flags.hpp"
+
+namespace jagce {
+
+	namespace {
+
+		// Registers as bits of their index into Registers::r8, with F at bit 7 and SP above
+		using RegisterSet = uint16_t;
+		constexpr RegisterSet FLAGS = 1 << 7;
+		constexpr RegisterSet STACK_POINTER = 1 << 8;
+		// Stands for anything that can't be part of an idle loop, such as writes to memory
+		constexpr RegisterSet UNSUPPORTED = 0x8000;
+
+		struct Branch {
+			bool isBranch;
+			uint16_t target;
+			uint8_t flag;
+			bool takenWhenSet;
+		};
+
+		Branch branchOf(const DecodedInstruction& instruction, const RandomAccessMemory& memory) {
+			const uint16_t next = static_cast<uint16_t>(instruction.address + instruction.length);
+			uint16_t target = 0;
+			switch (instruction.opcode) {
+				case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+					target = static_cast<uint16_t>(next + static_cast<int8_t>(memory.readByte(instruction.address + 1)));
+					break;
+				case 0xC3: case 0xC2: case 0xCA: case 0xD2: case 0xDA:
+					target = static_cast<uint16_t>(memory.readByte(instruction.address + 1) | (memory.readByte(instruction.address + 2) << 8));
+					break;
+				default:
+					return {false, 0, 0, false};
+			}
+
+			switch (instruction.opcode) {
+				case 0x20: case 0xC2: return {true, target, FLAG_Z, false};
+				case 0x28: case 0xCA: return {true, target, FLAG_Z, true};
+				case 0x30: case 0xD2: return {true, target, FLAG_C, false};
+				case 0x38: case 0xDA: return {true, target, FLAG_C, true};
+				default: return {true, target, 0, false};
+			}
+		}
+
+		uint8_t payload(uint8_t operand) {
+			return operand & 0x0F;
+		}
+
+		RegisterSet registerSet(int id) {
+			switch (id) {
+				case RegisterNames::AF.getId(): return (1 << RegisterNames::A.getId()) | FLAGS;
+				case RegisterNames::BC.getId(): return (1 << RegisterNames::B.getId()) | (1 << RegisterNames::C.getId());
+				case RegisterNames::DE.getId(): return (1 << RegisterNames::D.getId()) | (1 << RegisterNames::E.getId());
+				case RegisterNames::HL.getId(): return (1 << RegisterNames::H.getId()) | (1 << RegisterNames::L.getId());
+				case RegisterNames::SP.getId(): return STACK_POINTER;
+				case RegisterNames::PC.getId(): return UNSUPPORTED;
+				default: return static_cast<RegisterSet>(1 << id);
+			}
+		}
+
+		// Registers read to get the value of an operand
+		RegisterSet reads(const MicroOp& op, uint8_t operand) {
+			switch (static_cast<OperandKind>(operand >> 4)) {
+				case OperandKind::REGISTER:
+					return registerSet(payload(operand));
+				case OperandKind::REGISTER8_PLUS_FLAG:
+					return registerSet(payload(operand)) | FLAGS;
+				case OperandKind::IMMEDIATE8_PLUS_FLAG:
+					return FLAGS;
+				case OperandKind::INDIRECT:
+				case OperandKind::INDIRECT_PLUS_FLAG:
+					{
+						const RegisterSet flags = static_cast<OperandKind>(operand >> 4) == OperandKind::INDIRECT_PLUS_FLAG ? FLAGS : 0;
+						switch (static_cast<Indirect>(payload(operand))) {
+							case Indirect::BC: return registerSet(RegisterNames::BC.getId()) | flags;
+							case Indirect::DE: return registerSet(RegisterNames::DE.getId()) | flags;
+							case Indirect::HL: return registerSet(RegisterNames::HL.getId()) | flags;
+							// HL+ and HL- change HL on every iteration
+							default: return UNSUPPORTED;
+						}
+					}
+				case OperandKind::PARTIAL_ADDRESS:
+					{
+						RegisterSet set = 0;
+						if (payload(operand) & PARTIAL_ADDRESS_MSB_REGISTER) {
+							set |= registerSet(op.immediate >> 8);
+						}
+						if (payload(operand) & PARTIAL_ADDRESS_LSB_REGISTER) {
+							set |= registerSet(op.immediate & 0xFF);
+						}
+						return set;
+					}
+				case OperandKind::REGISTER16_PLUS_VALUE:
+					return UNSUPPORTED;
+				default:
+					return 0;
+			}
+		}
+
+		// DIV and TIMA, which change with the clock alone
+		constexpr uint16_t FIRST_TIMER_COUNTER = 0xFF04;
+		constexpr uint16_t LAST_TIMER_COUNTER = 0xFF05;
+
+		bool isTimerCounter(uint16_t address) {
+			return address >= FIRST_TIMER_COUNTER && address <= LAST_TIMER_COUNTER;
+		}
+
+		// Whether an operand may read DIV or TIMA
+		bool readsTimer(const MicroOp& op, uint8_t operand) {
+			switch (static_cast<OperandKind>(operand >> 4)) {
+				case OperandKind::ADDRESS:
+					return isTimerCounter(op.immediate);
+				case OperandKind::PARTIAL_ADDRESS:
+					return (payload(operand) & (PARTIAL_ADDRESS_MSB_REGISTER | PARTIAL_ADDRESS_LSB_REGISTER)) != 0
+						|| isTimerCounter(op.immediate);
+				case OperandKind::INDIRECT:
+				case OperandKind::INDIRECT_PLUS_FLAG:
+					return true;
+				default:
+					return false;
+			}
+		}
+
+		// Registers written through a destination operand, or UNSUPPORTED for memory
+		RegisterSet writes(uint8_t operand) {
+			if (static_cast<OperandKind>(operand >> 4) != OperandKind::REGISTER) {
+				return UNSUPPORTED;
+			}
+			return registerSet(payload(operand));
+		}
+
+		// Flags are only replaced by operations writing all of them, others modify F
+		RegisterSet flagWrites(const MicroOp& op, RegisterSet& read) {
+			const FlagMasks masks = flagMasks(op.flagEffects);
+			if (masks.written() == 0) {
+				return 0;
+			}
+			if (masks.written() != (FLAG_Z | FLAG_N | FLAG_H | FLAG_C)) {
+				read |= FLAGS;
+			}
+			return FLAGS;
+		}
+
+	}
+
+	IdleLoop detectIdleLoop(const DecodedBlock& block, const RandomAccessMemory& memory) {
+		const IdleLoop none{false, false, 0, false};
+		if (block.instructions.empty()) {
+			return none;
+		}
+
+		const Branch branch = branchOf(block.instructions.back(), memory);
+		if (!branch.isBranch || branch.target != block.start) {
+			return none;
+		}
+
+		constexpr RegisterSet A = 1 << RegisterNames::A.getId();
+		RegisterSet written = 0;
+		// Registers read before the iteration writes them, which carry state between iterations
+		RegisterSet readFirst = 0;
+		bool timer = false;
+
+		for (size_t i = 0; i + 1 < block.instructions.size(); i++) {
+			const MicroOp& op = block.instructions[i].op;
+			RegisterSet read = 0;
+			RegisterSet write = 0;
+
+			switch (op.kind) {
+				case MicroOpKind::NOP:
+					break;
+				case MicroOpKind::LOAD8:
+				case MicroOpKind::LOAD16:
+					read = reads(op, op.b);
+					timer |= readsTimer(op, op.b);
+					write = writes(op.a) | flagWrites(op, read);
+					break;
+				case MicroOpKind::ADD8:
+					read = reads(op, op.a) | reads(op, op.b);
+					timer |= readsTimer(op, op.a) || readsTimer(op, op.b);
+					write = writes(op.a) | flagWrites(op, read);
+					break;
+				case MicroOpKind::SUB8:
+				case MicroOpKind::AND8:
+				case MicroOpKind::OR8:
+				case MicroOpKind::XOR8:
+					read = A | reads(op, op.a);
+					timer |= readsTimer(op, op.a);
+					write = A | flagWrites(op, read);
+					break;
+				case MicroOpKind::COMPARE8:
+					read = A | reads(op, op.a);
+					timer |= readsTimer(op, op.a);
+					write = flagWrites(op, read);
+					break;
+				default:
+					return none;
+			}
+
+			if ((read | write) & UNSUPPORTED) {
+				return none;
+			}
+			readFirst |= read & ~written;
+			written |= write;
+		}
+
+		if (branch.flag != 0) {
+			readFirst |= FLAGS & ~written;
+		}
+		if (readFirst & written) {
+			return none;
+		}
+		return {true, timer, branch.flag, branch.takenWhenSet};
+	}
+
+}
@@ -0,0 +1,559 @@
+#include "jit.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#ifdef JAGCE_JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+#include "cycles.hpp"
+#include "histogram.hpp"
+
+namespace jagce {
+
+#ifdef JAGCE_JIT_X86_64
+	namespace {
+
+		using NativeCode = void (*)(Registers* registers);
+
+		enum HostRegister : uint8_t {
+			RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+			R8, R9, R10, R11, R12, R13, R14, R15
+		};
+
+		// Host registers of A, B, C, D, E, H, L and F, by index into Registers::r8
+		constexpr std::array<HostRegister, 8> GUEST{ RCX, RDX, RSI, R8, R9, R10, R11, RBX };
+		constexpr HostRegister GUEST_SP = R13;
+		// The compiled function's argument, the Registers the guest registers live in
+		constexpr HostRegister BASE = RDI;
+		// Scratch: RAX holds results, R12 carries and R14 flags being assembled
+		constexpr HostRegister CARRIES = R12;
+		constexpr HostRegister FLAGS = R14;
+		constexpr std::array<HostRegister, 4> SAVED{ RBX, R12, R13, R14 };
+
+		// Opcode extensions of the 0x81 group and the register forms of the same operations
+		enum class Alu : uint8_t { ADD = 0, OR = 1, ADC = 2, SBB = 3, AND = 4, SUB = 5, XOR = 6, CMP = 7 };
+		constexpr uint8_t aluOpcode(Alu alu) { return static_cast<uint8_t>((static_cast<uint8_t>(alu) << 3) | 0x01); }
+
+		constexpr int BC = RegisterNames::BC.getId();
+		constexpr int DE = RegisterNames::DE.getId();
+		constexpr int HL = RegisterNames::HL.getId();
+		constexpr int SP = RegisterNames::SP.getId();
+
+		/**
+		 * Encodes the handful of x86-64 instructions the compiler needs. Guest values are
+		 * kept zero-extended in 32-bit registers, so arithmetic is 32-bit and results are
+		 * narrowed with movzx.
+		 */
+		class Assembler {
+		public:
+			explicit Assembler(std::vector<uint8_t>& out) : out{out} {}
+
+			void push(HostRegister r) { rex(false, 0, r); byte(0x50 | (r & 7)); }
+			void pop(HostRegister r) { rex(false, 0, r); byte(0x58 | (r & 7)); }
+			void ret() { byte(0xC3); }
+
+			void movzxLoad8(HostRegister dst, size_t offset) { rex(false, dst, BASE); byte(0x0F); byte(0xB6); based(dst, offset); }
+			void movzxLoad16(HostRegister dst, size_t offset) { rex(false, dst, BASE); byte(0x0F); byte(0xB7); based(dst, offset); }
+			void store8(size_t offset, HostRegister src) { rex(false, src, BASE, true); byte(0x88); based(src, offset); }
+			void store16(size_t offset, HostRegister src) { byte(0x66); rex(false, src, BASE); byte(0x89); based(src, offset); }
+
+			void mov(HostRegister dst, HostRegister src) { alu(0x89, dst, src); }
+			void mov(HostRegister dst, uint32_t value) { rex(false, 0, dst); byte(0xB8 | (dst & 7)); imm32(value); }
+			void movzx8(HostRegister dst, HostRegister src) { rex(false, dst, src, true); byte(0x0F); byte(0xB6); direct(dst, src); }
+			void movzx16(HostRegister dst, HostRegister src) { rex(false, dst, src); byte(0x0F); byte(0xB7); direct(dst, src); }
+
+			void alu(Alu op, HostRegister dst, HostRegister src) { alu(aluOpcode(op), dst, src); }
+			void alu(Alu op, HostRegister dst, uint32_t value) {
+				rex(false, 0, dst);
+				byte(0x81);
+				direct(static_cast<uint8_t>(op), dst);
+				imm32(value);
+			}
+
+			void shl(HostRegister r, uint8_t amount) { shift(4, r, amount); }
+			void shr(HostRegister r, uint8_t amount) { shift(5, r, amount); }
+
+			// Copies bit of r to the carry flag
+			void bt(HostRegister r, uint8_t bit) { rex(false, 0, r); byte(0x0F); byte(0xBA); direct(4, r); byte(bit); }
+			void test8(HostRegister a, HostRegister b) { rex(false, b, a, true); byte(0x84); direct(b, a); }
+			void setz(HostRegister r) { rex(false, 0, r, true); byte(0x0F); byte(0x94); direct(0, r); }
+
+		private:
+			void byte(uint8_t b) { out.push_back(b); }
+
+			void imm32(uint32_t value) {
+				for (size_t i = 0; i < 4; i++) {
+					byte(static_cast<uint8_t>(value >> (i * 8)));
+				}
+			}
+
+			// Byte registers always take a REX prefix so that 4 to 7 are SPL to DIL, never AH to BH
+			void rex(bool wide, uint8_t reg, uint8_t rm, bool byteRegisters = false) {
+				const uint8_t prefix = static_cast<uint8_t>(0x40 | (wide << 3) | ((reg >> 3) << 2) | (rm >> 3));
+				if (prefix != 0x40 || byteRegisters) {
+					byte(prefix);
+				}
+			}
+
+			void direct(uint8_t reg, uint8_t rm) { byte(static_cast<uint8_t>(0xC0 | ((reg & 7) << 3) | (rm & 7))); }
+
+			void based(uint8_t reg, size_t offset) {
+				byte(static_cast<uint8_t>(0x40 | ((reg & 7) << 3) | (BASE & 7)));
+				byte(static_cast<uint8_t>(offset));
+			}
+
+			void alu(uint8_t opcode, HostRegister dst, HostRegister src) { rex(false, src, dst); byte(opcode); direct(src, dst); }
+			void shift(uint8_t extension, HostRegister r, uint8_t amount) { rex(false, 0, r); byte(0xC1); direct(extension, r); byte(amount); }
+
+			std::vector<uint8_t>& out;
+		};
+
+		uint8_t payload(uint8_t operand) {
+			return operand & 0x0F;
+		}
+
+		bool isRegister8(uint8_t operand) {
+			return static_cast<OperandKind>(operand >> 4) == OperandKind::REGISTER && payload(operand) < REGISTER_F;
+		}
+
+		bool isPair(uint8_t operand) {
+			const int id = payload(operand);
+			return static_cast<OperandKind>(operand >> 4) == OperandKind::REGISTER && id >= BC && id <= SP;
+		}
+
+		// Value operands of 8-bit operations that compiled code can read
+		bool isValue8(uint8_t operand) {
+			switch (static_cast<OperandKind>(operand >> 4)) {
+				case OperandKind::REGISTER:
+				case OperandKind::REGISTER8_PLUS_FLAG:
+					return payload(operand) < REGISTER_F;
+				case OperandKind::IMMEDIATE8:
+				case OperandKind::IMMEDIATE8_PLUS_FLAG:
+					return true;
+				default:
+					return false;
+			}
+		}
+
+		bool hasCarryIn(uint8_t operand) {
+			const OperandKind kind = static_cast<OperandKind>(operand >> 4);
+			return kind == OperandKind::REGISTER8_PLUS_FLAG || kind == OperandKind::IMMEDIATE8_PLUS_FLAG;
+		}
+
+		bool hasImmediate(uint8_t operand) {
+			const OperandKind kind = static_cast<OperandKind>(operand >> 4);
+			return kind == OperandKind::IMMEDIATE8 || kind == OperandKind::IMMEDIATE8_PLUS_FLAG;
+		}
+
+		bool isCompilable(const MicroOp& op) {
+			const FlagMasks masks = flagMasks(op.flagEffects);
+			if ((masks.computed & ~(FLAG_Z | FLAG_H | FLAG_C)) != 0) {
+				return false;
+			}
+			if ((hasCarryIn(op.a) || hasCarryIn(op.b)) && flagBit(static_cast<FlagName>(op.aux)) == 0) {
+				return false;
+			}
+
+			switch (op.kind) {
+				case MicroOpKind::NOP:
+					return true;
+				case MicroOpKind::LOAD8:
+					return isRegister8(op.a) && (isRegister8(op.b) || op.operandKindB() == OperandKind::IMMEDIATE8);
+				case MicroOpKind::LOAD16:
+					return op.flagEffects == 0 && isPair(op.a)
+						&& (isPair(op.b) || op.operandKindB() == OperandKind::IMMEDIATE16);
+				case MicroOpKind::ADD8:
+					return isRegister8(op.a) && payload(op.a) == RegisterNames::A.getId() && isValue8(op.b);
+				case MicroOpKind::SUB8:
+				case MicroOpKind::COMPARE8:
+				case MicroOpKind::AND8:
+				case MicroOpKind::OR8:
+				case MicroOpKind::XOR8:
+					return isValue8(op.a);
+				case MicroOpKind::INCREMENT8:
+				case MicroOpKind::DECREMENT8:
+					return isRegister8(op.a);
+				case MicroOpKind::INCREMENT16:
+				case MicroOpKind::DECREMENT16:
+				case MicroOpKind::ADD_HL:
+					return isPair(op.a);
+				default:
+					return false;
+			}
+		}
+
+		// Conditional branches are left to the interpreter, as their cycles depend on F
+		bool isCompilable(const DecodedInstruction& instruction) {
+			return !isConditionalBranch(instruction.opcode) && isCompilable(instruction.op);
+		}
+
+		/**
+		 * Compiles runs of instructions to a function of the Registers they run on. Guest
+		 * registers are loaded on entry and stored on exit, F included, so the caller must
+		 * fold any deferred flags into F first.
+		 */
+		class BlockCompiler {
+		public:
+			explicit BlockCompiler(std::vector<uint8_t>& out) : a{out} {}
+
+			void prologue() {
+				for (HostRegister r : SAVED) {
+					a.push(r);
+				}
+				for (size_t i = 0; i < GUEST.size(); i++) {
+					a.movzxLoad8(GUEST[i], offsetof(Registers, r8) + i);
+				}
+				a.movzxLoad16(GUEST_SP, offsetof(Registers, sp));
+			}
+
+			void epilogue() {
+				for (size_t i = 0; i < GUEST.size(); i++) {
+					a.store8(offsetof(Registers, r8) + i, GUEST[i]);
+				}
+				a.store16(offsetof(Registers, sp), GUEST_SP);
+				for (auto it = SAVED.rbegin(); it != SAVED.rend(); it++) {
+					a.pop(*it);
+				}
+				a.ret();
+			}
+
+			void compile(const MicroOp& op) {
+				const HostRegister regA = GUEST[RegisterNames::A.getId()];
+
+				switch (op.kind) {
+					case MicroOpKind::LOAD8:
+						if (hasImmediate(op.b)) {
+							a.mov(GUEST[payload(op.a)], static_cast<uint8_t>(op.immediate));
+						} else {
+							a.mov(GUEST[payload(op.a)], GUEST[payload(op.b)]);
+						}
+						break;
+					case MicroOpKind::LOAD16:
+						if (op.operandKindB() == OperandKind::IMMEDIATE16) {
+							a.mov(RAX, op.immediate);
+						} else {
+							readPair(RAX, payload(op.b));
+						}
+						writePair(payload(op.a));
+						break;
+					case MicroOpKind::ADD8:
+						arithmetic(op, hasCarryIn(op.b) ? Alu::ADC : Alu::ADD, regA, op.b, true);
+						break;
+					case MicroOpKind::SUB8:
+						arithmetic(op, hasCarryIn(op.a) ? Alu::SBB : Alu::SUB, regA, op.a, true);
+						break;
+					case MicroOpKind::COMPARE8:
+						arithmetic(op, Alu::SUB, regA, op.a, false);
+						break;
+					case MicroOpKind::AND8:
+					case MicroOpKind::OR8:
+					case MicroOpKind::XOR8:
+						{
+							const Alu alu = op.kind == MicroOpKind::AND8 ? Alu::AND : op.kind == MicroOpKind::OR8 ? Alu::OR : Alu::XOR;
+							a.mov(RAX, regA);
+							applyValue(alu, RAX, op, op.a);
+							a.movzx8(regA, RAX);
+							// Bitwise results are recorded with zero inputs, so the carries are the result
+							a.mov(CARRIES, RAX);
+							flags(op, FlagWidth::BITS8);
+						}
+						break;
+					case MicroOpKind::INCREMENT8:
+					case MicroOpKind::DECREMENT8:
+						{
+							const HostRegister r = GUEST[payload(op.a)];
+							a.mov(RAX, r);
+							a.alu(op.kind == MicroOpKind::INCREMENT8 ? Alu::ADD : Alu::SUB, RAX, 1u);
+							carries(r, 1u);
+							a.movzx8(r, RAX);
+							flags(op, FlagWidth::BITS8);
+						}
+						break;
+					case MicroOpKind::INCREMENT16:
+					case MicroOpKind::DECREMENT16:
+						readPair(RAX, payload(op.a));
+						a.alu(op.kind == MicroOpKind::INCREMENT16 ? Alu::ADD : Alu::SUB, RAX, 1u);
+						writePair(payload(op.a));
+						break;
+					case MicroOpKind::ADD_HL:
+						readPair(FLAGS, payload(op.a));
+						readPair(RAX, HL);
+						a.mov(CARRIES, RAX);
+						a.alu(Alu::XOR, CARRIES, FLAGS);
+						a.alu(Alu::ADD, RAX, FLAGS);
+						a.alu(Alu::XOR, CARRIES, RAX);
+						writePair(HL);
+						flags(op, FlagWidth::BITS16);
+						break;
+					default:
+						break;
+				}
+			}
+
+		private:
+			// Reads a register pair, or SP, into dst
+			void readPair(HostRegister dst, int id) {
+				if (id == SP) {
+					a.mov(dst, GUEST_SP);
+					return;
+				}
+				a.mov(dst, GUEST[pairHigh(id)]);
+				a.shl(dst, 8);
+				a.alu(Alu::OR, dst, GUEST[pairLow(id)]);
+			}
+
+			// Writes the low 16 bits of RAX to a register pair, or SP
+			void writePair(int id) {
+				a.movzx16(RAX, RAX);
+				if (id == SP) {
+					a.mov(GUEST_SP, RAX);
+					return;
+				}
+				a.movzx8(GUEST[pairLow(id)], RAX);
+				a.mov(GUEST[pairHigh(id)], RAX);
+				a.shr(GUEST[pairHigh(id)], 8);
+			}
+
+			static size_t pairHigh(int id) { return static_cast<size_t>(2 * (id - BC) + 1); }
+			static size_t pairLow(int id) { return static_cast<size_t>(2 * (id - BC) + 2); }
+
+			void applyValue(Alu alu, HostRegister dst, const MicroOp& op, uint8_t operand) {
+				if (hasImmediate(operand)) {
+					a.alu(alu, dst, static_cast<uint32_t>(static_cast<uint8_t>(op.immediate)));
+				} else {
+					a.alu(alu, dst, GUEST[payload(operand)]);
+				}
+			}
+
+			// Computes x + y or x - y with any carry into RAX, storing it back to x if asked
+			void arithmetic(const MicroOp& op, Alu alu, HostRegister x, uint8_t operand, bool store) {
+				a.mov(RAX, x);
+				if (alu == Alu::ADC || alu == Alu::SBB) {
+					a.bt(GUEST[REGISTER_F], bitIndex(flagBit(static_cast<FlagName>(op.aux))));
+				}
+				applyValue(alu, RAX, op, operand);
+
+				a.mov(CARRIES, x);
+				if (hasImmediate(operand)) {
+					a.alu(Alu::XOR, CARRIES, static_cast<uint32_t>(static_cast<uint8_t>(op.immediate)));
+				} else {
+					a.alu(Alu::XOR, CARRIES, GUEST[payload(operand)]);
+				}
+				a.alu(Alu::XOR, CARRIES, RAX);
+
+				if (store) {
+					a.movzx8(x, RAX);
+				}
+				flags(op, FlagWidth::BITS8);
+			}
+
+			// Sets CARRIES to x ^ y ^ RAX
+			void carries(HostRegister x, uint32_t y) {
+				a.mov(CARRIES, x);
+				a.alu(Alu::XOR, CARRIES, y);
+				a.alu(Alu::XOR, CARRIES, RAX);
+			}
+
+			/**
+			 * Updates F as Registers::deferFlags and LazyFlags::evaluate would, from the result
+			 * in RAX and the carries in CARRIES. Only the flags the operation computes are
+			 * extracted.
+			 */
+			void flags(const MicroOp& op, FlagWidth width) {
+				const FlagMasks masks = flagMasks(op.flagEffects);
+				const HostRegister f = GUEST[REGISTER_F];
+
+				if (masks.computed != 0) {
+					a.alu(Alu::XOR, FLAGS, FLAGS);
+					if (masks.computed & FLAG_Z) {
+						a.test8(RAX, RAX);
+						a.setz(FLAGS);
+						a.shl(FLAGS, 7);
+					}
+					if (width == FlagWidth::BITS16) {
+						a.shr(CARRIES, 8);
+					}
+					if (masks.computed & FLAG_H) {
+						a.mov(RAX, CARRIES);
+						a.alu(Alu::AND, RAX, 0x10u);
+						a.shl(RAX, 1);
+						a.alu(Alu::OR, FLAGS, RAX);
+					}
+					if (masks.computed & FLAG_C) {
+						a.alu(Alu::AND, CARRIES, 0x100u);
+						a.shr(CARRIES, 4);
+						a.alu(Alu::OR, FLAGS, CARRIES);
+					}
+				}
+
+				if (masks.written() != 0) {
+					a.alu(Alu::AND, f, static_cast<uint32_t>(0xF0 & ~masks.written()));
+				}
+				if (masks.set != 0) {
+					a.alu(Alu::OR, f, static_cast<uint32_t>(masks.set));
+				}
+				if (masks.computed != 0) {
+					a.alu(Alu::OR, f, FLAGS);
+				}
+			}
+
+			static uint8_t bitIndex(uint8_t bit) {
+				uint8_t index = 0;
+				while ((bit >> index) != 1) {
+					index++;
+				}
+				return index;
+			}
+
+			Assembler a;
+		};
+
+	}
+#endif
+
+	Jit::Jit(Registers& registers, WatchedMemory& memory, BlockCache& cache, uint32_t compileThreshold, size_t codeSize)
+		: registers{registers}, cache{cache}, executor{registers, memory}, compileThreshold{compileThreshold},
+		code{nullptr}, codeSize{0}, codeUsed{0}, generation{1}, assembly{}, stats{} {
+#ifdef JAGCE_JIT_X86_64
+		void* mapping = mmap(nullptr, codeSize, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapping == MAP_FAILED) {
+			throw std::system_error(errno, std::generic_category(), "Could not map JIT code buffer");
+		}
+		code = static_cast<uint8_t*>(mapping);
+		this->codeSize = codeSize;
+#endif
+	}
+
+	Jit::~Jit() {
+#ifdef JAGCE_JIT_X86_64
+		munmap(code, codeSize);
+#endif
+	}
+
+	uint64_t Jit::run(size_t address) {
+		const DecodedBlock& block = cache.getBlock(address);
+		CompiledCode& compiled = block.compiled;
+
+		if (!jitSupported || (compiled.generation != generation && compiled.runs++ < compileThreshold)) {
+			return interpret(block);
+		}
+		if (compiled.generation != generation) {
+			compile(block);
+		}
+
+		uint64_t cycles = 0;
+		for (size_t i = 0; i < compiled.steps.size(); i++) {
+			const CompiledStep step = compiled.steps[i];
+			if (step.code != nullptr) {
+#ifdef JAGCE_JIT_X86_64
+				// Compiled code keeps F whole, so fold in any flags still deferred
+				registers.setF(registers.f());
+				reinterpret_cast<NativeCode>(const_cast<void*>(step.code))(&registers);
+#endif
+				const DecodedInstruction& last = block.instructions[step.first + step.count - 1];
+				registers.pc = static_cast<uint16_t>(last.address + last.length);
+				cycles += step.cycles;
+				stats.nativeInstructions += step.count;
+			} else {
+				const DecodedInstruction& instruction = block.instructions[step.first];
+				registers.pc = static_cast<uint16_t>(instruction.address + instruction.length);
+				cycles += executor.execute(instruction);
+				stats.interpretedInstructions++;
+				// A write to the block's own memory has dropped it and its code
+				if (block.invalidated) {
+					break;
+				}
+			}
+		}
+		countExecuted(block, registers.pc);
+		return cycles;
+	}
+
+	void Jit::flush() {
+		codeUsed = 0;
+		generation++;
+		stats.flushes++;
+	}
+
+	uint64_t Jit::interpret(const DecodedBlock& block) {
+		uint64_t cycles = 0;
+		for (const DecodedInstruction& instruction : block.instructions) {
+			registers.pc = static_cast<uint16_t>(instruction.address + instruction.length);
+			cycles += executor.execute(instruction);
+			stats.interpretedInstructions++;
+			if (block.invalidated) {
+				break;
+			}
+		}
+		countExecuted(block, registers.pc);
+		return cycles;
+	}
+
+	void Jit::compile(const DecodedBlock& block) {
+#ifdef JAGCE_JIT_X86_64
+		// Assemble every native run first so the buffer is only made writable once
+		std::vector<CompiledStep> steps{};
+		// Step index and offset into the assembly of each native step
+		std::vector<std::pair<size_t, size_t>> offsets{};
+		assembly.clear();
+		BlockCompiler compiler{assembly};
+
+		const size_t count = block.instructions.size();
+		for (size_t i = 0; i < count;) {
+			if (!isCompilable(block.instructions[i])) {
+				steps.push_back({nullptr, static_cast<uint16_t>(i), 1, 0});
+				i++;
+				continue;
+			}
+
+			CompiledStep step{nullptr, static_cast<uint16_t>(i), 0, 0};
+			offsets.emplace_back(steps.size(), assembly.size());
+			compiler.prologue();
+			for (; i < count && isCompilable(block.instructions[i]); i++) {
+				compiler.compile(block.instructions[i].op);
+				step.count++;
+				step.cycles += opcodeCycles(block.instructions[i].opcode);
+			}
+			compiler.epilogue();
+			steps.push_back(step);
+		}
+
+		if (assembly.size() > codeSize) {
+			throw std::length_error("Compiled block does not fit in the JIT code buffer");
+		}
+		if (codeUsed + assembly.size() > codeSize) {
+			flush();
+		}
+
+		if (!assembly.empty()) {
+			uint8_t* const destination = code + codeUsed;
+			if (mprotect(code, codeSize, PROT_READ | PROT_WRITE) != 0) {
+				throw std::system_error(errno, std::generic_category(), "Could not make JIT code writable");
+			}
+			memcpy(destination, assembly.data(), assembly.size());
+			if (mprotect(code, codeSize, PROT_READ | PROT_EXEC) != 0) {
+				throw std::system_error(errno, std::generic_category(), "Could not make JIT code executable");
+			}
+
+			for (const std::pair<size_t, size_t>& offset : offsets) {
+				steps[offset.first].code = destination + offset.second;
+			}
+			codeUsed += assembly.size();
+		}
+
+		block.compiled.steps = std::move(steps);
+		block.compiled.generation = generation;
+		stats.compiledBlocks++;
+#else
+		static_cast<void>(block);
+#endif
+	}
+
+}
@@ -0,0 +1,123 @@
+#include "lcd.hpp"
+
+#include "ppu.hpp"
+
+namespace jagce {
+
+	namespace {
+
+		constexpr uint8_t STAT_HBLANK = 0x08;
+		constexpr uint8_t STAT_VBLANK = 0x10;
+		constexpr uint8_t STAT_OAM_SEARCH = 0x20;
+		constexpr uint8_t STAT_COINCIDENCE = 0x40;
+
+	}
+
+	Lcd::Lcd(Scheduler& scheduler, Interrupts& interrupts)
+		: scheduler{scheduler}, interrupts{interrupts}, registers{}, mode{LcdMode::HBLANK}, line{0}, transition{0}, ppu{nullptr} {}
+
+	uint8_t Lcd::read(uint16_t address) const {
+		switch (address) {
+			case STAT:
+				return 0x80 | (registers[STAT - FIRST_REGISTER] & 0x78)
+					| (line == registers[LYC - FIRST_REGISTER] ? 0x04 : 0x00)
+					| static_cast<uint8_t>(mode);
+			case LY:
+				return line;
+			default:
+				return registers[address - FIRST_REGISTER];
+		}
+	}
+
+	void Lcd::write(uint16_t address, uint8_t value) {
+		switch (address) {
+			case LY:
+				// Read only
+				return;
+			case LCDC:
+				{
+					const bool wasOn = isOn();
+					registers[LCDC - FIRST_REGISTER] = value;
+					if (wasOn && !isOn()) {
+						scheduler.cancel(ScheduledEvent::LCD_MODE);
+						line = 0;
+						mode = LcdMode::HBLANK;
+					} else if (!wasOn && isOn()) {
+						transition = scheduler.now();
+						setLine(0);
+						enterMode(LcdMode::OAM_SEARCH, OAM_SEARCH_CYCLES);
+					}
+					return;
+				}
+			case LYC:
+				registers[LYC - FIRST_REGISTER] = value;
+				if (isOn() && line == value && statEnabled(STAT_COINCIDENCE)) {
+					interrupts.request(INTERRUPT_STAT);
+				}
+				return;
+			default:
+				registers[address - FIRST_REGISTER] = value;
+				return;
+		}
+	}
+
+	void Lcd::nextMode() {
+		switch (mode) {
+			case LcdMode::OAM_SEARCH:
+				enterMode(LcdMode::TRANSFER, TRANSFER_CYCLES);
+				break;
+			case LcdMode::TRANSFER:
+				if (ppu != nullptr) {
+					ppu->renderLine(line, *this);
+				}
+				enterMode(LcdMode::HBLANK, HBLANK_CYCLES);
+				break;
+			case LcdMode::HBLANK:
+				setLine(line + 1);
+				if (line == VISIBLE_LINES) {
+					interrupts.request(INTERRUPT_VBLANK);
+					enterMode(LcdMode::VBLANK, LINE_CYCLES);
+				} else {
+					enterMode(LcdMode::OAM_SEARCH, OAM_SEARCH_CYCLES);
+				}
+				break;
+			case LcdMode::VBLANK:
+				// Each VBlank line enters the mode again, without another STAT interrupt
+				if (line + 1 == LINES) {
+					setLine(0);
+					enterMode(LcdMode::OAM_SEARCH, OAM_SEARCH_CYCLES);
+				} else {
+					setLine(line + 1);
+					enterMode(LcdMode::VBLANK, LINE_CYCLES);
+				}
+				break;
+		}
+	}
+
+	void Lcd::enterMode(LcdMode mode, uint64_t cycles) {
+		const bool changed = this->mode != mode;
+		this->mode = mode;
+		// From the cycle the transition was due rather than when it was handled, so a late
+		// handler doesn't drift the frame
+		transition += cycles;
+		scheduler.schedule(ScheduledEvent::LCD_MODE, transition);
+		if (!changed) {
+			return;
+		}
+
+		const uint8_t source = mode == LcdMode::HBLANK ? STAT_HBLANK
+			: mode == LcdMode::VBLANK ? STAT_VBLANK
+			: mode == LcdMode::OAM_SEARCH ? STAT_OAM_SEARCH : 0;
+		if (statEnabled(source)) {
+			interrupts.request(INTERRUPT_STAT);
+		}
+	}
+
+	void Lcd::setLine(uint8_t line) {
+		this->line = line;
+		if (line == registers[LYC - FIRST_REGISTER] && statEnabled(STAT_COINCIDENCE)) {
+			interrupts.request(INTERRUPT_STAT);
+		}
+	}
+
+}
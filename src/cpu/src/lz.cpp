@@ -0,0 +1,155 @@
+#include "lz.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace jagce {
+
+	namespace {
+
+		constexpr size_t MIN_MATCH = 4;
+		constexpr size_t MAX_OFFSET = 0xFFFF;
+		constexpr size_t HASH_BITS = 12;
+		// Lengths of 15 in a token nibble continue in the bytes that follow
+		constexpr size_t LENGTH_CONTINUES = 15;
+
+		uint32_t hashOf(uint8_t const * bytes) {
+			uint32_t sequence;
+			memcpy(&sequence, bytes, sizeof(sequence));
+			return (sequence * 2654435761u) >> (32 - HASH_BITS);
+		}
+
+		void writeLength(std::vector<uint8_t>& out, size_t length) {
+			while (length >= 0xFF) {
+				out.push_back(0xFF);
+				length -= 0xFF;
+			}
+			out.push_back(static_cast<uint8_t>(length));
+		}
+
+		// A match length of 0 is the final sequence, which only has literals
+		void writeSequence(std::vector<uint8_t>& out, uint8_t const * literals, size_t literalLength,
+				size_t offset, size_t matchLength) {
+			const size_t matchCode = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+			out.push_back(static_cast<uint8_t>((std::min(literalLength, LENGTH_CONTINUES) << 4)
+					| std::min(matchCode, LENGTH_CONTINUES)));
+			if (literalLength >= LENGTH_CONTINUES) {
+				writeLength(out, literalLength - LENGTH_CONTINUES);
+			}
+			out.insert(out.end(), literals, literals + literalLength);
+
+			if (matchLength != 0) {
+				out.push_back(static_cast<uint8_t>(offset));
+				out.push_back(static_cast<uint8_t>(offset >> 8));
+				if (matchCode >= LENGTH_CONTINUES) {
+					writeLength(out, matchCode - LENGTH_CONTINUES);
+				}
+			}
+		}
+
+		std::invalid_argument corrupt() {
+			return std::invalid_argument("Compressed data is corrupt");
+		}
+
+		size_t readLength(uint8_t const *& in, uint8_t const * end, size_t length) {
+			if (length != LENGTH_CONTINUES) {
+				return length;
+			}
+			uint8_t byte;
+			do {
+				if (in == end) {
+					throw corrupt();
+				}
+				byte = *in++;
+				length += byte;
+			} while (byte == 0xFF);
+			return length;
+		}
+
+	}
+
+	size_t lzCompress(uint8_t const * in, size_t size, std::vector<uint8_t>& out) {
+		const size_t start = out.size();
+		out.reserve(start + size + size / 0xFF + 16);
+
+		std::array<uint32_t, 1 << HASH_BITS> positions{};
+		size_t anchor = 0;
+		size_t pos = 0;
+
+		while (pos + MIN_MATCH <= size) {
+			const uint32_t hash = hashOf(in + pos);
+			const size_t candidate = positions[hash];
+			positions[hash] = static_cast<uint32_t>(pos);
+
+			if (candidate < pos && pos - candidate <= MAX_OFFSET && memcmp(in + candidate, in + pos, MIN_MATCH) == 0) {
+				size_t length = MIN_MATCH;
+				while (pos + length < size && in[candidate + length] == in[pos + length]) {
+					length++;
+				}
+				writeSequence(out, in + anchor, pos - anchor, pos - candidate, length);
+				pos += length;
+				anchor = pos;
+			} else {
+				pos++;
+			}
+		}
+
+		writeSequence(out, in + anchor, size - anchor, 0, 0);
+		return out.size() - start;
+	}
+
+	void lzDecompress(uint8_t const * in, size_t size, uint8_t* out, size_t outSize) {
+		uint8_t const * const end = in + size;
+		uint8_t* const outStart = out;
+		uint8_t* const outEnd = out + outSize;
+
+		while (true) {
+			if (in == end) {
+				throw corrupt();
+			}
+			const uint8_t token = *in++;
+
+			const size_t literalLength = readLength(in, end, token >> 4);
+			if (literalLength > static_cast<size_t>(end - in) || literalLength > static_cast<size_t>(outEnd - out)) {
+				throw corrupt();
+			}
+			// Empty buffers may be null, which memcpy doesn't accept even for no bytes
+			if (literalLength != 0) {
+				memcpy(out, in, literalLength);
+			}
+			in += literalLength;
+			out += literalLength;
+
+			if (in == end) {
+				break;
+			}
+
+			if (end - in < 2) {
+				throw corrupt();
+			}
+			const size_t offset = in[0] | (in[1] << 8);
+			in += 2;
+			if (offset == 0 || offset > static_cast<size_t>(out - outStart)) {
+				throw corrupt();
+			}
+
+			const size_t matchLength = readLength(in, end, token & 0x0F) + MIN_MATCH;
+			if (matchLength > static_cast<size_t>(outEnd - out)) {
+				throw corrupt();
+			}
+			// Matches may overlap their own output, repeating the last offset bytes
+			uint8_t const * match = out - offset;
+			for (size_t i = 0; i < matchLength; i++) {
+				out[i] = match[i];
+			}
+			out += matchLength;
+		}
+
+		if (out != outEnd) {
+			throw corrupt();
+		}
+	}
+
+}
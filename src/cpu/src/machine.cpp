@@ -0,0 +1,107 @@
+#include "machine.hpp"
+
+#include <algorithm>
+
+namespace jagce {
+
+	namespace {
+
+		constexpr uint8_t HALT_OPCODE = 0x76;
+		constexpr uint16_t IO_PAGE = 0xFF00;
+
+	}
+
+	Machine::Machine()
+		: registers{}, scheduler{}, interrupts{}, timer{scheduler, interrupts}, lcd{scheduler, interrupts},
+		io{*this}, ram(IO_PAGE), bus{}, memory{bus}, cache{memory}, executor{registers, memory}, ppu{memory}, halted{false}, trace{nullptr} {
+		bus.map(0, ram.size(), ram.data());
+		bus.mapHandler(IO_PAGE, MemoryBus::PAGE_SIZE, &io);
+		lcd.setPpu(&ppu);
+	}
+
+	uint64_t Machine::run(uint64_t cycles) {
+		const uint64_t start = scheduler.now();
+		const uint64_t end = start + cycles;
+
+		while (scheduler.now() < end) {
+			handleDueEvents();
+			const uint64_t deadline = std::min(end, scheduler.nextTime());
+
+			if (halted) {
+				if (interrupts.pending()) {
+					halted = false;
+				} else {
+					scheduler.advance(deadline - scheduler.now());
+				}
+				continue;
+			}
+
+			while (scheduler.now() < deadline && !halted) {
+				const DecodedBlock& block = cache.getBlock(registers.pc);
+				const uint64_t start = scheduler.now();
+				uint64_t idleCycles = deadline - scheduler.now();
+				// DIV and TIMA count up without an event, so a loop polling them wakes at each count
+				if (block.idleLoop.readsTimer) {
+					idleCycles = std::min(idleCycles, timer.cyclesUntilCount());
+				}
+				// A trace holds every instruction run, so idle loops run each iteration while tracing
+				if (trace != nullptr) {
+					idleCycles = 0;
+				}
+				scheduler.advance(executor.runIdleLoop(block, idleCycles));
+				if (trace != nullptr) {
+					trace->recordBlock(block, start, executedInstructions(block, registers.pc));
+				}
+				// A block dropped by a write to its own memory stops before its last instruction
+				halted = !block.invalidated && block.instructions.back().opcode == HALT_OPCODE && interrupts.pending() == 0;
+			}
+		}
+
+		handleDueEvents();
+		return scheduler.now() - start;
+	}
+
+	void Machine::handleDueEvents() {
+		while (auto event = scheduler.popDue()) {
+			switch (*event) {
+				case ScheduledEvent::TIMER_OVERFLOW:
+					timer.overflow();
+					break;
+				case ScheduledEvent::LCD_MODE:
+					lcd.nextMode();
+					break;
+			}
+		}
+	}
+
+	uint8_t Machine::IoPorts::read(uint16_t address) {
+		if (address >= Timer::DIV && address <= Timer::TAC) {
+			return machine.timer.read(address);
+		}
+		if (address >= Lcd::FIRST_REGISTER && address <= Lcd::LAST_REGISTER) {
+			return machine.lcd.read(address);
+		}
+		if (address == Interrupts::IF_ADDRESS) {
+			return machine.interrupts.readFlags();
+		}
+		if (address == Interrupts::IE_ADDRESS) {
+			return machine.interrupts.enabled;
+		}
+		return other[address & 0xFF];
+	}
+
+	void Machine::IoPorts::write(uint16_t address, uint8_t value) {
+		if (address >= Timer::DIV && address <= Timer::TAC) {
+			machine.timer.write(address, value);
+		} else if (address >= Lcd::FIRST_REGISTER && address <= Lcd::LAST_REGISTER) {
+			machine.lcd.write(address, value);
+		} else if (address == Interrupts::IF_ADDRESS) {
+			machine.interrupts.writeFlags(value);
+		} else if (address == Interrupts::IE_ADDRESS) {
+			machine.interrupts.enabled = value;
+		} else {
+			other[address & 0xFF] = value;
+		}
+	}
+
+}
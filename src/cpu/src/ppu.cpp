@@ -0,0 +1,265 @@
+#include "ppu.hpp"
+
+#include <cstring>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+namespace jagce {
+
+	namespace {
+
+		typedef uint8_t Pixels __attribute__((vector_size(16)));
+		typedef uint8_t SpritePixels __attribute__((vector_size(8)));
+		typedef uint64_t Words __attribute__((vector_size(16)));
+		typedef uint32_t Doublewords __attribute__((vector_size(16)));
+
+		constexpr uint8_t LCDC_BG_ON = 0x01;
+		constexpr uint8_t LCDC_OBJ_ON = 0x02;
+		constexpr uint8_t LCDC_OBJ_TALL = 0x04;
+		constexpr uint8_t LCDC_BG_MAP = 0x08;
+		constexpr uint8_t LCDC_TILE_DATA = 0x10;
+		constexpr uint8_t LCDC_WINDOW_ON = 0x20;
+		constexpr uint8_t LCDC_WINDOW_MAP = 0x40;
+
+		constexpr uint8_t OBJ_BEHIND_BG = 0x80;
+		constexpr uint8_t OBJ_FLIP_Y = 0x40;
+		constexpr uint8_t OBJ_FLIP_X = 0x20;
+		constexpr uint8_t OBJ_PALETTE = 0x10;
+
+		// Offsets of the tile maps in video memory
+		constexpr size_t MAP_LOW = 0x1800;
+		constexpr size_t MAP_HIGH = 0x1C00;
+		constexpr size_t TILE_SIZE = 16;
+
+		// Room either side of the screen for sprites hanging off its edges
+		constexpr size_t MARGIN = 8;
+		constexpr size_t LINE_SIZE = MARGIN + Ppu::WIDTH + MARGIN;
+		// Tiles covering a line at any fine scroll, rounded up to whole vectors
+		constexpr size_t LINE_TILES = Ppu::WIDTH / 8 + 2;
+
+		using Line = std::array<uint8_t, LINE_SIZE>;
+
+		constexpr std::array<uint64_t, 256> makeSpread() {
+			std::array<uint64_t, 256> spread{};
+			for (size_t byte = 0; byte < 256; byte++) {
+				for (size_t bit = 0; bit < 8; bit++) {
+					spread[byte] |= static_cast<uint64_t>((byte >> (7 - bit)) & 1) << (bit * 8);
+				}
+			}
+			return spread;
+		}
+
+		// Each bit of a byte in a byte of its own, bit 7 in the lowest
+		constexpr std::array<uint64_t, 256> SPREAD = makeSpread();
+
+		// Rows of the background and window tiles of a line. Signed indices around 0x9000
+		// are flipped to run in the same order from 0x8800 as unsigned ones from 0x8000.
+		struct TileRows {
+			uint8_t const * base;
+			uint8_t flip;
+
+			TileRows(uint8_t const * vram, uint8_t lcdc, uint8_t fineY)
+				: base{vram + (lcdc & LCDC_TILE_DATA ? 0 : 0x800) + fineY * 2},
+					flip{static_cast<uint8_t>(lcdc & LCDC_TILE_DATA ? 0x00 : 0x80)} {}
+
+			// The lo plane in the low byte and hi in the high byte
+			uint32_t planes(uint8_t index) const {
+				uint16_t planes;
+				memcpy(&planes, base + (index ^ flip) * TILE_SIZE, sizeof(planes));
+				return planes;
+			}
+		};
+
+		/*
+		 * Decodes a row of two tiles, given as their planes. Byte shuffles repeat each plane
+		 * byte across the lanes of its tile, and a mask picks out the bit of each lane.
+		 */
+		Pixels decodeTilePair(uint32_t left, uint32_t right) {
+			const Pixels bits = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+#if defined(__SSSE3__) || defined(__ARM_NEON)
+			const Pixels rows = reinterpret_cast<Pixels>(Doublewords{ left | right << 16, 0, 0, 0 });
+			const Pixels lo = __builtin_shufflevector(rows, rows, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2);
+			const Pixels hi = __builtin_shufflevector(rows, rows, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3, 3, 3, 3);
+#else
+			// Without a byte shuffle, multiplying repeats a byte across a word
+			constexpr uint64_t REPEAT = 0x0101010101010101;
+			const Pixels lo = reinterpret_cast<Pixels>(Words{ (left & 0xFF) * REPEAT, (right & 0xFF) * REPEAT });
+			const Pixels hi = reinterpret_cast<Pixels>(Words{ (left >> 8) * REPEAT, (right >> 8) * REPEAT });
+#endif
+			return (reinterpret_cast<Pixels>((lo & bits) != 0) & 1) | (reinterpret_cast<Pixels>((hi & bits) != 0) & 2);
+		}
+
+		/*
+		 * Maps a vector of pixel indices to shades. A byte shuffle (pshufb) looks them up
+		 * when the target has one, as GCC otherwise shuffles byte by byte; without one each
+		 * shade is selected by comparing the indices.
+		 */
+		template <typename V>
+		struct Palette {
+			V shades;
+			std::array<V, 4> broadcast;
+
+			explicit Palette(uint8_t palette) : shades{}, broadcast{} {
+				for (int i = 0; i < 4; i++) {
+					shades[i] = (palette >> (i * 2)) & 3;
+					broadcast[i] = V{} + shades[i];
+				}
+			}
+
+			V apply(V indices) const {
+#if defined(__SSSE3__) || defined(__ARM_NEON)
+				return __builtin_shuffle(shades, indices);
+#else
+				return (reinterpret_cast<V>(indices == 1) & broadcast[1]) | (reinterpret_cast<V>(indices == 2) & broadcast[2])
+					| (reinterpret_cast<V>(indices == 3) & broadcast[3]) | (reinterpret_cast<V>(indices == 0) & broadcast[0]);
+#endif
+			}
+		};
+
+		void applyPalette(uint8_t const * indices, uint8_t palette, uint8_t* out) {
+			const Palette<Pixels> shades{palette};
+			for (size_t i = 0; i < Ppu::WIDTH; i += sizeof(Pixels)) {
+				Pixels pixels;
+				memcpy(&pixels, indices + i, sizeof(pixels));
+				pixels = shades.apply(pixels);
+				memcpy(out + i, &pixels, sizeof(pixels));
+			}
+		}
+
+		// Decodes tiles of a map row from a tile column on into out, rounded up to an even number
+		void decodeMapRow(uint8_t const * map, size_t column, size_t tiles, const TileRows& rows, uint8_t* out) {
+			for (size_t i = 0; i < tiles; i += 2) {
+				const Pixels pixels = decodeTilePair(rows.planes(map[(column + i) & 31]), rows.planes(map[(column + i + 1) & 31]));
+				memcpy(out + i * 8, &pixels, sizeof(pixels));
+			}
+		}
+
+	}
+
+	uint64_t decodeTileRow(uint8_t lo, uint8_t hi) {
+#ifdef __BMI2__
+		return __builtin_bswap64(_pdep_u64(lo, 0x0101010101010101) | _pdep_u64(hi, 0x0202020202020202));
+#else
+		return SPREAD[lo] | SPREAD[hi] << 1;
+#endif
+	}
+
+	Ppu::Ppu(const RandomAccessMemory& memory) : memory{memory}, frame{}, windowLine{0}, frames{0} {
+	}
+
+	void Ppu::renderLine(uint8_t line, const Lcd& lcd) {
+		if (line >= HEIGHT) {
+			return;
+		}
+		const uint8_t lcdc = lcd.read(Lcd::LCDC);
+		std::array<uint8_t, OAM_SIZE> oam;
+		if (lcdc & LCDC_OBJ_ON) {
+			// Copied first, as the next read may reuse the memory a copy is returned in
+			memcpy(oam.data(), memory.readBytes(OAM, OAM_SIZE), OAM_SIZE);
+		}
+		uint8_t const * vram = memory.readBytes(VRAM, VRAM_SIZE);
+		if (line == 0) {
+			windowLine = 0;
+		}
+
+		// Background and window pixel indices, which sprite priority looks at
+		alignas(16) Line indices{};
+		alignas(16) std::array<uint8_t, LINE_TILES * 8> decoded;
+		if (lcdc & LCDC_BG_ON) {
+			const uint8_t scx = lcd.read(Lcd::SCX);
+			const uint8_t y = static_cast<uint8_t>(lcd.read(Lcd::SCY) + line);
+			decodeMapRow(vram + (lcdc & LCDC_BG_MAP ? MAP_HIGH : MAP_LOW) + (y / 8) * 32, scx / 8, LINE_TILES,
+				TileRows{vram, lcdc, static_cast<uint8_t>(y % 8)}, decoded.data());
+			memcpy(indices.data() + MARGIN, decoded.data() + (scx & 7), WIDTH);
+
+			const uint8_t wx = lcd.read(Lcd::WX);
+			if ((lcdc & LCDC_WINDOW_ON) && line >= lcd.read(Lcd::WY) && wx < WIDTH + 7) {
+				// The window starts at WX - 7, cut off on the left below 7
+				const size_t start = wx < 7 ? 0 : wx - 7;
+				const size_t skip = wx < 7 ? 7 - wx : 0;
+				decodeMapRow(vram + (lcdc & LCDC_WINDOW_MAP ? MAP_HIGH : MAP_LOW) + (windowLine / 8) * 32, 0,
+					(skip + WIDTH - start + 7) / 8, TileRows{vram, lcdc, static_cast<uint8_t>(windowLine % 8)}, decoded.data());
+				memcpy(indices.data() + MARGIN + start, decoded.data() + skip, WIDTH - start);
+				windowLine++;
+			}
+		}
+
+		// With the background off the line is white, whatever BGP maps index 0 to
+		alignas(16) Line shades{};
+		if (lcdc & LCDC_BG_ON) {
+			applyPalette(indices.data() + MARGIN, lcd.read(Lcd::BGP), shades.data() + MARGIN);
+		}
+
+		if (lcdc & LCDC_OBJ_ON) {
+			const unsigned height = lcdc & LCDC_OBJ_TALL ? 16 : 8;
+			// Sprites on the line as bits, without branches as sprite Y is hard to predict. Above
+			// the line the difference wraps past any height.
+			uint64_t onLine = 0;
+			for (size_t i = 0; i < OAM_SIZE / 4; i++) {
+				onLine |= static_cast<uint64_t>(static_cast<uint8_t>(line + 16 - oam[i * 4]) < height) << i;
+			}
+			// The first ten in OAM order, whether or not they are on screen
+			std::array<uint8_t, SPRITES_PER_LINE> sprites;
+			size_t count = 0;
+			for (; onLine != 0 && count < SPRITES_PER_LINE; onLine &= onLine - 1) {
+				sprites[count++] = static_cast<uint8_t>(__builtin_ctzll(onLine));
+			}
+			// Lower X wins, then lower OAM index
+			for (size_t i = 1; i < count; i++) {
+				const uint8_t sprite = sprites[i];
+				size_t j = i;
+				for (; j > 0 && oam[sprites[j - 1] * 4 + 1] > oam[sprite * 4 + 1]; j--) {
+					sprites[j] = sprites[j - 1];
+				}
+				sprites[j] = sprite;
+			}
+
+			const Palette<SpritePixels> palettes[2] = { Palette<SpritePixels>{lcd.read(Lcd::OBP0)},
+				Palette<SpritePixels>{lcd.read(Lcd::OBP1)} };
+			// Pixels taken by a sprite with higher priority, even where the background hides it
+			alignas(16) Line taken{};
+			for (size_t i = 0; i < count; i++) {
+				uint8_t const * attributes = oam.data() + sprites[i] * 4;
+				const size_t x = attributes[1];
+				const uint8_t flags = attributes[3];
+				if (x == 0 || x >= WIDTH + MARGIN) {
+					continue;
+				}
+				unsigned row = line + 16u - attributes[0];
+				if (flags & OBJ_FLIP_Y) {
+					row = height - 1 - row;
+				}
+				const uint8_t tile = height == 16 ? attributes[2] & 0xFE : attributes[2];
+				uint8_t const * planes = vram + tile * TILE_SIZE + row * 2;
+				uint64_t row8 = decodeTileRow(planes[0], planes[1]);
+				if (flags & OBJ_FLIP_X) {
+					row8 = __builtin_bswap64(row8);
+				}
+
+				// Buffers start MARGIN pixels left of the screen, where sprite X is 0
+				SpritePixels pixels, background, taker, line8;
+				memcpy(&pixels, &row8, sizeof(pixels));
+				memcpy(&background, indices.data() + x, sizeof(background));
+				memcpy(&taker, taken.data() + x, sizeof(taker));
+				memcpy(&line8, shades.data() + x, sizeof(line8));
+
+				const SpritePixels opaque = reinterpret_cast<SpritePixels>(pixels != 0) & ~taker;
+				const SpritePixels shown = flags & OBJ_BEHIND_BG ? opaque & reinterpret_cast<SpritePixels>(background == 0) : opaque;
+				const SpritePixels spriteShades = palettes[(flags & OBJ_PALETTE) ? 1 : 0].apply(pixels);
+				line8 = (line8 & ~shown) | (spriteShades & shown);
+				taker |= opaque;
+
+				memcpy(shades.data() + x, &line8, sizeof(line8));
+				memcpy(taken.data() + x, &taker, sizeof(taker));
+			}
+		}
+
+		memcpy(frame.data() + line * WIDTH, shades.data() + MARGIN, WIDTH);
+		if (line == HEIGHT - 1) {
+			frames++;
+		}
+	}
+
+}
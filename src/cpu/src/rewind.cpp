@@ -0,0 +1,344 @@
+#include "rewind.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace jagce {
+
+	namespace {
+
+		constexpr uint64_t NO_KEYFRAME = std::numeric_limits<uint64_t>::max();
+
+		/*
+		 * Runs are a 16-bit count of bytes equal to the reference, a 16-bit count of
+		 * literals, and the literals XORed with the reference. The runs of a region cover
+		 * all of it. Gaps shorter than MIN_GAP are cheaper kept in the literals.
+		 */
+		constexpr size_t MAX_RUN = 0xFFFF;
+		constexpr size_t MIN_GAP = 4;
+		constexpr size_t RUN_HEADER_SIZE = 4;
+
+		// How many times more a byte of runs costs to patch into memory than to copy whole
+		constexpr size_t PATCH_COST = 8;
+
+		// Every run header but the last is followed by at least MIN_GAP bytes of input
+		constexpr size_t maxRunsSize(size_t size) {
+			return size + RUN_HEADER_SIZE * (size / MIN_GAP + 1);
+		}
+
+		// Encodes bytes against reference, or against zeros when it's nullptr
+		size_t encodeRuns(uint8_t const * bytes, uint8_t const * reference, size_t size, uint8_t* out) {
+			const auto differs = [bytes, reference](size_t i) {
+				return bytes[i] != (reference == nullptr ? 0 : reference[i]);
+			};
+
+			uint8_t* const start = out;
+			size_t i = 0;
+			while (i < size) {
+				size_t same = 0;
+				while (i + same < size && same < MAX_RUN && !differs(i + same)) {
+					same++;
+				}
+				const size_t from = i + same;
+				size_t literals = 0;
+				size_t gap = 0;
+				while (from + literals + gap < size && literals + gap < MAX_RUN) {
+					if (differs(from + literals + gap)) {
+						literals += gap + 1;
+						gap = 0;
+					} else if (++gap == MIN_GAP) {
+						break;
+					}
+				}
+
+				const uint16_t header[2] = { static_cast<uint16_t>(same), static_cast<uint16_t>(literals) };
+				memcpy(out, header, RUN_HEADER_SIZE);
+				out += RUN_HEADER_SIZE;
+				for (size_t j = 0; j < literals; j++) {
+					out[j] = static_cast<uint8_t>(bytes[from + j] ^ (reference == nullptr ? 0 : reference[from + j]));
+				}
+				out += literals;
+				i = from + literals;
+			}
+			return static_cast<size_t>(out - start);
+		}
+
+		// Calls f(index, literals, num) for each run of a region, returns the end of its runs
+		template <typename F>
+		uint8_t const * forEachRun(uint8_t const * runs, size_t size, F f) {
+			size_t index = 0;
+			while (index < size) {
+				uint16_t header[2];
+				memcpy(header, runs, RUN_HEADER_SIZE);
+				runs += RUN_HEADER_SIZE;
+				index += header[0];
+				if (header[1] != 0) {
+					f(index, runs, static_cast<size_t>(header[1]));
+				}
+				runs += header[1];
+				index += header[1];
+			}
+			return runs;
+		}
+
+	}
+
+	RewindBuffer::RewindBuffer(Registers& registers, size_t maxCaptures, size_t storageSize, size_t keyframeInterval)
+		: registers{registers}, regions{}, keyframeInterval{keyframeInterval}, captures(maxCaptures), first{0},
+			count{0}, storage(storageSize), head{0}, used{0}, nextSequence{0}, keyframe{}, keyframeSequence{NO_KEYFRAME},
+			scratch{}, synced{}, isSynced{false} {
+		if (maxCaptures == 0 || keyframeInterval == 0) {
+			throw std::invalid_argument("A rewind buffer needs room for a capture and a keyframe interval");
+		}
+	}
+
+	void RewindBuffer::addMemory(RandomAccessMemory& memory) {
+		addRegion(memory, 0, nullptr, nullptr);
+	}
+
+	void RewindBuffer::addRegion(RandomAccessMemory& memory, size_t pageSize, std::function<bool(size_t)> isPageDirty,
+			std::function<void()> clearDirtyPages) {
+		if (nextSequence != 0) {
+			throw std::logic_error("Memory can't be added to a rewind buffer after capturing");
+		}
+		const size_t offset = keyframe.size();
+		const size_t pages = pageSize == 0 ? 0 : (memory.size() + pageSize - 1) / pageSize;
+		regions.push_back({&memory, offset, memory.size(), pageSize, std::move(isPageDirty), std::move(clearDirtyPages),
+			std::vector<uint8_t>(pages)});
+
+		keyframe.resize(offset + memory.size());
+		size_t runsSize = 0;
+		for (const Region& region : regions) {
+			runsSize += maxRunsSize(region.size);
+		}
+		scratch.resize(std::max(runsSize, keyframe.size()));
+	}
+
+	void RewindBuffer::capture() {
+		const bool needsKeyframe = count == 0 || at(count - 1).keyframeSequence != keyframeSequence
+			|| at(count - 1).sinceKeyframe + 1 >= keyframeInterval;
+		capture(needsKeyframe);
+	}
+
+	void RewindBuffer::capture(bool asKeyframe) {
+		size_t size = 0;
+		for (const Region& region : regions) {
+			uint8_t const * bytes = region.memory->readBytes(0, region.size);
+			size += encodeRuns(bytes, asKeyframe ? nullptr : keyframe.data() + region.offset, region.size, scratch.data() + size);
+		}
+
+		if (count == captures.size()) {
+			dropOldest();
+		}
+		const size_t offset = allocate(size);
+		// Making room may have dropped the keyframe this delta is against
+		if (!asKeyframe && (count == 0 || at(0).sequence > keyframeSequence)) {
+			// The keyframe goes where the delta would have, not after it
+			head = offset;
+			capture(true);
+			return;
+		}
+		memcpy(storage.data() + offset, scratch.data(), size);
+		// Only once allocating can no longer throw, so a failed capture leaves the keyframe as it was
+		if (asKeyframe) {
+			for (const Region& region : regions) {
+				memcpy(keyframe.data() + region.offset, region.memory->readBytes(0, region.size), region.size);
+			}
+		}
+
+		const uint64_t sequence = nextSequence++;
+		Capture captured{sequence, sequence, 0, offset, size, offset, size, {}};
+		if (!asKeyframe) {
+			const Capture& previous = at(count - 1);
+			captured.keyframeSequence = previous.keyframeSequence;
+			captured.sinceKeyframe = previous.sinceKeyframe + 1;
+			captured.keyframeOffset = previous.keyframeOffset;
+			captured.keyframeSize = previous.keyframeSize;
+		} else {
+			keyframeSequence = sequence;
+		}
+		captured.registers = {registers.r8, registers.sp, registers.pc};
+		captured.registers.r8[REGISTER_F] = registers.f();
+
+		at(count) = captured;
+		count++;
+		used += size;
+
+		for (Region& region : regions) {
+			if (region.clearDirtyPages) {
+				region.clearDirtyPages();
+			}
+		}
+		synced = captured;
+		isSynced = true;
+	}
+
+	size_t RewindBuffer::allocate(size_t size) {
+		if (size > storage.size()) {
+			throw std::length_error("Rewind storage is too small for a keyframe");
+		}
+		size_t offset = head;
+		if (offset + size > storage.size()) {
+			// What's left above head is from the previous pass and is the oldest
+			while (count > 0 && at(0).offset >= head) {
+				dropOldest();
+			}
+			offset = 0;
+		}
+		while (count > 0 && at(0).offset >= offset && at(0).offset < offset + size) {
+			dropOldest();
+		}
+		head = offset + size;
+		return offset;
+	}
+
+	void RewindBuffer::dropOldest() {
+		// Deltas go with their keyframe
+		do {
+			used -= at(0).size;
+			first = (first + 1) % captures.size();
+			count--;
+		} while (count > 0 && !at(0).isKeyframe());
+		if (count == 0) {
+			head = 0;
+		}
+	}
+
+	bool RewindBuffer::stepBack() {
+		if (count == 0) {
+			return false;
+		}
+		// Its runs stay in storage until the next capture
+		const Capture target = at(count - 1);
+		count--;
+		used -= target.size;
+		head = count == 0 ? 0 : target.offset;
+
+		// Patching costs a couple of virtual calls per run, so large deltas are cheaper to restore whole
+		const bool fromSynced = isSynced && synced.keyframeSequence == target.keyframeSequence
+			&& keyframeSequence == target.keyframeSequence
+			&& (synced.size + target.size) * PATCH_COST < keyframe.size();
+		if (keyframeSequence != target.keyframeSequence) {
+			decodeKeyframe(target);
+		}
+
+		// Keyframes are no different from themselves
+		uint8_t const * targetRuns = target.isKeyframe() ? nullptr : storage.data() + target.offset;
+		uint8_t const * syncedRuns = !fromSynced || synced.isKeyframe() ? nullptr : storage.data() + synced.offset;
+		for (Region& region : regions) {
+			if (fromSynced && region.pageSize != 0) {
+				for (size_t page = 0; page < region.dirty.size(); page++) {
+					region.dirty[page] = region.isPageDirty(page);
+				}
+				// Clean pages hold the synced capture, so both deltas take them to the target
+				syncedRuns = xorIntoClean(region, syncedRuns);
+				restoreDirty(region, targetRuns);
+				targetRuns = xorIntoClean(region, targetRuns);
+			} else {
+				uint8_t* bytes = scratch.data() + region.offset;
+				memcpy(bytes, keyframe.data() + region.offset, region.size);
+				if (targetRuns != nullptr) {
+					targetRuns = forEachRun(targetRuns, region.size, [bytes](size_t index, uint8_t const * literals, size_t num) {
+						for (size_t i = 0; i < num; i++) {
+							bytes[index + i] ^= literals[i];
+						}
+					});
+				}
+				if (syncedRuns != nullptr) {
+					syncedRuns = forEachRun(syncedRuns, region.size, [](size_t, uint8_t const *, size_t) {});
+				}
+				region.memory->writeBytes(0, bytes, region.size);
+			}
+			if (region.clearDirtyPages) {
+				region.clearDirtyPages();
+			}
+		}
+
+		registers.r8 = target.registers.r8;
+		registers.setF(target.registers.r8[REGISTER_F]);
+		registers.sp = target.registers.sp;
+		registers.pc = target.registers.pc;
+
+		synced = target;
+		isSynced = true;
+		return true;
+	}
+
+	void RewindBuffer::clear() {
+		first = 0;
+		count = 0;
+		head = 0;
+		used = 0;
+		keyframeSequence = NO_KEYFRAME;
+		isSynced = false;
+	}
+
+	void RewindBuffer::decodeKeyframe(const Capture& capture) {
+		uint8_t const * runs = storage.data() + capture.keyframeOffset;
+		for (const Region& region : regions) {
+			uint8_t* bytes = keyframe.data() + region.offset;
+			memset(bytes, 0, region.size);
+			runs = forEachRun(runs, region.size, [bytes](size_t index, uint8_t const * literals, size_t num) {
+				memcpy(bytes + index, literals, num);
+			});
+		}
+		keyframeSequence = capture.keyframeSequence;
+	}
+
+	uint8_t const * RewindBuffer::xorIntoClean(const Region& region, uint8_t const * runs) {
+		if (runs == nullptr) {
+			return nullptr;
+		}
+		return forEachRun(runs, region.size, [&region](size_t index, uint8_t const * literals, size_t num) {
+			std::array<uint8_t, 256> bytes;
+			while (num > 0) {
+				const size_t page = index / region.pageSize;
+				const size_t chunk = std::min({num, bytes.size(), (page + 1) * region.pageSize - index});
+				if (!region.dirty[page]) {
+					uint8_t const * current = region.memory->readBytes(index, chunk);
+					for (size_t i = 0; i < chunk; i++) {
+						bytes[i] = static_cast<uint8_t>(current[i] ^ literals[i]);
+					}
+					region.memory->writeBytes(index, bytes.data(), chunk);
+				}
+				index += chunk;
+				literals += chunk;
+				num -= chunk;
+			}
+		});
+	}
+
+	void RewindBuffer::restoreDirty(const Region& region, uint8_t const * runs) {
+		uint8_t* bytes = scratch.data() + region.offset;
+		const auto pageSize = [&region](size_t page) {
+			return std::min(region.pageSize, region.size - page * region.pageSize);
+		};
+
+		for (size_t page = 0; page < region.dirty.size(); page++) {
+			if (region.dirty[page]) {
+				const size_t index = page * region.pageSize;
+				memcpy(bytes + index, keyframe.data() + region.offset + index, pageSize(page));
+			}
+		}
+		if (runs != nullptr) {
+			forEachRun(runs, region.size, [&region, bytes](size_t index, uint8_t const * literals, size_t num) {
+				for (size_t i = 0; i < num; i++) {
+					if (region.dirty[(index + i) / region.pageSize]) {
+						bytes[index + i] ^= literals[i];
+					}
+				}
+			});
+		}
+		for (size_t page = 0; page < region.dirty.size(); page++) {
+			if (region.dirty[page]) {
+				const size_t index = page * region.pageSize;
+				region.memory->writeBytes(index, bytes + index, pageSize(page));
+			}
+		}
+	}
+
+}
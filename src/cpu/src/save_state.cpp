@@ -0,0 +1,158 @@
+#include "save_state.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "lz.hpp"
+
+namespace jagce {
+
+	namespace {
+
+		constexpr size_t HEADER_SIZE = sizeof(SaveStateHeader);
+		constexpr size_t SECTION_HEADER_SIZE = sizeof(SaveStateSectionHeader);
+
+		constexpr size_t aligned(size_t size) {
+			constexpr size_t ALIGNMENT = SaveStateSectionHeader::SECTION_ALIGNMENT;
+			return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+		}
+
+		uint8_t* writeSection(uint8_t* out, SaveStateSection id, uint8_t const * data, size_t size) {
+			const SaveStateSectionHeader header{id, 0, size};
+			memcpy(out, &header, SECTION_HEADER_SIZE);
+			memcpy(out + SECTION_HEADER_SIZE, data, size);
+			memset(out + SECTION_HEADER_SIZE + size, 0, aligned(size) - size);
+			return out + SECTION_HEADER_SIZE + aligned(size);
+		}
+
+		SaveStateSection memorySection(size_t index) {
+			return static_cast<SaveStateSection>(static_cast<uint32_t>(SaveStateSection::MEMORY) + index);
+		}
+
+	}
+
+	SaveState::SaveState(Registers& registers) : registers{registers}, memories{}, payload{} {
+	}
+
+	void SaveState::addMemory(RandomAccessMemory& memory) {
+		memories.push_back(&memory);
+	}
+
+	size_t SaveState::size() const {
+		return HEADER_SIZE + payloadSize();
+	}
+
+	void SaveState::save(std::vector<uint8_t>& out, bool compress) const {
+		SaveStateHeader header{SAVE_STATE_MAGIC, SAVE_STATE_VERSION, 0,
+			static_cast<uint32_t>(1 + memories.size()), 0, payloadSize(), payloadSize()};
+
+		if (compress) {
+			payload.resize(header.payloadSize);
+			writePayload(payload.data());
+
+			out.resize(HEADER_SIZE);
+			header.flags |= SaveStateHeader::COMPRESSED;
+			header.storedSize = lzCompress(payload.data(), payload.size(), out);
+		} else {
+			out.resize(HEADER_SIZE + header.payloadSize);
+			writePayload(out.data() + HEADER_SIZE);
+		}
+
+		memcpy(out.data(), &header, HEADER_SIZE);
+	}
+
+	void SaveState::load(uint8_t const * data, size_t size) {
+		SaveStateHeader header;
+		if (size < HEADER_SIZE) {
+			throw std::invalid_argument("Save state of " + std::to_string(size) + " bytes is too small for its header");
+		}
+		memcpy(&header, data, HEADER_SIZE);
+
+		if (header.magic != SAVE_STATE_MAGIC) {
+			throw std::invalid_argument("Data is not a save state");
+		}
+		if (header.version != SAVE_STATE_VERSION) {
+			throw std::invalid_argument("Save state version " + std::to_string(header.version)
+					+ " is not supported, expected " + std::to_string(SAVE_STATE_VERSION));
+		}
+		if (header.storedSize != size - HEADER_SIZE) {
+			throw std::invalid_argument("Save state is truncated");
+		}
+		// Sizes come from the data, so check them before anything is read or allocated
+		const bool compressed = header.flags & SaveStateHeader::COMPRESSED;
+		if (header.payloadSize != payloadSize() || (!compressed && header.storedSize != header.payloadSize)) {
+			throw std::invalid_argument("Save state payload of " + std::to_string(header.payloadSize)
+					+ " bytes does not match this state");
+		}
+
+		if (compressed) {
+			payload.resize(header.payloadSize);
+			lzDecompress(data + HEADER_SIZE, header.storedSize, payload.data(), payload.size());
+			readPayload(payload.data(), payload.size(), header.sectionCount);
+		} else {
+			readPayload(data + HEADER_SIZE, header.payloadSize, header.sectionCount);
+		}
+	}
+
+	size_t SaveState::payloadSize() const {
+		size_t size = SECTION_HEADER_SIZE + aligned(sizeof(RegisterState));
+		for (RandomAccessMemory const * memory : memories) {
+			size += SECTION_HEADER_SIZE + aligned(memory->size());
+		}
+		return size;
+	}
+
+	void SaveState::writePayload(uint8_t* out) const {
+		RegisterState state{registers.r8, registers.sp, registers.pc};
+		state.r8[REGISTER_F] = registers.f();
+		out = writeSection(out, SaveStateSection::REGISTERS, reinterpret_cast<uint8_t const *>(&state), sizeof(state));
+
+		for (size_t i = 0; i < memories.size(); i++) {
+			const size_t size = memories[i]->size();
+			out = writeSection(out, memorySection(i), memories[i]->readBytes(0, size), size);
+		}
+	}
+
+	void SaveState::readPayload(uint8_t const * in, size_t size, uint32_t sectionCount) {
+		if (sectionCount != 1 + memories.size()) {
+			throw std::invalid_argument("Save state has " + std::to_string(sectionCount) + " sections, expected "
+					+ std::to_string(1 + memories.size()));
+		}
+
+		// Check every section before changing anything, so a bad save leaves the state as it was
+		std::vector<uint8_t const *> sections(sectionCount);
+		size_t offset = 0;
+		for (size_t i = 0; i < sectionCount; i++) {
+			SaveStateSectionHeader header;
+			if (size - offset < SECTION_HEADER_SIZE) {
+				throw std::invalid_argument("Save state section " + std::to_string(i) + " is truncated");
+			}
+			memcpy(&header, in + offset, SECTION_HEADER_SIZE);
+
+			const SaveStateSection id = i == 0 ? SaveStateSection::REGISTERS : memorySection(i - 1);
+			const size_t expectedSize = i == 0 ? sizeof(RegisterState) : memories[i - 1]->size();
+			if (header.id != id || header.size != expectedSize) {
+				throw std::invalid_argument("Save state section " + std::to_string(i) + " does not match this state");
+			}
+			if (size - offset - SECTION_HEADER_SIZE < aligned(expectedSize)) {
+				throw std::invalid_argument("Save state section " + std::to_string(i) + " is truncated");
+			}
+
+			sections[i] = in + offset + SECTION_HEADER_SIZE;
+			offset += SECTION_HEADER_SIZE + aligned(expectedSize);
+		}
+
+		RegisterState state;
+		memcpy(&state, sections[0], sizeof(state));
+		registers.r8 = state.r8;
+		registers.setF(state.r8[REGISTER_F]);
+		registers.sp = state.sp;
+		registers.pc = state.pc;
+
+		for (size_t i = 0; i < memories.size(); i++) {
+			memories[i]->writeBytes(0, sections[i + 1], memories[i]->size());
+		}
+	}
+
+}
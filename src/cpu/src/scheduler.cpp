@@ -0,0 +1,102 @@
+#include "scheduler.hpp"
+
+#include <stdexcept>
+
+namespace jagce {
+
+	Scheduler::Scheduler() : time{0}, heap{}, positions{}, count{0} {
+		positions.fill(NOT_SCHEDULED);
+	}
+
+	void Scheduler::schedule(ScheduledEvent event, uint64_t time) {
+		const size_t id = static_cast<size_t>(event);
+		if (positions[id] != NOT_SCHEDULED) {
+			remove(positions[id]);
+		}
+		place(count, {time, event});
+		count++;
+		siftUp(count - 1);
+	}
+
+	void Scheduler::cancel(ScheduledEvent event) {
+		const size_t id = static_cast<size_t>(event);
+		if (positions[id] != NOT_SCHEDULED) {
+			remove(positions[id]);
+		}
+	}
+
+	bool Scheduler::isScheduled(ScheduledEvent event) const {
+		return positions[static_cast<size_t>(event)] != NOT_SCHEDULED;
+	}
+
+	uint64_t Scheduler::timeOf(ScheduledEvent event) const {
+		const uint8_t position = positions[static_cast<size_t>(event)];
+		if (position == NOT_SCHEDULED) {
+			throw std::invalid_argument("Event is not scheduled");
+		}
+		return heap[position].time;
+	}
+
+	std::optional<ScheduledEvent> Scheduler::popDue() {
+		if (count == 0 || heap[0].time > time) {
+			return std::nullopt;
+		}
+		const ScheduledEvent event = heap[0].event;
+		remove(0);
+		return event;
+	}
+
+	void Scheduler::remove(size_t index) {
+		positions[static_cast<size_t>(heap[index].event)] = NOT_SCHEDULED;
+		count--;
+		if (index == count) {
+			return;
+		}
+		// The last entry fills the hole and moves whichever way it's out of order
+		const Entry moved = heap[count];
+		place(index, moved);
+		siftUp(index);
+		siftDown(positions[static_cast<size_t>(moved.event)]);
+	}
+
+	void Scheduler::siftUp(size_t index) {
+		const Entry entry = heap[index];
+		while (index > 0) {
+			const size_t parent = (index - 1) / 2;
+			if (!(entry < heap[parent])) {
+				break;
+			}
+			place(index, heap[parent]);
+			index = parent;
+		}
+		place(index, entry);
+	}
+
+	void Scheduler::siftDown(size_t index) {
+		if (index >= count) {
+			return;
+		}
+		const Entry entry = heap[index];
+		while (true) {
+			size_t child = 2 * index + 1;
+			if (child >= count) {
+				break;
+			}
+			if (child + 1 < count && heap[child + 1] < heap[child]) {
+				child++;
+			}
+			if (!(heap[child] < entry)) {
+				break;
+			}
+			place(index, heap[child]);
+			index = child;
+		}
+		place(index, entry);
+	}
+
+	void Scheduler::place(size_t index, Entry entry) {
+		heap[index] = entry;
+		positions[static_cast<size_t>(entry.event)] = static_cast<uint8_t>(index);
+	}
+
+}
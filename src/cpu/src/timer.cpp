@@ -0,0 +1,96 @@
+#include "timer.hpp"
+
+#include <algorithm>
+
+namespace jagce {
+
+	Timer::Timer(Scheduler& scheduler, Interrupts& interrupts)
+		: scheduler{scheduler}, interrupts{interrupts}, divReset{scheduler.now()}, synced{scheduler.now()},
+		tima{0}, tma{0}, tac{0} {}
+
+	uint8_t Timer::read(uint16_t address) {
+		switch (address) {
+			case DIV:
+				return static_cast<uint8_t>(divider() >> 8);
+			case TIMA:
+				sync();
+				return tima;
+			case TMA:
+				return tma;
+			case TAC:
+				return tac | 0xF8;
+			default:
+				return 0xFF;
+		}
+	}
+
+	void Timer::write(uint16_t address, uint8_t value) {
+		sync();
+		switch (address) {
+			case DIV:
+				divReset = scheduler.now();
+				break;
+			case TIMA:
+				tima = value;
+				break;
+			case TMA:
+				tma = value;
+				break;
+			case TAC:
+				tac = value & 0x07;
+				break;
+			default:
+				return;
+		}
+		reschedule();
+	}
+
+	void Timer::overflow() {
+		sync();
+		reschedule();
+	}
+
+	uint64_t Timer::cyclesUntilCount() const {
+		constexpr uint64_t DIV_PERIOD = 0x100;
+		uint64_t cycles = DIV_PERIOD - divider() % DIV_PERIOD;
+		if (enabled()) {
+			cycles = std::min(cycles, period() - divider() % period());
+		}
+		return cycles;
+	}
+
+	uint64_t Timer::period() const {
+		switch (tac & 0x03) {
+			case 0: return 1024;
+			case 1: return 16;
+			case 2: return 64;
+			default: return 256;
+		}
+	}
+
+	void Timer::sync() {
+		const uint64_t now = scheduler.now();
+		if (enabled()) {
+			uint64_t ticks = (now - divReset) / period() - (synced - divReset) / period();
+			if (tima + ticks > 0xFF) {
+				// Every overflow reloads TMA, late ones raise one interrupt between them
+				ticks -= 0x100 - tima;
+				tima = static_cast<uint8_t>(tma + ticks % (0x100 - tma));
+				interrupts.request(INTERRUPT_TIMER);
+			} else {
+				tima = static_cast<uint8_t>(tima + ticks);
+			}
+		}
+		synced = now;
+	}
+
+	void Timer::reschedule() {
+		if (!enabled()) {
+			scheduler.cancel(ScheduledEvent::TIMER_OVERFLOW);
+			return;
+		}
+		const uint64_t ticks = (scheduler.now() - divReset) / period() + (0x100 - tima);
+		scheduler.schedule(ScheduledEvent::TIMER_OVERFLOW, divReset + ticks * period());
+	}
+
+}
@@ -0,0 +1,144 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <stdexcept>
+
+#include "cycles.hpp"
+
+namespace jagce {
+
+	namespace {
+
+		constexpr size_t DRAIN_CHUNK = 4096;
+		// How long the writer sleeps when the ring is empty
+		constexpr std::chrono::microseconds IDLE_WAIT{200};
+
+		size_t roundUpToPowerOfTwo(size_t size) {
+			size_t rounded = 1;
+			while (rounded < size) {
+				rounded <<= 1;
+			}
+			return rounded;
+		}
+
+	}
+
+	TraceRing::TraceRing(size_t capacity)
+		: records(roundUpToPowerOfTwo(std::max<size_t>(capacity, 1))), mask{records.size() - 1},
+			head{0}, tail{0}, producer{0, 0}, consumer{0, 0} {
+	}
+
+	size_t TraceRing::pop(TraceRecord* out, size_t max) {
+		const size_t tail = consumer.tail;
+		if (consumer.cachedHead - tail < max) {
+			consumer.cachedHead = head.load(std::memory_order_acquire);
+		}
+		const size_t count = std::min(max, consumer.cachedHead - tail);
+		for (size_t i = 0; i < count; i++) {
+			out[i] = records[(tail + i) & mask];
+		}
+		consumer.tail = tail + count;
+		this->tail.store(tail + count, std::memory_order_release);
+		return count;
+	}
+
+	TraceWriter::TraceWriter(const std::string& path, size_t capacity)
+		: ring{capacity}, file{std::fopen(path.c_str(), "wb")}, closing{false}, error{},
+			recorded{0}, stalls{0}, written{0}, writer{} {
+		if (file == nullptr) {
+			throw std::runtime_error("Could not create trace file " + path);
+		}
+		// The header is rewritten with the record count on close
+		const TraceHeader header{TRACE_MAGIC, TRACE_VERSION, sizeof(TraceRecord), 0};
+		if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+			std::fclose(file);
+			throw std::runtime_error("Could not write trace file " + path);
+		}
+		writer = std::thread{&TraceWriter::drain, this};
+	}
+
+	TraceWriter::~TraceWriter() {
+		try {
+			close();
+		} catch (...) {
+		}
+	}
+
+	void TraceWriter::recordBlock(const DecodedBlock& block, uint64_t cycle, size_t count) {
+		for (size_t i = 0; i < count && i < block.instructions.size(); i++) {
+			const DecodedInstruction& instruction = block.instructions[i];
+			record({cycle, instruction.address, instruction.opcode, 0, instruction.op});
+			cycle += opcodeCycles(instruction.opcode);
+		}
+	}
+
+	void TraceWriter::drain() {
+		std::array<TraceRecord, DRAIN_CHUNK> chunk{};
+		try {
+			while (true) {
+				// Read before popping, so everything pushed before close is written
+				const bool last = closing.load(std::memory_order_acquire);
+				const size_t count = ring.pop(chunk.data(), chunk.size());
+				if (count != 0) {
+					if (std::fwrite(chunk.data(), sizeof(TraceRecord), count, file) != count) {
+						throw std::runtime_error("Could not write trace records");
+					}
+					written += count;
+				} else if (last) {
+					return;
+				} else {
+					std::this_thread::sleep_for(IDLE_WAIT);
+				}
+			}
+		} catch (...) {
+			error = std::current_exception();
+			// Keep emptying the ring so the executing thread never waits on a dead writer
+			while (!closing.load(std::memory_order_acquire)) {
+				ring.pop(chunk.data(), chunk.size());
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void TraceWriter::close() {
+		if (file == nullptr) {
+			return;
+		}
+		closing.store(true, std::memory_order_release);
+		writer.join();
+
+		const TraceHeader header{TRACE_MAGIC, TRACE_VERSION, sizeof(TraceRecord), written};
+		const bool headerWritten = std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file) == 1;
+		const bool closed = std::fclose(file) == 0;
+		file = nullptr;
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+		if (!headerWritten || !closed) {
+			throw std::runtime_error("Could not finish the trace file");
+		}
+	}
+
+	TraceFile::TraceFile(const std::string& path) : file{MappedFile::open(path)}, records{nullptr}, count{0} {
+		TraceHeader header{};
+		if (file->size() < sizeof(header)) {
+			throw std::runtime_error("Trace file is truncated");
+		}
+		std::copy(file->data(), file->data() + sizeof(header), reinterpret_cast<uint8_t*>(&header));
+		if (header.magic != TRACE_MAGIC) {
+			throw std::runtime_error("Not a trace file");
+		}
+		if (header.version != TRACE_VERSION || header.recordSize != sizeof(TraceRecord)) {
+			throw std::runtime_error("Unsupported trace file version");
+		}
+		if ((file->size() - sizeof(header)) / sizeof(TraceRecord) < header.recordCount) {
+			throw std::runtime_error("Trace file is truncated");
+		}
+		records = reinterpret_cast<TraceRecord const *>(file->data() + sizeof(header));
+		count = header.recordCount;
+	}
+
+}
@@ -0,0 +1,62 @@
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include "batch_runner.hpp"
+
+namespace {
+
+	// Adds the instance's index to A and halts with no interrupt enabled to wake it
+	void load(jagce::Machine& machine, size_t index) {
+		// LD B,index; ADD A,B; INC C; HALT
+		const std::vector<uint8_t> code{ 0x06, static_cast<uint8_t>(index), 0x80, 0x0C, 0x76 };
+		machine.getMemory().writeBytes(0x100, code.data(), code.size());
+		machine.getMemory().writeByte(jagce::Lcd::LCDC, 0x91);
+		machine.getRegisters().pc = 0x100;
+	}
+
+}
+
+TEST_CASE("batch runner runs every instance", "[cpu], [batch_runner]") {
+	constexpr size_t INSTANCES = 37;
+	const size_t threads = GENERATE(1, 3, 8);
+	jagce::BatchRunner runner{INSTANCES, threads};
+	REQUIRE(runner.threadCount() == threads);
+
+	for (size_t i = 0; i < INSTANCES; i++) {
+		load(runner.instance(i), i);
+	}
+
+	runner.runFrames(2);
+	for (size_t i = 0; i < INSTANCES; i++) {
+		jagce::Machine reference{};
+		load(reference, i);
+		const uint64_t cycles = reference.run(2 * jagce::BatchRunner::FRAME_CYCLES);
+
+		const jagce::BatchResult& result = runner.result(i);
+		INFO("instance " << i);
+		CHECK(result.cycles == cycles);
+		CHECK(result.halted);
+		CHECK(result.registers.pc == 0x105);
+		CHECK(result.registers.get8(jagce::RegisterNames::A.getId()) == static_cast<uint8_t>(i));
+		CHECK(result.registers.get8(jagce::RegisterNames::C.getId()) == 1);
+	}
+
+	// Instances carry on from where the last batch left them
+	runner.run(1000);
+	CHECK(runner.instance(0).getScheduler().now() >= 2 * jagce::BatchRunner::FRAME_CYCLES + 1000);
+}
+
+TEST_CASE("batch runner reports instances that throw", "[cpu], [batch_runner]") {
+	jagce::BatchRunner runner{4, 2};
+	for (size_t i = 0; i < runner.size(); i++) {
+		load(runner.instance(i), i);
+	}
+	// A CB prefix in the last byte of memory, which is IE, can't be decoded
+	runner.instance(2).getMemory().writeByte(0xFFFF, 0xCB);
+	runner.instance(2).getRegisters().pc = 0xFFFF;
+
+	CHECK_THROWS(runner.run(1000));
+	CHECK(runner.result(1).halted);
+	CHECK(runner.result(3).halted);
+}
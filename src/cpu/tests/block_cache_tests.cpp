@@ -0,0 +1,201 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "bank_controller.hpp"
+#include "block_cache.hpp"
+#include "lazy_flags.hpp"
+#include "memory_bus.hpp"
+#include "static_ram.hpp"
+
+TEST_CASE("block cache decodes and invalidates blocks", "[cpu], [block_cache]") {
+	jagce::StaticRAM<0x1000> ram{};
+	jagce::WatchedMemory memory{ram};
+	jagce::BlockCache cache{memory};
+
+	// LD A,0x12; ADD A,B; INC BC; JR -5; LD B,A
+	const std::array<uint8_t, 7> code{ 0x3E, 0x12, 0x80, 0x03, 0x18, 0xFB, 0x47 };
+	ram.writeBytes(0x100, code.data(), code.size());
+
+	SECTION("blocks end after control transfers") {
+		const jagce::DecodedBlock& block = cache.getBlock(0x100);
+
+		REQUIRE(block.instructions.size() == 4);
+		CHECK(block.start == 0x100);
+		CHECK(block.end == 0x106);
+		CHECK(block.instructions.at(0).event == jagce::Event{jagce::LoadEvent8{ {jagce::RegisterNames::A}, {jagce::Immediate8{0x12}} }});
+		CHECK(block.instructions.at(0).length == 2);
+		CHECK(block.instructions.at(1).address == 0x102);
+		CHECK(block.instructions.at(2).event == jagce::Event{jagce::IncrementEvent16{ jagce::RegisterNames::BC }});
+		CHECK(block.instructions.at(3).opcode == 0x18);
+	}
+
+	SECTION("cached blocks are reused") {
+		const jagce::DecodedBlock& first = cache.getBlock(0x100);
+		const jagce::DecodedBlock& second = cache.getBlock(0x100);
+
+		CHECK(&first == &second);
+		CHECK(cache.size() == 1);
+	}
+
+	SECTION("writes to a block invalidate it") {
+		cache.getBlock(0x100);
+		cache.getBlock(0x106);
+		REQUIRE(cache.size() == 2);
+
+		const jagce::DecodedBlock& dropped = cache.getBlock(0x100);
+		memory.writeByte(0x103, 0x13);
+
+		CHECK(!cache.contains(0x100));
+		CHECK(cache.contains(0x106));
+		// Kept until the next lookup, for an executor still running it
+		CHECK(dropped.invalidated);
+		CHECK(dropped.instructions.size() == 4);
+
+		const jagce::DecodedBlock& block = cache.getBlock(0x100);
+		CHECK(block.instructions.at(2).event == jagce::Event{jagce::IncrementEvent16{ jagce::RegisterNames::DE }});
+	}
+
+	SECTION("writes outside of blocks keep them") {
+		cache.getBlock(0x100);
+
+		memory.writeByte(0x0FF, 0x00);
+		const std::array<uint8_t, 2> bytes{ 0xAA, 0xBB };
+		memory.writeBytes(0x200, bytes.data(), bytes.size());
+
+		CHECK(cache.contains(0x100));
+	}
+
+	SECTION("bulk writes overlapping a block invalidate it") {
+		cache.getBlock(0x100);
+
+		const std::array<uint8_t, 4> bytes{ 0x00, 0x00, 0x00, 0x00 };
+		memory.writeBytes(0x0FE, bytes.data(), bytes.size());
+
+		CHECK(!cache.contains(0x100));
+		CHECK(!memory.isPageWatched(0x100 / jagce::WatchedMemory::PAGE_SIZE));
+	}
+
+	SECTION("blocks stop at the end of memory") {
+		const std::array<uint8_t, 2> bytes{ 0x00, 0x00 };
+		ram.writeBytes(0xFFE, bytes.data(), bytes.size());
+
+		const jagce::DecodedBlock& block = cache.getBlock(0xFFE);
+		CHECK(block.end == 0x1000);
+		CHECK_THROWS_AS(cache.getBlock(0x1000), std::out_of_range);
+	}
+}
+
+TEST_CASE("block cache drops blocks in switched banks", "[cpu], [block_cache], [bank_controller]") {
+	jagce::MemoryBus bus{};
+	jagce::WatchedMemory memory{bus};
+	jagce::BlockCache cache{memory};
+
+	// INC B; JR -3 at the start of ROM bank 1, INC C; JR -3 in bank 2
+	auto rom = std::make_unique<jagce::StaticRAM<4 * jagce::ROM_BANK_SIZE>>();
+	const std::array<uint8_t, 3> first{ 0x04, 0x18, 0xFD };
+	const std::array<uint8_t, 3> second{ 0x0C, 0x18, 0xFD };
+	rom->writeBytes(jagce::ROM_BANK_SIZE, first.data(), first.size());
+	rom->writeBytes(2 * jagce::ROM_BANK_SIZE, second.data(), second.size());
+
+	jagce::BankController mbc{bus, *rom, jagce::MBCType::MBC5, 2 * jagce::RAM_BANK_SIZE};
+	mbc.setObserver(&cache);
+
+	SECTION("ROM banks") {
+		CHECK(cache.getBlock(0x4000).instructions.at(0).opcode == 0x04);
+
+		memory.writeByte(0x2000, 0x02);
+		CHECK(!cache.contains(0x4000));
+		CHECK(cache.getBlock(0x4000).instructions.at(0).opcode == 0x0C);
+
+		// Writing the bank already mapped changes nothing
+		memory.writeByte(0x2000, 0x02);
+		CHECK(cache.contains(0x4000));
+	}
+
+	SECTION("RAM banks") {
+		memory.writeByte(0x0000, 0x0A);
+		mbc.getRAM().at(0) = 0x04;
+		mbc.getRAM().at(jagce::RAM_BANK_SIZE) = 0x0C;
+		CHECK(cache.getBlock(0xA000).instructions.at(0).opcode == 0x04);
+
+		memory.writeByte(0x4000, 0x01);
+		CHECK(cache.getBlock(0xA000).instructions.at(0).opcode == 0x0C);
+
+		// Disabled RAM reads 0xFF, which is RST 0x38
+		memory.writeByte(0x0000, 0x00);
+		CHECK(cache.getBlock(0xA000).instructions.at(0).opcode == 0xFF);
+	}
+}
+
+TEST_CASE("block cache finds fusable runs", "[cpu], [block_cache]") {
+	jagce::StaticRAM<0x1000> ram{};
+	jagce::WatchedMemory memory{ram};
+	jagce::BlockCache cache{memory};
+
+	// XOR A; LD (HL+),A x3; LD A,(HL+); LD (DE),A; INC DE x2; LD A,(HL+); LD (DE),A; LD (HL-),A; RET
+	const std::array<uint8_t, 15> code{ 0xAF, 0x22, 0x22, 0x22, 0x2A, 0x12, 0x13, 0x2A, 0x12, 0x13,
+		0x2A, 0x12, 0x32, 0xC9, 0x00 };
+	ram.writeBytes(0x100, code.data(), code.size());
+
+	const jagce::DecodedBlock& block = cache.getBlock(0x100);
+	REQUIRE(block.fused.size() == 2);
+
+	CHECK(block.fused.at(0).kind == jagce::FusedKind::FILL_INCREMENT);
+	CHECK(block.fused.at(0).first == 1);
+	CHECK(block.fused.at(0).count == 3);
+	CHECK(block.fused.at(0).bytes == 3);
+	CHECK(block.fused.at(0).cycles == 3 * 8);
+
+	// The last copy has no INC DE and ends the run, the single LD (HL-),A is not fused
+	CHECK(block.fused.at(1).kind == jagce::FusedKind::COPY);
+	CHECK(block.fused.at(1).first == 4);
+	CHECK(block.fused.at(1).count == 8);
+	CHECK(block.fused.at(1).bytes == 3);
+	CHECK(block.fused.at(1).cycles == 3 * 8 + 3 * 8 + 2 * 8);
+}
+
+TEST_CASE("block cache detects idle loops", "[cpu], [block_cache]") {
+	jagce::StaticRAM<0x1000> ram{};
+	jagce::WatchedMemory memory{ram};
+	jagce::BlockCache cache{memory};
+
+	auto detect = [&](const std::vector<uint8_t>& code) {
+		ram.writeBytes(0x100, code.data(), code.size());
+		cache.clear();
+		return cache.getBlock(0x100).idleLoop;
+	};
+
+	// LDH A,(0x44); CP 0x90; JR NZ,-6
+	const jagce::IdleLoop polling = detect({ 0xF0, 0x44, 0xFE, 0x90, 0x20, 0xFA });
+	CHECK(polling.detected);
+	CHECK(polling.flag == jagce::FLAG_Z);
+	CHECK(polling.taken(0x00));
+	CHECK_FALSE(polling.taken(jagce::FLAG_Z));
+	CHECK_FALSE(polling.readsTimer);
+
+	// LDH A,(0x04); CP 0x05; JR NZ,-6 polls DIV
+	const jagce::IdleLoop divider = detect({ 0xF0, 0x04, 0xFE, 0x05, 0x20, 0xFA });
+	CHECK(divider.detected);
+	CHECK(divider.readsTimer);
+
+	// LD C,0x0F; LD A,(0xFF00+C); AND 0x03; JP Z,0x0100 reads through C
+	const jagce::IdleLoop indirect = detect({ 0x0E, 0x0F, 0xF2, 0xE6, 0x03, 0xCA, 0x00, 0x01 });
+	CHECK(indirect.detected);
+	CHECK(indirect.readsTimer);
+	// JR -2
+	CHECK(detect({ 0x18, 0xFE }).detected);
+
+	// LDH A,(0x44); INC B; CP 0x90; JR NZ,-7 counts in B
+	CHECK_FALSE(detect({ 0xF0, 0x44, 0x04, 0xFE, 0x90, 0x20, 0xF9 }).detected);
+	// LD A,(HL+); CP 0x90; JR NZ,-5 moves HL
+	CHECK_FALSE(detect({ 0x2A, 0xFE, 0x90, 0x20, 0xFB }).detected);
+	// LDH A,(0x44); LD (HL),A; JR NZ,-5 writes memory
+	CHECK_FALSE(detect({ 0xF0, 0x44, 0x77, 0x20, 0xFB }).detected);
+	// LDH A,(0x44); ADD A,B; LD B,A; JR NZ,-6 accumulates in B
+	CHECK_FALSE(detect({ 0xF0, 0x44, 0x80, 0x47, 0x20, 0xFA }).detected);
+	// LDH A,(0x44); CP 0x90; JR NZ,-8 branches elsewhere
+	CHECK_FALSE(detect({ 0xF0, 0x44, 0xFE, 0x90, 0x20, 0xF8 }).detected);
+}
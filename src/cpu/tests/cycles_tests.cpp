@@ -0,0 +1,60 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <memory>
+
+#include "block_cache.hpp"
+#include "cycles.hpp"
+#include "executor.hpp"
+#include "static_ram.hpp"
+
+TEST_CASE("executor charges the table cycles of every opcode", "[cpu], [cycles]") {
+	auto ram = std::make_unique<jagce::StaticRAM<0x10000>>();
+	jagce::WatchedMemory memory{*ram};
+	jagce::BlockCache cache{memory};
+	jagce::Registers registers{};
+	jagce::Executor executor{registers, memory};
+
+	auto cyclesOf = [&](std::array<uint8_t, 3> bytes, uint8_t f) {
+		cache.clear();
+		ram->writeBytes(0x100, bytes.data(), bytes.size());
+		registers = jagce::Registers{};
+		registers.setF(f);
+		return executor.execute(cache.getBlock(0x100).instructions.front());
+	};
+
+	// Every instruction, control transfers included, costs what the tables say
+	for (unsigned opcode = 0; opcode < 0x100; opcode++) {
+		if (opcode == 0xCB || jagce::MAIN_CYCLES[opcode] == 0) {
+			continue;
+		}
+		INFO("opcode " << opcode);
+		for (uint8_t f : { uint8_t{0x00}, uint8_t{jagce::FLAG_Z | jagce::FLAG_C} }) {
+			const bool taken = jagce::isConditionalBranch(static_cast<uint16_t>(opcode)) && jagce::branchTaken(static_cast<uint16_t>(opcode), f);
+			CHECK(cyclesOf({ static_cast<uint8_t>(opcode), 0x34, 0x12 }, f) == jagce::opcodeCycles(static_cast<uint16_t>(opcode), taken));
+		}
+	}
+
+	for (unsigned opcode = 0; opcode < 0x100; opcode++) {
+		INFO("opcode 0xCB " << opcode);
+		CHECK(cyclesOf({ 0xCB, static_cast<uint8_t>(opcode), 0x00 }, 0) == jagce::opcodeCycles(static_cast<uint16_t>(0xCB00 | opcode)));
+	}
+}
+
+TEST_CASE("cycle tables have taken and not taken branches", "[cpu], [cycles]") {
+	CHECK(jagce::opcodeCycles(0x38) == 8);
+	CHECK(jagce::opcodeCycles(0x38, true) == 12);
+	CHECK(jagce::opcodeCycles(0xDC, true) == 24);
+	CHECK(jagce::opcodeCycles(0xC8, true) == 20);
+	// Unconditional transfers cost the same either way
+	CHECK(jagce::opcodeCycles(0xC3, true) == jagce::opcodeCycles(0xC3));
+	CHECK(jagce::opcodeCycles(0xCB16) == 16);
+	CHECK(jagce::opcodeCycles(0xCB7E) == 12);
+	CHECK(jagce::opcodeCycles(0xCB11) == 8);
+
+	// JR NZ, JR Z, JP NC and RET C
+	CHECK(jagce::branchTaken(0x20, 0x00));
+	CHECK_FALSE(jagce::branchTaken(0x28, 0x00));
+	CHECK(jagce::branchTaken(0xD2, jagce::FLAG_Z));
+	CHECK(jagce::branchTaken(0xD8, jagce::FLAG_C));
+}
@@ -0,0 +1,436 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "executor.hpp"
+#include "memory_bus.hpp"
+#include "static_ram.hpp"
+
+namespace {
+
+	constexpr int A = jagce::RegisterNames::A.getId();
+	constexpr int B = jagce::RegisterNames::B.getId();
+	constexpr int AF = jagce::RegisterNames::AF.getId();
+	constexpr int BC = jagce::RegisterNames::BC.getId();
+	constexpr int DE = jagce::RegisterNames::DE.getId();
+	constexpr int HL = jagce::RegisterNames::HL.getId();
+
+	// Decodes and executes every instruction in code, returning the cycles taken
+	template <typename E>
+	uint64_t executeAll(E& executor, const std::vector<uint8_t>& code) {
+		jagce::Decoder decoder{};
+		jagce::ByteCursor in{code.data(), code.size()};
+		uint64_t cycles = 0;
+		while (!in.empty()) {
+			const size_t offset = in.position();
+			const uint16_t opcode = code[offset] == 0xCB ? static_cast<uint16_t>(0xCB00 | code[offset + 1]) : code[offset];
+			const jagce::Event event = decoder.decodeEvent(in);
+			cycles += executor.execute(jagce::DecodedInstruction{event, jagce::toMicroOp(event), static_cast<uint16_t>(offset),
+				opcode, static_cast<uint8_t>(in.position() - offset)});
+		}
+		return cycles;
+	}
+
+}
+
+TEST_CASE("executor applies 8-bit arithmetic and flags", "[cpu], [executor]") {
+	jagce::StaticRAM<0x10000> memory{};
+	jagce::Registers registers{};
+	jagce::Executor executor{registers, memory};
+
+	SECTION("add sets zero, half carry and carry") {
+		// LD A,0x3A; ADD A,0xC6
+		CHECK(executeAll(executor, { 0x3E, 0x3A, 0xC6, 0xC6 }) == 16);
+		CHECK(registers.get8(A) == 0x00);
+		CHECK(registers.f() == (jagce::FLAG_Z | jagce::FLAG_H | jagce::FLAG_C));
+	}
+
+	SECTION("add with carry uses the carry flag") {
+		// LD A,0xE1; LD B,0x0F; SCF is not decoded so set C directly
+		executeAll(executor, { 0x3E, 0xE1, 0x06, 0x0F });
+		registers.setF(jagce::FLAG_C);
+		// ADC A,B
+		executeAll(executor, { 0x88 });
+		CHECK(registers.get8(A) == 0xF1);
+		CHECK(registers.f() == jagce::FLAG_H);
+	}
+
+	SECTION("compare leaves A and sets the subtract flag") {
+		// LD A,0x3C; CP 0x40
+		executeAll(executor, { 0x3E, 0x3C, 0xFE, 0x40 });
+		CHECK(registers.get8(A) == 0x3C);
+		CHECK(registers.f() == (jagce::FLAG_N | jagce::FLAG_C));
+	}
+
+	SECTION("and sets half carry") {
+		// LD A,0x5A; AND 0x3F
+		executeAll(executor, { 0x3E, 0x5A, 0xE6, 0x3F });
+		CHECK(registers.get8(A) == 0x1A);
+		CHECK(registers.f() == jagce::FLAG_H);
+	}
+
+	SECTION("increment leaves carry unchanged") {
+		registers.setF(jagce::FLAG_C);
+		// LD B,0xFF; INC B
+		CHECK(executeAll(executor, { 0x06, 0xFF, 0x04 }) == 12);
+		CHECK(registers.get8(B) == 0x00);
+		CHECK(registers.f() == (jagce::FLAG_Z | jagce::FLAG_H | jagce::FLAG_C));
+	}
+
+	SECTION("shifts rotate through carry") {
+		// LD B,0x85; RL B
+		executeAll(executor, { 0x06, 0x85, 0xCB, 0x10 });
+		CHECK(registers.get8(B) == 0x0A);
+		CHECK(registers.f() == jagce::FLAG_C);
+	}
+}
+
+TEMPLATE_TEST_CASE("executor accesses memory and the stack", "[cpu], [executor]",
+		jagce::RandomAccessMemory, jagce::StaticRAM<0x10000>) {
+	jagce::StaticRAM<0x10000> memory{};
+	jagce::Registers registers{};
+	jagce::BasicExecutor<TestType> executor{registers, memory};
+
+	SECTION("post-increment stores advance HL") {
+		// LD HL,0xC000; LD A,0x42; LD (HL+),A; INC (HL)
+		CHECK(executeAll(executor, { 0x21, 0x00, 0xC0, 0x3E, 0x42, 0x22, 0x34 }) == 12 + 8 + 8 + 12);
+		CHECK(memory.readByte(0xC000) == 0x42);
+		CHECK(memory.readByte(0xC001) == 0x01);
+		CHECK(registers.get16(HL) == 0xC001);
+	}
+
+	SECTION("high page loads use C") {
+		// LD C,0x80; LD A,0x99; LD (0xFF00+C),A
+		executeAll(executor, { 0x0E, 0x80, 0x3E, 0x99, 0xE2 });
+		CHECK(memory.readByte(0xFF80) == 0x99);
+	}
+
+	SECTION("stores of SP are little-endian") {
+		// LD SP,0xBEEF; LD (0xC100),SP
+		CHECK(executeAll(executor, { 0x31, 0xEF, 0xBE, 0x08, 0x00, 0xC1 }) == 12 + 20);
+		CHECK(memory.readByte(0xC100) == 0xEF);
+		CHECK(memory.readByte(0xC101) == 0xBE);
+	}
+
+	SECTION("pop AF clears the low nibble of F") {
+		// LD SP,0xD000; LD BC,0x12FF; PUSH BC; POP AF
+		CHECK(executeAll(executor, { 0x31, 0x00, 0xD0, 0x01, 0xFF, 0x12, 0xC5, 0xF1 }) == 12 + 12 + 16 + 12);
+		CHECK(registers.get16(AF) == 0x12F0);
+		CHECK(registers.sp == 0xD000);
+		CHECK(memory.readByte(0xCFFE) == 0xFF);
+	}
+
+	SECTION("SP relative loads take flags from the low byte") {
+		// LD SP,0x00FF; LD HL,SP+1
+		executeAll(executor, { 0x31, 0xFF, 0x00, 0xF8, 0x01 });
+		CHECK(registers.get16(HL) == 0x0100);
+		CHECK(registers.f() == (jagce::FLAG_H | jagce::FLAG_C));
+
+		// ADD SP,-2
+		CHECK(executeAll(executor, { 0xE8, 0xFE }) == 16);
+		CHECK(registers.sp == 0x00FD);
+	}
+
+	SECTION("add HL leaves zero unchanged") {
+		registers.setF(jagce::FLAG_Z);
+		// LD HL,0x8FFF; LD BC,0x7001; ADD HL,BC
+		executeAll(executor, { 0x21, 0xFF, 0x8F, 0x01, 0x01, 0x70, 0x09 });
+		CHECK(registers.get16(HL) == 0x0000);
+		CHECK(registers.get16(BC) == 0x7001);
+		CHECK(registers.f() == (jagce::FLAG_Z | jagce::FLAG_H | jagce::FLAG_C));
+	}
+}
+
+TEST_CASE("executor evaluates deferred flags when F is read", "[cpu], [executor]") {
+	jagce::StaticRAM<0x10000> memory{};
+	jagce::Registers registers{};
+	jagce::Executor executor{registers, memory};
+
+	SECTION("flags left unchanged come from the earlier operation") {
+		// LD A,0xF0; ADD A,0x20; LD B,0x0F; INC B
+		executeAll(executor, { 0x3E, 0xF0, 0xC6, 0x20, 0x06, 0x0F, 0x04 });
+		CHECK(registers.f() == (jagce::FLAG_H | jagce::FLAG_C));
+
+		// DEC B
+		executeAll(executor, { 0x05 });
+		CHECK(registers.get8(B) == 0x0F);
+		CHECK(registers.f() == (jagce::FLAG_N | jagce::FLAG_H | jagce::FLAG_C));
+	}
+
+	SECTION("push AF stores the computed flags") {
+		// LD SP,0xD000; LD A,0x01; SUB 0x01; PUSH AF
+		executeAll(executor, { 0x31, 0x00, 0xD0, 0x3E, 0x01, 0xD6, 0x01, 0xF5 });
+		CHECK(memory.readByte(0xCFFE) == (jagce::FLAG_Z | jagce::FLAG_N));
+		CHECK(memory.readByte(0xCFFF) == 0x00);
+	}
+
+	SECTION("subtract with carry reads the deferred carry") {
+		// LD A,0x10; SUB 0x20; SBC A,0x00
+		executeAll(executor, { 0x3E, 0x10, 0xD6, 0x20, 0xDE, 0x00 });
+		CHECK(registers.get8(A) == 0xEF);
+		CHECK(registers.f() == (jagce::FLAG_N | jagce::FLAG_H));
+	}
+
+	SECTION("setting F drops deferred flags") {
+		// LD A,0x00; OR A
+		executeAll(executor, { 0x3E, 0x00, 0xB7 });
+		CHECK(registers.f() == jagce::FLAG_Z);
+		registers.setF(jagce::FLAG_N);
+		CHECK(registers.f() == jagce::FLAG_N);
+	}
+}
+
+TEST_CASE("executor runs decoded blocks", "[cpu], [executor]") {
+	jagce::StaticRAM<0x10000> ram{};
+	jagce::WatchedMemory memory{ram};
+	jagce::BlockCache cache{memory};
+	jagce::Registers registers{};
+	jagce::Executor executor{registers, memory};
+
+	// LD A,0x12; ADD A,B; INC BC; JR -5
+	const std::vector<uint8_t> code{ 0x3E, 0x12, 0x80, 0x03, 0x18, 0xFB };
+	ram.writeBytes(0x100, code.data(), code.size());
+	registers.set8(B, 0x01);
+
+	// JR is not executed yet but costs its cycles
+	CHECK(executor.run(cache.getBlock(0x100)) == 8 + 4 + 8 + 12);
+	CHECK(registers.get8(A) == 0x13);
+	CHECK(registers.get16(BC) == 0x0101);
+	CHECK(registers.pc == 0x106);
+}
+
+TEST_CASE("executor runs blocks with every dispatch", "[cpu], [executor]") {
+	jagce::StaticRAM<0x10000> ram{};
+	jagce::WatchedMemory memory{ram};
+	jagce::BlockCache cache{memory};
+	jagce::Registers registers{};
+	jagce::Executor executor{registers, memory};
+
+	// LD HL,0xC000; LD A,0x0F; ADD A,0x01; LD (HL+),A; PUSH HL; JR -2
+	const std::vector<uint8_t> code{ 0x21, 0x00, 0xC0, 0x3E, 0x0F, 0xC6, 0x01, 0x22, 0xE5, 0x18, 0xFE };
+	ram.writeBytes(0x100, code.data(), code.size());
+	registers.sp = 0xD000;
+	// XOR A; JR Z,-3 is taken, XOR A; JR NZ,-3 isn't
+	const std::vector<uint8_t> taken{ 0xAF, 0x28, 0xFD };
+	const std::vector<uint8_t> notTaken{ 0xAF, 0x20, 0xFD };
+	ram.writeBytes(0x200, taken.data(), taken.size());
+	ram.writeBytes(0x210, notTaken.data(), notTaken.size());
+
+	std::vector<jagce::Dispatch> dispatches{ jagce::Dispatch::TABLE, jagce::Dispatch::TAIL_CALL };
+	if (jagce::computedGotoSupported) {
+		dispatches.push_back(jagce::Dispatch::COMPUTED_GOTO);
+	} else {
+		CHECK_THROWS_AS(executor.setDispatch(jagce::Dispatch::COMPUTED_GOTO), std::invalid_argument);
+	}
+
+	for (jagce::Dispatch dispatch : dispatches) {
+		executor.setDispatch(dispatch);
+		CHECK(executor.getDispatch() == dispatch);
+		registers.set16(HL, 0xC000);
+		registers.sp = 0xD000;
+		const jagce::DecodedBlock& block = cache.getBlock(0x100);
+
+		CHECK(executor.run(block) == 12 + 8 + 8 + 8 + 16 + 12);
+		CHECK(registers.get8(A) == 0x10);
+		CHECK(registers.f() == jagce::FLAG_H);
+		CHECK(registers.get16(HL) == 0xC001);
+		CHECK(registers.pc == 0x10B);
+		CHECK(memory.readByte(0xC000) == 0x10);
+		CHECK(memory.readByte(0xCFFE) == 0x01);
+		// Running again reuses the threaded code
+		CHECK(executor.run(block) == 12 + 8 + 8 + 8 + 16 + 12);
+
+		CHECK(executor.run(cache.getBlock(0x200)) == 4 + 12);
+		CHECK(executor.run(cache.getBlock(0x210)) == 4 + 8);
+	}
+}
+
+TEST_CASE("executor stops blocks writing their own code", "[cpu], [executor]") {
+	jagce::StaticRAM<0x10000> ram{};
+	jagce::WatchedMemory memory{ram};
+	jagce::BlockCache cache{memory};
+	jagce::Registers registers{};
+	jagce::Executor executor{registers, memory};
+
+	std::vector<jagce::Dispatch> dispatches{ jagce::Dispatch::TABLE, jagce::Dispatch::TAIL_CALL };
+	if (jagce::computedGotoSupported) {
+		dispatches.push_back(jagce::Dispatch::COMPUTED_GOTO);
+	}
+	const jagce::Dispatch dispatch = GENERATE_COPY(from_range(dispatches));
+	executor.setDispatch(dispatch);
+
+	SECTION("single writes") {
+		// LD HL,0x105; LD (HL),A; INC B; INC B; JR -2
+		const std::vector<uint8_t> code{ 0x21, 0x05, 0x01, 0x77, 0x04, 0x04, 0x18, 0xFE };
+		ram.writeBytes(0x100, code.data(), code.size());
+		registers.set8(A, 0x00);
+
+		const jagce::DecodedBlock& block = cache.getBlock(0x100);
+		CHECK(executor.run(block) == 12 + 8);
+		CHECK(block.invalidated);
+		CHECK(registers.pc == 0x104);
+		CHECK(registers.get8(B) == 0);
+		CHECK(ram.readByte(0x105) == 0x00);
+	}
+
+	SECTION("fused fills") {
+		// LD HL,0x106; LD (HL+),A; LD (HL+),A; INC B; INC B; JR -2
+		const std::vector<uint8_t> code{ 0x21, 0x06, 0x01, 0x22, 0x22, 0x04, 0x04, 0x18, 0xFE };
+		ram.writeBytes(0x100, code.data(), code.size());
+		registers.set8(A, 0x00);
+
+		const jagce::DecodedBlock& block = cache.getBlock(0x100);
+		const uint64_t cycles = executor.run(block);
+		CHECK(block.invalidated);
+		// Only table dispatch fuses, the others stop after the first write
+		if (dispatch == jagce::Dispatch::TABLE) {
+			CHECK(cycles == 12 + 8 + 8);
+			CHECK(registers.pc == 0x105);
+		} else {
+			CHECK(cycles == 12 + 8);
+			CHECK(registers.pc == 0x104);
+		}
+		CHECK(registers.get8(B) == 0);
+	}
+}
+
+TEMPLATE_TEST_CASE("executor runs fused copies and fills like the instructions they replace", "[cpu], [executor]",
+		jagce::RandomAccessMemory, jagce::MemoryBus) {
+	// Runs code with and without fusion from HL and DE, over memory holding a pattern
+	auto runBoth = [](const std::vector<uint8_t>& code, uint16_t hl, uint16_t de) {
+		auto codeRAM = std::make_unique<jagce::StaticRAM<0x10000>>();
+		codeRAM->writeBytes(0x100, code.data(), code.size());
+		jagce::WatchedMemory watched{*codeRAM};
+		jagce::BlockCache cache{watched};
+		const jagce::DecodedBlock& block = cache.getBlock(0x100);
+
+		std::array<std::vector<uint8_t>, 2> images{};
+		std::array<jagce::Registers, 2> registers{};
+		std::array<uint64_t, 2> cycles{};
+
+		for (size_t i = 0; i < 2; i++) {
+			images[i].resize(0x10000);
+			for (size_t address = 0; address < images[i].size(); address++) {
+				images[i][address] = static_cast<uint8_t>(address * 7);
+			}
+			registers[i].set16(HL, hl);
+			registers[i].set16(DE, de);
+			registers[i].set8(A, 0x5A);
+
+			if constexpr (std::is_same_v<TestType, jagce::MemoryBus>) {
+				jagce::MemoryBus bus{};
+				bus.map(0, images[i].size(), images[i].data());
+				jagce::BasicExecutor<jagce::MemoryBus> executor{registers[i], bus};
+				executor.setFusion(i == 0);
+				cycles[i] = executor.run(block);
+			} else {
+				auto ram = std::make_unique<jagce::StaticRAM<0x10000>>();
+				ram->writeBytes(0, images[i].data(), images[i].size());
+				jagce::Executor executor{registers[i], *ram};
+				executor.setFusion(i == 0);
+				cycles[i] = executor.run(block);
+				std::copy(ram->readBytes(0, 0x10000), ram->readBytes(0, 0x10000) + 0x10000, images[i].begin());
+			}
+		}
+
+		CHECK(cycles[0] == cycles[1]);
+		CHECK(registers[0] == registers[1]);
+		CHECK(images[0] == images[1]);
+	};
+
+	// LD A,(HL+); LD (DE),A; INC DE, four times without the last INC DE; RET
+	const std::vector<uint8_t> copy{ 0x2A, 0x12, 0x13, 0x2A, 0x12, 0x13, 0x2A, 0x12, 0x13, 0x2A, 0x12, 0xC9 };
+	// LD (HL+),A x4; LD (HL-),A x3; RET
+	const std::vector<uint8_t> fill{ 0x22, 0x22, 0x22, 0x22, 0x32, 0x32, 0x32, 0xC9 };
+
+	SECTION("disjoint copies") {
+		runBoth(copy, 0xC000, 0x8000);
+	}
+
+	SECTION("overlapping copies") {
+		runBoth(copy, 0xC000, 0xC002);
+		runBoth(copy, 0xC002, 0xC000);
+	}
+
+	SECTION("copies wrapping the address space") {
+		runBoth(copy, 0xFFFE, 0xC000);
+		runBoth(copy, 0xC000, 0xFFFF);
+	}
+
+	SECTION("fills") {
+		runBoth(fill, 0xC000, 0);
+		runBoth(fill, 0xFFFE, 0);
+		runBoth(fill, 0x0001, 0);
+	}
+}
+
+TEST_CASE("executor skips idle loop iterations", "[cpu], [executor]") {
+	jagce::StaticRAM<0x10000> ram{};
+	jagce::WatchedMemory memory{ram};
+	jagce::BlockCache cache{memory};
+	jagce::Registers registers{};
+	jagce::Executor executor{registers, memory};
+
+	// LDH A,(0x44); CP 0x90; JR NZ,-6
+	const std::vector<uint8_t> code{ 0xF0, 0x44, 0xFE, 0x90, 0x20, 0xFA };
+	ram.writeBytes(0x100, code.data(), code.size());
+	const jagce::DecodedBlock& block = cache.getBlock(0x100);
+	// The taken branch costs 12 cycles and the one that falls through 8
+	constexpr uint64_t ITERATION = 12 + 8 + 12;
+
+	SECTION("polling skips whole iterations up to the event") {
+		ram.writeByte(0xFF44, 0x10);
+		CHECK(executor.runIdleLoop(block, 1000) == 1000 / ITERATION * ITERATION);
+		CHECK(registers.pc == 0x100);
+		CHECK(executor.runIdleLoop(block, 10) == ITERATION);
+	}
+
+	SECTION("loops that exit run once") {
+		ram.writeByte(0xFF44, 0x90);
+		CHECK(executor.runIdleLoop(block, 1000) == 12 + 8 + 8);
+		CHECK(registers.pc == 0x106);
+	}
+}
+
+TEST_CASE("executor executes events", "[cpu], [executor]") {
+	jagce::StaticRAM<0x10000> memory{};
+	jagce::Registers registers{};
+	jagce::Executor executor{registers, memory};
+
+	executor.execute(jagce::Event{jagce::LoadEvent8{ {jagce::RegisterNames::A}, {jagce::Immediate8{0x80}} }});
+	executor.execute(jagce::Event{jagce::OrEvent8{ {jagce::RegisterNames::A} }});
+	CHECK(registers.get8(A) == 0x80);
+	CHECK(registers.f() == 0x00);
+}
+
+TEST_CASE("executor resolves addresses through a memory bus", "[cpu], [executor]") {
+	struct IORegisters : public jagce::MemoryHandler {
+		std::array<uint8_t, 0x100> io{};
+		uint8_t read(uint16_t address) override { return io.at(address & 0xFF); }
+		void write(uint16_t address, uint8_t value) override { io.at(address & 0xFF) = value; }
+	};
+
+	jagce::MemoryBus bus{};
+	std::array<uint8_t, 0x2000> wram{};
+	IORegisters io{};
+	bus.map(0xC000, wram.size(), wram.data());
+	bus.mapHandler(0xFF00, 0x100, &io);
+
+	jagce::Registers registers{};
+	jagce::BasicExecutor<jagce::MemoryBus> executor{registers, bus};
+
+	// LD C,0x47; LD A,0xE4; LD (0xFF00+C),A; LD (0xC010),A
+	executeAll(executor, { 0x0E, 0x47, 0x3E, 0xE4, 0xE2, 0xEA, 0x10, 0xC0 });
+	CHECK(io.io.at(0x47) == 0xE4);
+	CHECK(wram.at(0x10) == 0xE4);
+}
+
+TEST_CASE("executor requires the whole address space", "[cpu], [executor]") {
+	jagce::StaticRAM<0x1000> memory{};
+	jagce::Registers registers{};
+	CHECK_THROWS_AS(jagce::Executor(registers, memory), std::invalid_argument);
+}
@@ -0,0 +1,126 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "block_cache.hpp"
+#include "executor.hpp"
+#include "histogram.hpp"
+#include "machine.hpp"
+#include "static_ram.hpp"
+
+TEST_CASE("histograms merge and dump counts", "[cpu], [histogram]") {
+	jagce::OpcodeHistogram first{};
+	jagce::OpcodeHistogram second{};
+	first.decodedOpcodes[jagce::OpcodeHistogram::indexOf(0x3E)] = 2;
+	first.executedOpcodes[jagce::OpcodeHistogram::indexOf(0x3E)] = 5;
+	second.executedOpcodes[jagce::OpcodeHistogram::indexOf(0xCB37)] = 1;
+	second.executedEvents[static_cast<size_t>(jagce::MicroOpKind::LOAD8)] = 3;
+
+	first.merge(second);
+
+	CHECK(jagce::OpcodeHistogram::indexOf(0xCB37) == 0x137);
+	CHECK(first.executedOpcodes[0x3E] == 5);
+	CHECK(first.executedOpcodes[0x137] == 1);
+
+	SECTION("CSV has a row for each counted opcode and event") {
+		std::ostringstream out{};
+		first.writeCsv(out);
+		CHECK(out.str() ==
+			"kind,name,decoded,executed\n"
+			"opcode,0x3E,2,5\n"
+			"opcode,0xCB37,0,1\n"
+			"event,LoadEvent8,0,3\n");
+	}
+
+	SECTION("JSON has the same rows") {
+		std::ostringstream out{};
+		first.writeJson(out);
+		CHECK(out.str() ==
+			"{\"opcodes\":[{\"opcode\":\"0x3E\",\"decoded\":2,\"executed\":5},"
+			"{\"opcode\":\"0xCB37\",\"decoded\":0,\"executed\":1}],"
+			"\"events\":[{\"event\":\"LoadEvent8\",\"decoded\":0,\"executed\":3}]}\n");
+	}
+}
+
+TEST_CASE("thread histograms are collected across threads", "[cpu], [histogram]") {
+	jagce::resetHistogram();
+
+	jagce::threadHistogram().executed(0x00, jagce::MicroOpKind::NOP);
+	std::thread other{[]() {
+		jagce::threadHistogram().executed(0x00, jagce::MicroOpKind::NOP);
+		jagce::threadHistogram().decoded(0xCB00, jagce::MicroOpKind::REGISTER_SHIFT);
+	}};
+	other.join();
+
+	jagce::OpcodeHistogram total = jagce::collectHistogram();
+	CHECK(total.executedOpcodes[0x00] == 2);
+	CHECK(total.executedEvents[static_cast<size_t>(jagce::MicroOpKind::NOP)] == 2);
+	CHECK(total.decodedOpcodes[0x100] == 1);
+
+	jagce::resetHistogram();
+	total = jagce::collectHistogram();
+	CHECK(total.executedOpcodes[0x00] == 0);
+	CHECK(total.decodedOpcodes[0x100] == 0);
+}
+
+TEST_CASE("decoding and running blocks counts their instructions when enabled", "[cpu], [histogram]") {
+	jagce::StaticRAM<0x10000> ram{};
+	jagce::WatchedMemory memory{ram};
+	jagce::BlockCache cache{memory};
+	jagce::Registers registers{};
+	jagce::BasicExecutor<jagce::WatchedMemory> executor{registers, memory};
+
+	// LD A,0x12; SWAP A; INC A; HALT
+	const std::array<uint8_t, 6> code{ 0x3E, 0x12, 0xCB, 0x37, 0x3C, 0x76 };
+	ram.writeBytes(0x100, code.data(), code.size());
+
+	jagce::resetHistogram();
+	const jagce::DecodedBlock& block = cache.getBlock(0x100);
+	executor.run(block);
+	executor.run(block);
+	const jagce::OpcodeHistogram total = jagce::collectHistogram();
+
+	const uint64_t expected = jagce::histogramEnabled ? 1 : 0;
+	CHECK(total.decodedOpcodes[0x3E] == expected);
+	CHECK(total.decodedOpcodes[0x137] == expected);
+	CHECK(total.executedOpcodes[0x3C] == 2 * expected);
+	CHECK(total.executedEvents[static_cast<size_t>(jagce::MicroOpKind::INCREMENT8)] == 2 * expected);
+}
+
+TEST_CASE("histograms count the instructions a machine actually ran", "[cpu], [histogram]") {
+	jagce::Machine machine{};
+	const uint64_t expected = jagce::histogramEnabled ? 1 : 0;
+
+	SECTION("blocks stopped by writes to their own code") {
+		// LD HL,0x106; LD (HL),0x76; INC B; INC B; HALT, where the write turns the second INC B into HALT
+		const std::vector<uint8_t> code{ 0x21, 0x06, 0x01, 0x36, 0x76, 0x04, 0x04, 0x76 };
+		machine.getMemory().writeBytes(0x100, code.data(), code.size());
+		machine.getRegisters().pc = 0x100;
+
+		jagce::resetHistogram();
+		machine.run(100);
+		const jagce::OpcodeHistogram total = jagce::collectHistogram();
+		REQUIRE(machine.getRegisters().get8(jagce::RegisterNames::B.getId()) == 1);
+		CHECK(total.executedOpcodes[0x04] == expected);
+		CHECK(total.executedOpcodes[0x36] == expected);
+	}
+
+	SECTION("skipped iterations of idle loops") {
+		// LDH A,(0x04); CP 0x05; JR NZ,-6; HALT, where DIV counts every 256 cycles
+		const std::vector<uint8_t> code{ 0xF0, 0x04, 0xFE, 0x05, 0x20, 0xFA, 0x76 };
+		machine.getMemory().writeBytes(0x100, code.data(), code.size());
+		machine.getRegisters().pc = 0x100;
+
+		jagce::resetHistogram();
+		machine.run(0x800);
+		const jagce::OpcodeHistogram total = jagce::collectHistogram();
+		REQUIRE(machine.isHalted());
+		// Iterations of 12 + 8 + 12 cycles until DIV reads 5
+		CHECK(total.executedOpcodes[0xF0] == expected * (5 * 256 / 32 + 1));
+		CHECK(total.executedOpcodes[0x20] == total.executedOpcodes[0xF0]);
+		CHECK(total.executedOpcodes[0x76] == expected);
+	}
+}
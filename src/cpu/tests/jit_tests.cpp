@@ -0,0 +1,153 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "jit.hpp"
+#include "static_ram.hpp"
+
+namespace {
+
+	constexpr int A = jagce::RegisterNames::A.getId();
+	constexpr int B = jagce::RegisterNames::B.getId();
+	constexpr int BC = jagce::RegisterNames::BC.getId();
+	constexpr int HL = jagce::RegisterNames::HL.getId();
+
+	// Register and immediate forms the JIT compiles, and a few memory forms it interprets.
+	// None write through HL or SP, which could point anywhere, so no block rewrites itself.
+	const std::vector<std::vector<uint8_t>> INSTRUCTIONS{
+		{ 0x3E, 0x00 }, { 0x06, 0xFF }, { 0x0E, 0x0F }, { 0x16, 0x80 }, { 0x1E, 0x01 }, { 0x26, 0xC0 }, { 0x2E, 0x10 },
+		{ 0x78 }, { 0x41 }, { 0x4A }, { 0x53 }, { 0x5C }, { 0x65 }, { 0x6F },
+		{ 0x80 }, { 0x89 }, { 0x92 }, { 0x9B }, { 0xA4 }, { 0xAD }, { 0xB6 }, { 0xBF },
+		{ 0xC6, 0x8F }, { 0xCE, 0x7F }, { 0xD6, 0x11 }, { 0xDE, 0xF0 }, { 0xE6, 0x3C }, { 0xEE, 0xFF }, { 0xF6, 0x01 }, { 0xFE, 0x40 },
+		{ 0x04 }, { 0x05 }, { 0x0C }, { 0x1D }, { 0x24 }, { 0x2D }, { 0x3C }, { 0x3D },
+		{ 0x03 }, { 0x0B }, { 0x13 }, { 0x1B }, { 0x23 }, { 0x2B }, { 0x33 }, { 0x3B },
+		{ 0x01, 0xFF, 0x0F }, { 0x11, 0x01, 0x80 }, { 0x21, 0xFE, 0xC0 }, { 0x31, 0x00, 0xD0 },
+		{ 0x09 }, { 0x19 }, { 0x29 }, { 0x39 }, { 0x00 },
+		{ 0x7E }, { 0xEA, 0x00, 0xC0 }, { 0xC5 }, { 0xD1 }, { 0xCB, 0x10 }
+	};
+
+	std::vector<uint8_t> randomCode(std::mt19937& rng, size_t count) {
+		std::uniform_int_distribution<size_t> pick{0, INSTRUCTIONS.size() - 1};
+		std::vector<uint8_t> code{};
+		for (size_t i = 0; i < count; i++) {
+			const std::vector<uint8_t>& instruction = INSTRUCTIONS[pick(rng)];
+			code.insert(code.end(), instruction.begin(), instruction.end());
+		}
+		// JR -2 ends the block
+		code.push_back(0x18);
+		code.push_back(0xFE);
+		return code;
+	}
+
+}
+
+TEST_CASE("JIT matches the interpreter", "[cpu], [jit]") {
+	std::mt19937 rng{0x717};
+
+	for (size_t trial = 0; trial < 200; trial++) {
+		const std::vector<uint8_t> code = randomCode(rng, 24);
+
+		jagce::StaticRAM<0x10000> interpretedRAM{};
+		jagce::WatchedMemory interpretedMemory{interpretedRAM};
+		jagce::BlockCache interpretedCache{interpretedMemory};
+		jagce::Registers interpretedRegisters{};
+		jagce::Executor executor{interpretedRegisters, interpretedMemory};
+
+		jagce::StaticRAM<0x10000> compiledRAM{};
+		jagce::WatchedMemory compiledMemory{compiledRAM};
+		jagce::BlockCache compiledCache{compiledMemory};
+		jagce::Registers compiledRegisters{};
+		jagce::Jit jit{compiledRegisters, compiledMemory, compiledCache, 0};
+
+		interpretedRAM.writeBytes(0x100, code.data(), code.size());
+		compiledRAM.writeBytes(0x100, code.data(), code.size());
+		for (jagce::Registers* registers : { &interpretedRegisters, &compiledRegisters }) {
+			registers->set16(HL, 0xC000);
+			registers->sp = 0xD000;
+			registers->setF(jagce::FLAG_C);
+		}
+
+		for (size_t run = 0; run < 3; run++) {
+			const uint64_t interpretedCycles = executor.run(interpretedCache.getBlock(0x100));
+			const uint64_t compiledCycles = jit.run(0x100);
+			CHECK(compiledCycles == interpretedCycles);
+			REQUIRE(compiledRegisters == interpretedRegisters);
+		}
+		REQUIRE(std::equal(compiledRAM.readBytes(0, 0x10000), compiledRAM.readBytes(0, 0x10000) + 0x10000,
+				interpretedRAM.readBytes(0, 0x10000)));
+	}
+}
+
+TEST_CASE("JIT compiles hot blocks", "[cpu], [jit]") {
+	jagce::StaticRAM<0x10000> ram{};
+	jagce::WatchedMemory memory{ram};
+	jagce::BlockCache cache{memory};
+	jagce::Registers registers{};
+	jagce::Jit jit{registers, memory, cache, 2};
+
+	// LD A,0x01; ADD A,A; LD (HL),A; INC BC; JR -2
+	const std::vector<uint8_t> code{ 0x3E, 0x01, 0x87, 0x77, 0x03, 0x18, 0xFE };
+	ram.writeBytes(0x100, code.data(), code.size());
+	registers.set16(HL, 0xC000);
+
+	SECTION("blocks are interpreted until hot") {
+		for (size_t i = 0; i < 4; i++) {
+			CHECK(jit.run(0x100) == 8 + 4 + 8 + 8 + 12);
+		}
+		CHECK(registers.get8(A) == 0x02);
+		CHECK(registers.get16(BC) == 4);
+		CHECK(registers.pc == 0x107);
+		CHECK(ram.readByte(0xC000) == 0x02);
+
+		if (jagce::jitSupported) {
+			CHECK(jit.getStats().compiledBlocks == 1);
+			// LD (HL),A is interpreted, the rest is native
+			CHECK(jit.getStats().nativeInstructions == 2 * 4);
+			CHECK(jit.getStats().interpretedInstructions == 2 * 5 + 2);
+		}
+	}
+
+	SECTION("writes to a block drop its code") {
+		for (size_t i = 0; i < 3; i++) {
+			jit.run(0x100);
+		}
+		// LD A,0x05
+		memory.writeByte(0x101, 0x05);
+		CHECK_FALSE(cache.contains(0x100));
+		for (size_t i = 0; i < 4; i++) {
+			jit.run(0x100);
+		}
+		CHECK(registers.get8(A) == 0x0A);
+		if (jagce::jitSupported) {
+			CHECK(jit.getStats().compiledBlocks == 2);
+		}
+	}
+
+	SECTION("blocks writing their own code stop after the write") {
+		for (size_t i = 0; i < 3; i++) {
+			jit.run(0x100);
+		}
+		// LD (HL),A overwrites INC BC
+		registers.set16(HL, 0x104);
+		CHECK(jit.run(0x100) == 8 + 4 + 8);
+		CHECK(ram.readByte(0x104) == 0x02);
+		CHECK(registers.pc == 0x104);
+		CHECK(registers.get16(BC) == 3);
+		CHECK_FALSE(cache.contains(0x100));
+	}
+
+	SECTION("flushing recompiles") {
+		for (size_t i = 0; i < 3; i++) {
+			jit.run(0x100);
+		}
+		jit.flush();
+		jit.run(0x100);
+		CHECK(registers.get16(BC) == 4);
+		if (jagce::jitSupported) {
+			CHECK(jit.getStats().compiledBlocks == 2);
+			CHECK(jit.getStats().flushes == 1);
+		}
+	}
+}
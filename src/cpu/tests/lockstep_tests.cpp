@@ -0,0 +1,138 @@
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "lockstep.hpp"
+#include "static_ram.hpp"
+
+namespace {
+
+	constexpr size_t LANES = 16;
+
+	// Register forms run as vectors, and memory and 16-bit forms run lane by lane. None
+	// write through HL or SP, which could point at the code.
+	const std::vector<std::vector<uint8_t>> INSTRUCTIONS{
+		{ 0x3E, 0x00 }, { 0x06, 0xFF }, { 0x0E, 0x0F }, { 0x16, 0x80 }, { 0x26, 0xC0 },
+		{ 0x78 }, { 0x41 }, { 0x4A }, { 0x53 }, { 0x5C }, { 0x65 }, { 0x6F },
+		{ 0x80 }, { 0x89 }, { 0x92 }, { 0x9B }, { 0xA4 }, { 0xAD }, { 0xB6 }, { 0xBF }, { 0x87 }, { 0x97 },
+		{ 0xC6, 0x8F }, { 0xCE, 0x7F }, { 0xD6, 0x11 }, { 0xDE, 0xF0 }, { 0xE6, 0x3C }, { 0xEE, 0xFF }, { 0xF6, 0x01 }, { 0xFE, 0x40 },
+		{ 0x04 }, { 0x05 }, { 0x0C }, { 0x1D }, { 0x24 }, { 0x2D }, { 0x3C }, { 0x3D },
+		{ 0x03 }, { 0x13 }, { 0x29 }, { 0x7E }, { 0xEA, 0x00, 0xC0 }, { 0xC5 }, { 0xD1 }, { 0xCB, 0x10 }
+	};
+
+	std::vector<uint8_t> randomCode(std::mt19937& rng, size_t count) {
+		std::uniform_int_distribution<size_t> pick{0, INSTRUCTIONS.size() - 1};
+		std::vector<uint8_t> code{};
+		for (size_t i = 0; i < count; i++) {
+			const std::vector<uint8_t>& instruction = INSTRUCTIONS[pick(rng)];
+			code.insert(code.end(), instruction.begin(), instruction.end());
+		}
+		// JR -2 ends the block
+		code.push_back(0x18);
+		code.push_back(0xFE);
+		return code;
+	}
+
+	jagce::Registers randomRegisters(std::mt19937& rng) {
+		std::uniform_int_distribution<int> byte{0, 0xFF};
+		jagce::Registers registers{};
+		for (size_t i = 0; i < jagce::REGISTER_F; i++) {
+			registers.r8[i] = static_cast<uint8_t>(byte(rng));
+		}
+		registers.setF(static_cast<uint8_t>(byte(rng)));
+		registers.sp = 0xD000;
+		registers.pc = 0x100;
+		return registers;
+	}
+
+}
+
+TEST_CASE("lockstep lanes match the scalar executor", "[cpu], [lockstep]") {
+	std::mt19937 rng{0x5157};
+
+	for (size_t trial = 0; trial < 50; trial++) {
+		const std::vector<uint8_t> code = randomCode(rng, 24);
+
+		std::vector<std::unique_ptr<jagce::StaticRAM<0x10000>>> rams{};
+		std::vector<jagce::RandomAccessMemory*> memories{};
+		for (size_t lane = 0; lane < LANES; lane++) {
+			rams.push_back(std::make_unique<jagce::StaticRAM<0x10000>>());
+			rams.back()->writeBytes(0x100, code.data(), code.size());
+			rams.back()->writeByte(0xC000 + lane, static_cast<uint8_t>(lane * 3));
+			memories.push_back(rams.back().get());
+		}
+		jagce::WatchedMemory shared{*rams[0]};
+		jagce::BlockCache cache{shared};
+		const jagce::DecodedBlock& block = cache.getBlock(0x100);
+
+		jagce::LockstepExecutor<LANES> lockstep{memories};
+		std::vector<jagce::Registers> expected{};
+		for (size_t lane = 0; lane < LANES; lane++) {
+			expected.push_back(randomRegisters(rng));
+			lockstep.getRegisters().set(lane, expected.back());
+		}
+		// Lanes 3 and 9 have gone elsewhere
+		lockstep.getRegisters().pc[3] = 0x200;
+		lockstep.getRegisters().pc[9] = 0x200;
+		const jagce::LaneMask active = lockstep.lanesAt(0x100);
+		CHECK(active == (jagce::LockstepExecutor<LANES>::ALL_LANES & ~((1u << 3) | (1u << 9))));
+
+		const uint64_t cycles = lockstep.run(block, active);
+
+		for (size_t lane = 0; lane < LANES; lane++) {
+			INFO("trial " << trial << " lane " << lane);
+			if (lane == 3 || lane == 9) {
+				expected[lane].pc = 0x200;
+				CHECK(lockstep.getRegisters().get(lane) == expected[lane]);
+				continue;
+			}
+			jagce::StaticRAM<0x10000> ram{};
+			ram.writeBytes(0x100, code.data(), code.size());
+			ram.writeByte(0xC000 + lane, static_cast<uint8_t>(lane * 3));
+			jagce::WatchedMemory memory{ram};
+			jagce::BlockCache scalarCache{memory};
+			jagce::Executor executor{expected[lane], memory};
+			CHECK(executor.run(scalarCache.getBlock(0x100)) == cycles);
+
+			CHECK(lockstep.getRegisters().get(lane) == expected[lane]);
+			CHECK(rams[lane]->readByte(0xC000) == ram.readByte(0xC000));
+			CHECK(rams[lane]->readByte(0xCFFE) == ram.readByte(0xCFFE));
+		}
+	}
+}
+
+TEST_CASE("lockstep lanes that diverge run together again", "[cpu], [lockstep]") {
+	std::vector<std::unique_ptr<jagce::StaticRAM<0x10000>>> rams{};
+	std::vector<jagce::RandomAccessMemory*> memories{};
+	// INC A; JR 0; INC B; JR 0
+	const std::vector<uint8_t> code{ 0x3C, 0x18, 0x00, 0x04, 0x18, 0x00 };
+	for (size_t lane = 0; lane < 8; lane++) {
+		rams.push_back(std::make_unique<jagce::StaticRAM<0x10000>>());
+		rams.back()->writeBytes(0x100, code.data(), code.size());
+		memories.push_back(rams.back().get());
+	}
+	jagce::WatchedMemory shared{*rams[0]};
+	jagce::BlockCache cache{shared};
+
+	jagce::LockstepExecutor<8> lockstep{memories};
+	for (size_t lane = 0; lane < 8; lane++) {
+		lockstep.getRegisters().pc[lane] = lane < 4 ? 0x100 : 0x103;
+	}
+
+	CHECK(lockstep.step(cache) == 0x0F);
+	CHECK(lockstep.lanesAt(0x103) == 0xFF);
+	CHECK(lockstep.step(cache) == 0xFF);
+	for (size_t lane = 0; lane < 8; lane++) {
+		const jagce::Registers registers = lockstep.getRegisters().get(lane);
+		CHECK(registers.get8(jagce::RegisterNames::A.getId()) == (lane < 4 ? 1 : 0));
+		CHECK(registers.get8(jagce::RegisterNames::B.getId()) == 1);
+		CHECK(registers.pc == 0x106);
+	}
+}
+
+TEST_CASE("lockstep executor needs a memory per lane", "[cpu], [lockstep]") {
+	jagce::StaticRAM<0x10000> ram{};
+	CHECK_THROWS_AS(jagce::LockstepExecutor<8>({ &ram }), std::invalid_argument);
+}
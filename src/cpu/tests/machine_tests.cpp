@@ -0,0 +1,92 @@
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include "machine.hpp"
+
+namespace {
+
+	void load(jagce::Machine& machine, const std::vector<uint8_t>& code) {
+		machine.getMemory().writeBytes(0x100, code.data(), code.size());
+		machine.getRegisters().pc = 0x100;
+	}
+
+}
+
+TEST_CASE("machine runs polling loops up to the LCD event they wait for", "[cpu], [machine]") {
+	jagce::Machine machine{};
+	machine.getMemory().writeByte(jagce::Lcd::LCDC, 0x91);
+	// LDH A,(0x44); CP 0x90; JR NZ,-6; HALT
+	load(machine, { 0xF0, 0x44, 0xFE, 0x90, 0x20, 0xFA, 0x76 });
+
+	const uint64_t cycles = machine.run(jagce::Lcd::LINE_CYCLES * 145);
+	CHECK(cycles >= jagce::Lcd::LINE_CYCLES * 145);
+	CHECK(machine.isHalted());
+	CHECK(machine.getRegisters().pc == 0x107);
+	CHECK(machine.getRegisters().get8(jagce::RegisterNames::A.getId()) == 0x90);
+	CHECK(machine.getLcd().getLine() == 145);
+	CHECK((machine.getInterrupts().flags & jagce::INTERRUPT_VBLANK) != 0);
+}
+
+TEST_CASE("machine runs polling loops up to the timer count they wait for", "[cpu], [machine]") {
+	jagce::Machine machine{};
+
+	SECTION("DIV") {
+		// LDH A,(0x04); CP 0x05; JR NZ,-6; HALT
+		load(machine, { 0xF0, 0x04, 0xFE, 0x05, 0x20, 0xFA, 0x76 });
+
+		machine.run(0x800);
+		CHECK(machine.isHalted());
+		CHECK(machine.getRegisters().get8(jagce::RegisterNames::A.getId()) == 0x05);
+	}
+
+	SECTION("TIMA") {
+		// TIMA counts every 64 cycles
+		machine.getMemory().writeByte(jagce::Timer::TAC, 0x06);
+		// LDH A,(0x05); CP 0x20; JR NZ,-6; HALT
+		load(machine, { 0xF0, 0x05, 0xFE, 0x20, 0x20, 0xFA, 0x76 });
+
+		machine.run(0x1000);
+		CHECK(machine.isHalted());
+		CHECK(machine.getRegisters().get8(jagce::RegisterNames::A.getId()) == 0x20);
+	}
+}
+
+TEST_CASE("machine runs code that modifies its own block", "[cpu], [machine]") {
+	jagce::Machine machine{};
+	// LD HL,0x106; LD (HL),0x76; INC B; INC B; HALT, where the write turns the second INC B into HALT
+	load(machine, { 0x21, 0x06, 0x01, 0x36, 0x76, 0x04, 0x04, 0x76 });
+
+	machine.run(1000);
+	CHECK(machine.isHalted());
+	CHECK(machine.getRegisters().get8(jagce::RegisterNames::B.getId()) == 1);
+	CHECK(machine.getRegisters().pc == 0x107);
+}
+
+TEST_CASE("machine skips to the next event while halted", "[cpu], [machine]") {
+	jagce::Machine machine{};
+
+	SECTION("the timer interrupt wakes the CPU") {
+		// LD A,0x05; LDH (0x07),A; LD A,0x04; LDH (0xFF),A; HALT; LD B,0x42; HALT
+		load(machine, { 0x3E, 0x05, 0xE0, 0x07, 0x3E, 0x04, 0xE0, 0xFF, 0x76, 0x06, 0x42, 0x76 });
+
+		// TIMA overflows after 256 increments of 16 cycles
+		CHECK(machine.run(4000) == 4000);
+		CHECK(machine.isHalted());
+		CHECK(machine.getRegisters().get8(jagce::RegisterNames::B.getId()) == 0x00);
+
+		machine.run(200);
+		CHECK(machine.getRegisters().get8(jagce::RegisterNames::B.getId()) == 0x42);
+		CHECK(machine.getInterrupts().flags == jagce::INTERRUPT_TIMER);
+	}
+
+	SECTION("interrupts that aren't enabled don't wake it") {
+		// LD A,0x91; LDH (0x40),A; HALT; LD B,0x42
+		load(machine, { 0x3E, 0x91, 0xE0, 0x40, 0x76, 0x06, 0x42 });
+
+		machine.run(jagce::Lcd::LINE_CYCLES * 154 * 2);
+		CHECK(machine.isHalted());
+		CHECK(machine.getInterrupts().flags == jagce::INTERRUPT_VBLANK);
+		CHECK(machine.getRegisters().get8(jagce::RegisterNames::B.getId()) == 0x00);
+	}
+}
@@ -0,0 +1,207 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "interrupts.hpp"
+#include "lcd.hpp"
+#include "machine.hpp"
+#include "ppu.hpp"
+#include "scheduler.hpp"
+#include "static_ram.hpp"
+
+namespace {
+
+	constexpr uint8_t LCDC_DEFAULT = 0x91; // on, 0x8000 tile data, background on
+	constexpr uint8_t IDENTITY_PALETTE = 0xE4;
+
+	// Tile rows given as the pixel index of each of 8 pixels, leftmost first
+	void writeTileRow(jagce::RandomAccessMemory& memory, uint16_t address, const std::array<uint8_t, 8>& pixels) {
+		uint8_t lo = 0;
+		uint8_t hi = 0;
+		for (size_t i = 0; i < 8; i++) {
+			lo |= static_cast<uint8_t>((pixels[i] & 1) << (7 - i));
+			hi |= static_cast<uint8_t>((pixels[i] >> 1) << (7 - i));
+		}
+		memory.writeByte(address, lo);
+		memory.writeByte(address + 1, hi);
+	}
+
+	// Every row of a tile the same
+	void writeTile(jagce::RandomAccessMemory& memory, uint16_t address, const std::array<uint8_t, 8>& pixels) {
+		for (uint16_t row = 0; row < 8; row++) {
+			writeTileRow(memory, address + row * 2, pixels);
+		}
+	}
+
+	struct Fixture {
+		std::unique_ptr<jagce::StaticRAM<0x10000>> memory = std::make_unique<jagce::StaticRAM<0x10000>>();
+		jagce::Scheduler scheduler{};
+		jagce::Interrupts interrupts{};
+		jagce::Lcd lcd{scheduler, interrupts};
+		jagce::Ppu ppu{*memory};
+
+		Fixture() {
+			lcd.write(jagce::Lcd::LCDC, LCDC_DEFAULT);
+			lcd.write(jagce::Lcd::BGP, IDENTITY_PALETTE);
+			lcd.write(jagce::Lcd::OBP0, IDENTITY_PALETTE);
+			lcd.write(jagce::Lcd::OBP1, IDENTITY_PALETTE);
+		}
+
+		std::vector<uint8_t> line(uint8_t y, size_t from, size_t num) {
+			ppu.renderLine(y, lcd);
+			const auto& frame = ppu.getFrame();
+			return {frame.begin() + y * jagce::Ppu::WIDTH + from, frame.begin() + y * jagce::Ppu::WIDTH + from + num};
+		}
+
+		void sprite(size_t index, uint8_t y, uint8_t x, uint8_t tile, uint8_t flags) {
+			const std::array<uint8_t, 4> attributes{ y, x, tile, flags };
+			memory->writeBytes(jagce::Ppu::OAM + index * 4, attributes.data(), attributes.size());
+		}
+	};
+
+}
+
+TEST_CASE("tile rows decode to pixel indices", "[cpu], [ppu]") {
+	CHECK(jagce::decodeTileRow(0x3C, 0x7E) == 0x0002030303030200);
+	CHECK(jagce::decodeTileRow(0x80, 0x01) == 0x0200000000000001);
+	CHECK(jagce::decodeTileRow(0x00, 0x00) == 0);
+	CHECK(jagce::decodeTileRow(0xFF, 0xFF) == 0x0303030303030303);
+}
+
+TEST_CASE("ppu renders the background", "[cpu], [ppu]") {
+	Fixture f{};
+	writeTile(*f.memory, 0x8010, { 0, 1, 2, 3, 3, 2, 1, 0 });
+	// Tile 1 at the top left of the map, tile 0 is blank
+	f.memory->writeByte(0x9800, 0x01);
+
+	SECTION("tiles come from the map") {
+		CHECK(f.line(0, 0, 10) == std::vector<uint8_t>{ 0, 1, 2, 3, 3, 2, 1, 0, 0, 0 });
+	}
+
+	SECTION("the palette maps indices to shades") {
+		f.lcd.write(jagce::Lcd::BGP, 0x1B);
+		CHECK(f.line(0, 0, 8) == std::vector<uint8_t>{ 3, 2, 1, 0, 0, 1, 2, 3 });
+	}
+
+	SECTION("scrolling moves the view") {
+		f.lcd.write(jagce::Lcd::SCX, 3);
+		CHECK(f.line(0, 0, 6) == std::vector<uint8_t>{ 3, 3, 2, 1, 0, 0 });
+
+		// Wrapping around to the last column of the map
+		f.lcd.write(jagce::Lcd::SCX, 0xFE);
+		CHECK(f.line(0, 0, 4) == std::vector<uint8_t>{ 0, 0, 0, 1 });
+
+		f.lcd.write(jagce::Lcd::SCX, 0);
+		f.lcd.write(jagce::Lcd::SCY, 4);
+		CHECK(f.line(3, 0, 4) == std::vector<uint8_t>{ 0, 1, 2, 3 });
+		CHECK(f.line(4, 0, 4) == std::vector<uint8_t>{ 0, 0, 0, 0 });
+	}
+
+	SECTION("signed tile data is addressed around 0x9000") {
+		f.lcd.write(jagce::Lcd::LCDC, LCDC_DEFAULT & ~0x10);
+		writeTile(*f.memory, 0x8800, { 3, 3, 3, 3, 3, 3, 3, 3 });
+		f.memory->writeByte(0x9800, 0x80);
+		CHECK(f.line(0, 0, 2) == std::vector<uint8_t>{ 3, 3 });
+	}
+
+	SECTION("the background can be turned off") {
+		f.lcd.write(jagce::Lcd::LCDC, LCDC_DEFAULT & ~0x01);
+		CHECK(f.line(0, 0, 8) == std::vector<uint8_t>(8, 0));
+
+		// White, not whatever the palette maps index 0 to
+		f.lcd.write(jagce::Lcd::BGP, 0x1B);
+		CHECK(f.line(0, 0, 8) == std::vector<uint8_t>(8, 0));
+	}
+
+	SECTION("the window covers the background from WX - 7") {
+		writeTile(*f.memory, 0x8020, { 2, 2, 2, 2, 2, 2, 2, 2 });
+		for (uint16_t i = 0; i < 32; i++) {
+			f.memory->writeByte(0x9C00 + i, 0x02);
+		}
+		f.lcd.write(jagce::Lcd::LCDC, LCDC_DEFAULT | 0x60);
+		f.lcd.write(jagce::Lcd::WY, 1);
+		f.lcd.write(jagce::Lcd::WX, 7 + 4);
+
+		CHECK(f.line(0, 0, 6) == std::vector<uint8_t>{ 0, 1, 2, 3, 3, 2 });
+		CHECK(f.line(1, 0, 6) == std::vector<uint8_t>{ 0, 1, 2, 3, 2, 2 });
+		CHECK(f.line(1, 150, 10) == std::vector<uint8_t>(10, 2));
+	}
+}
+
+TEST_CASE("ppu draws sprites with their priorities", "[cpu], [ppu]") {
+	Fixture f{};
+	f.lcd.write(jagce::Lcd::LCDC, LCDC_DEFAULT | 0x02);
+	writeTile(*f.memory, 0x8010, { 1, 1, 0, 0, 0, 0, 0, 0 });
+	writeTile(*f.memory, 0x8020, { 3, 0, 0, 0, 0, 0, 0, 2 });
+	f.memory->writeByte(0x9800, 0x01);
+
+	SECTION("sprites are placed at X - 8 and Y - 16") {
+		f.sprite(0, 16, 8 + 4, 2, 0x00);
+		CHECK(f.line(0, 0, 12) == std::vector<uint8_t>{ 1, 1, 0, 0, 3, 0, 0, 0, 0, 0, 0, 2 });
+		CHECK(f.line(8, 0, 12) == std::vector<uint8_t>(12, 0));
+	}
+
+	SECTION("flips and the second palette apply") {
+		f.sprite(0, 16, 8 + 4, 2, 0x20 | 0x10);
+		f.lcd.write(jagce::Lcd::OBP1, 0x1B);
+		CHECK(f.line(0, 4, 8) == std::vector<uint8_t>{ 1, 0, 0, 0, 0, 0, 0, 0 });
+	}
+
+	SECTION("sprites behind the background only show over index 0") {
+		f.sprite(0, 16, 8, 2, 0x80);
+		writeTile(*f.memory, 0x8010, { 1, 0, 0, 0, 0, 0, 0, 0 });
+		CHECK(f.line(0, 0, 8) == std::vector<uint8_t>{ 1, 0, 0, 0, 0, 0, 0, 2 });
+	}
+
+	SECTION("lower X wins, even when hidden behind the background") {
+		f.sprite(0, 16, 8 + 1, 2, 0x00);
+		f.sprite(1, 16, 8, 2, 0x80);
+		// Sprite 1 hides under the background at 0 but its transparent pixels let sprite 0 through
+		CHECK(f.line(0, 0, 9) == std::vector<uint8_t>{ 1, 3, 0, 0, 0, 0, 0, 2, 2 });
+	}
+
+	SECTION("sprites hanging off the screen edges are clipped") {
+		f.sprite(0, 16, 1, 2, 0x00);
+		f.sprite(1, 16, jagce::Ppu::WIDTH + 7, 2, 0x00);
+		CHECK(f.line(0, 0, 2) == std::vector<uint8_t>{ 2, 1 });
+		CHECK(f.line(0, jagce::Ppu::WIDTH - 8, 8) == std::vector<uint8_t>{ 0, 0, 0, 0, 0, 0, 0, 3 });
+	}
+
+	SECTION("only ten sprites show on a line") {
+		for (size_t i = 0; i < 11; i++) {
+			f.sprite(i, 16, static_cast<uint8_t>(8 + 8 * i), 2, 0x00);
+		}
+		CHECK(f.line(0, 72, 1) == std::vector<uint8_t>{ 3 });
+		CHECK(f.line(0, 80, 1) == std::vector<uint8_t>{ 0 });
+	}
+
+	SECTION("tall sprites use a pair of tiles") {
+		f.lcd.write(jagce::Lcd::LCDC, LCDC_DEFAULT | 0x02 | 0x04);
+		writeTile(*f.memory, 0x8030, { 0, 3, 0, 0, 0, 0, 0, 0 });
+		f.sprite(0, 16, 8 + 16, 3, 0x00);
+		CHECK(f.line(0, 16, 8) == std::vector<uint8_t>{ 3, 0, 0, 0, 0, 0, 0, 2 });
+		CHECK(f.line(8, 16, 8) == std::vector<uint8_t>{ 0, 3, 0, 0, 0, 0, 0, 0 });
+	}
+}
+
+TEST_CASE("machine renders frames as the LCD runs", "[cpu], [ppu], [machine]") {
+	jagce::Machine machine{};
+	jagce::RandomAccessMemory& memory = machine.getMemory();
+	writeTile(memory, 0x8010, { 3, 3, 3, 3, 3, 3, 3, 3 });
+	memory.writeByte(0x9800 + 32 * 2 + 1, 0x01);
+	memory.writeByte(jagce::Lcd::BGP, IDENTITY_PALETTE);
+	memory.writeByte(jagce::Lcd::LCDC, LCDC_DEFAULT);
+	// HALT
+	memory.writeByte(0x100, 0x76);
+	machine.getRegisters().pc = 0x100;
+
+	machine.run(jagce::Lcd::LINE_CYCLES * jagce::Lcd::LINES);
+
+	const jagce::Ppu& ppu = machine.getPpu();
+	CHECK(ppu.getFrameCount() == 1);
+	CHECK(ppu.getFrame()[16 * jagce::Ppu::WIDTH + 8] == 3);
+	CHECK(ppu.getFrame()[16 * jagce::Ppu::WIDTH + 16] == 0);
+	CHECK(ppu.getFrame()[15 * jagce::Ppu::WIDTH + 8] == 0);
+}
@@ -0,0 +1,204 @@
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "rewind.hpp"
+#include "static_ram.hpp"
+
+namespace {
+
+	constexpr size_t RAM_SIZE = 0x2000;
+
+	// Changes a few scattered bytes and a short run, like a frame of emulation
+	void runFrame(jagce::RandomAccessMemory& memory, jagce::Registers& registers, std::mt19937& rng) {
+		for (int i = 0; i < 8; i++) {
+			memory.writeByte(rng() % RAM_SIZE, static_cast<uint8_t>(rng()));
+		}
+		const size_t run = rng() % (RAM_SIZE - 64);
+		for (size_t i = 0; i < 64; i++) {
+			memory.writeByte(run + i, static_cast<uint8_t>(rng()));
+		}
+		registers.pc = static_cast<uint16_t>(rng());
+		registers.set8(jagce::RegisterNames::A.getId(), static_cast<uint8_t>(rng()));
+	}
+
+	std::vector<uint8_t> contents(const jagce::RandomAccessMemory& memory) {
+		uint8_t const * bytes = memory.readBytes(0, memory.size());
+		return {bytes, bytes + memory.size()};
+	}
+
+	struct Snapshot {
+		std::vector<uint8_t> memory;
+		uint16_t pc;
+		uint8_t a;
+	};
+
+}
+
+TEMPLATE_TEST_CASE("rewind buffer steps back through captures", "[cpu], [rewind]",
+		(jagce::StaticRAM<RAM_SIZE, 256>), (jagce::StaticRAM<RAM_SIZE>)) {
+	auto ram = std::make_unique<TestType>();
+	jagce::Registers registers{};
+	jagce::RewindBuffer rewind{registers, 64, 1 << 20, 8};
+	rewind.addMemory(*ram);
+	std::mt19937 rng{7};
+
+	std::vector<Snapshot> snapshots{};
+	for (int frame = 0; frame < 40; frame++) {
+		runFrame(*ram, registers, rng);
+		rewind.capture();
+		snapshots.push_back({contents(*ram), registers.pc, registers.get8(jagce::RegisterNames::A.getId())});
+	}
+	REQUIRE(rewind.size() == 40);
+
+	SECTION("captures are restored newest first") {
+		// Running on after each step must not confuse the next one
+		runFrame(*ram, registers, rng);
+		for (size_t i = snapshots.size(); i-- > 0;) {
+			REQUIRE(rewind.stepBack());
+			CHECK(contents(*ram) == snapshots[i].memory);
+			CHECK(registers.pc == snapshots[i].pc);
+			CHECK(registers.get8(jagce::RegisterNames::A.getId()) == snapshots[i].a);
+			if (i % 3 == 0) {
+				runFrame(*ram, registers, rng);
+			}
+		}
+		CHECK(!rewind.stepBack());
+		CHECK(rewind.bytesUsed() == 0);
+	}
+
+	SECTION("capturing after stepping back continues from there") {
+		for (int i = 0; i < 13; i++) {
+			rewind.stepBack();
+		}
+		runFrame(*ram, registers, rng);
+		rewind.capture();
+		const std::vector<uint8_t> captured = contents(*ram);
+		runFrame(*ram, registers, rng);
+
+		REQUIRE(rewind.stepBack());
+		CHECK(contents(*ram) == captured);
+		REQUIRE(rewind.stepBack());
+		CHECK(contents(*ram) == snapshots[26].memory);
+	}
+
+	SECTION("deltas hold only what changed") {
+		// Every 8th capture is a keyframe, holding every byte written so far
+		size_t used = rewind.bytesUsed();
+		rewind.capture();
+		const size_t keyframeSize = rewind.bytesUsed() - used;
+		CHECK(keyframeSize < RAM_SIZE / 2);
+
+		used = rewind.bytesUsed();
+		runFrame(*ram, registers, rng);
+		rewind.capture();
+		CHECK(rewind.bytesUsed() - used < 200);
+	}
+}
+
+TEST_CASE("rewind buffer drops the oldest captures when full", "[cpu], [rewind]") {
+	auto ram = std::make_unique<jagce::StaticRAM<RAM_SIZE, 256>>();
+	jagce::Registers registers{};
+	std::mt19937 rng{3};
+
+	SECTION("out of storage") {
+		jagce::RewindBuffer rewind{registers, 1000, 3 * RAM_SIZE, 4};
+		rewind.addMemory(*ram);
+		// Noise so keyframes are about the size of memory
+		for (size_t i = 0; i < RAM_SIZE; i++) {
+			ram->writeByte(i, static_cast<uint8_t>(rng() | 1));
+		}
+
+		std::vector<Snapshot> snapshots{};
+		for (int frame = 0; frame < 50; frame++) {
+			runFrame(*ram, registers, rng);
+			rewind.capture();
+			snapshots.push_back({contents(*ram), registers.pc, 0});
+			CHECK(rewind.bytesUsed() <= 3 * RAM_SIZE);
+		}
+		REQUIRE(rewind.size() > 0);
+		REQUIRE(rewind.size() < 50);
+
+		const size_t kept = rewind.size();
+		for (size_t i = 0; i < kept; i++) {
+			REQUIRE(rewind.stepBack());
+			CHECK(contents(*ram) == snapshots[snapshots.size() - 1 - i].memory);
+		}
+		CHECK(rewind.empty());
+	}
+
+	SECTION("out of captures") {
+		jagce::RewindBuffer rewind{registers, 10, 1 << 20, 4};
+		rewind.addMemory(*ram);
+		for (int frame = 0; frame < 30; frame++) {
+			runFrame(*ram, registers, rng);
+			rewind.capture();
+			CHECK(rewind.size() <= 10);
+		}
+		// Whole keyframe groups go at once
+		CHECK(rewind.size() >= 7);
+	}
+
+	SECTION("keyframes larger than the storage are rejected") {
+		jagce::RewindBuffer rewind{registers, 10, 64, 4};
+		rewind.addMemory(*ram);
+		for (size_t i = 0; i < RAM_SIZE; i++) {
+			ram->writeByte(i, 0xFF);
+		}
+		CHECK_THROWS_AS(rewind.capture(), std::length_error);
+	}
+
+	SECTION("a keyframe replacing a dropped one takes the delta's place") {
+		for (size_t i = 0; i < RAM_SIZE; i++) {
+			ram->writeByte(i, static_cast<uint8_t>(rng() | 1));
+		}
+		jagce::RewindBuffer probe{registers, 1, 1 << 20, 1};
+		probe.addMemory(*ram);
+		probe.capture();
+		const size_t keyframeSize = probe.bytesUsed();
+
+		// Deltas of unchanged memory are a single 4 byte run, with one byte changed they are 9
+		jagce::RewindBuffer rewind{registers, 100, keyframeSize + 36, 100};
+		rewind.addMemory(*ram);
+		for (size_t i = 0; i < 10; i++) {
+			rewind.capture();
+		}
+		REQUIRE(rewind.bytesUsed() == keyframeSize + 36);
+
+		// Wrapping around drops the keyframe, so the next capture is one
+		rewind.capture();
+		REQUIRE(rewind.size() == 1);
+		for (uint8_t i = 0; i < 4; i++) {
+			ram->writeByte(0x1000, static_cast<uint8_t>(2 * i));
+			rewind.capture();
+		}
+		CHECK(rewind.size() == 5);
+	}
+
+	SECTION("a rejected keyframe leaves the captures before it intact") {
+		jagce::RewindBuffer rewind{registers, 10, 256, 1};
+		rewind.addMemory(*ram);
+		runFrame(*ram, registers, rng);
+		const std::vector<uint8_t> captured = contents(*ram);
+		rewind.capture();
+
+		for (size_t i = 0; i < RAM_SIZE; i++) {
+			ram->writeByte(i, 0xFF);
+		}
+		CHECK_THROWS_AS(rewind.capture(), std::length_error);
+		CHECK_THROWS_AS(rewind.capture(), std::length_error);
+		REQUIRE(rewind.size() == 1);
+		REQUIRE(rewind.stepBack());
+		CHECK(contents(*ram) == captured);
+	}
+
+	SECTION("memory can't be added after capturing") {
+		jagce::RewindBuffer rewind{registers, 10, 1 << 16, 4};
+		rewind.addMemory(*ram);
+		rewind.capture();
+		CHECK_THROWS_AS(rewind.addMemory(*ram), std::logic_error);
+	}
+}
@@ -0,0 +1,150 @@
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "executor.hpp"
+#include "lz.hpp"
+#include "save_state.hpp"
+#include "static_ram.hpp"
+
+namespace {
+
+	constexpr int A = jagce::RegisterNames::A.getId();
+	constexpr int HL = jagce::RegisterNames::HL.getId();
+
+	// Mostly zeros with runs and some noise, like emulator memory
+	std::vector<uint8_t> sampleBytes(size_t size) {
+		std::mt19937 rng{12};
+		std::vector<uint8_t> bytes(size, 0);
+		for (size_t i = 0; i < size; i += 97) {
+			bytes[i] = static_cast<uint8_t>(rng());
+			for (size_t j = i + 1; j < std::min(size, i + 20); j++) {
+				bytes[j] = 0xAB;
+			}
+		}
+		return bytes;
+	}
+
+}
+
+TEST_CASE("LZ compression round trips", "[cpu], [save_state]") {
+	SECTION("empty input") {
+		std::vector<uint8_t> compressed{};
+		const size_t size = jagce::lzCompress(nullptr, 0, compressed);
+		CHECK(size == compressed.size());
+		jagce::lzDecompress(compressed.data(), compressed.size(), nullptr, 0);
+	}
+
+	SECTION("repetitive input shrinks") {
+		const std::vector<uint8_t> bytes = sampleBytes(0x4000);
+		std::vector<uint8_t> compressed{ 0x55 };
+		const size_t size = jagce::lzCompress(bytes.data(), bytes.size(), compressed);
+		CHECK(size == compressed.size() - 1);
+		CHECK(size < bytes.size() / 4);
+
+		std::vector<uint8_t> decompressed(bytes.size());
+		jagce::lzDecompress(compressed.data() + 1, size, decompressed.data(), decompressed.size());
+		CHECK(decompressed == bytes);
+	}
+
+	SECTION("random input survives") {
+		std::mt19937 rng{3};
+		std::vector<uint8_t> bytes(1000);
+		for (uint8_t& byte : bytes) {
+			byte = static_cast<uint8_t>(rng());
+		}
+		std::vector<uint8_t> compressed{};
+		jagce::lzCompress(bytes.data(), bytes.size(), compressed);
+
+		std::vector<uint8_t> decompressed(bytes.size());
+		jagce::lzDecompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size());
+		CHECK(decompressed == bytes);
+	}
+
+	SECTION("corrupt input throws") {
+		const std::vector<uint8_t> bytes = sampleBytes(0x400);
+		std::vector<uint8_t> compressed{};
+		jagce::lzCompress(bytes.data(), bytes.size(), compressed);
+
+		std::vector<uint8_t> decompressed(bytes.size() + 1);
+		CHECK_THROWS_AS(jagce::lzDecompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()),
+				std::invalid_argument);
+		CHECK_THROWS_AS(jagce::lzDecompress(compressed.data(), compressed.size() / 2, decompressed.data(), bytes.size()),
+				std::invalid_argument);
+	}
+}
+
+TEST_CASE("save states restore registers and memory", "[cpu], [save_state]") {
+	auto ram = std::make_unique<jagce::StaticRAM<0x10000>>();
+	jagce::StaticRAM<0x2000> cartridgeRAM{};
+	jagce::Registers registers{};
+	jagce::Executor executor{registers, *ram};
+
+	jagce::SaveState state{registers};
+	state.addMemory(*ram);
+	state.addMemory(cartridgeRAM);
+
+	const std::vector<uint8_t> bytes = sampleBytes(cartridgeRAM.size());
+	cartridgeRAM.writeBytes(0, bytes.data(), bytes.size());
+	// LD HL,0xC000; LD A,0xFF; ADD A,0x01; LD (HL+),A
+	const std::vector<uint8_t> code{ 0x21, 0x00, 0xC0, 0x3E, 0xFF, 0xC6, 0x01, 0x22 };
+	ram->writeBytes(0, code.data(), code.size());
+	jagce::ByteCursor in{code.data(), code.size()};
+	jagce::Decoder decoder{};
+	while (!in.empty()) {
+		executor.execute(decoder.decodeMicroOp(in));
+	}
+	registers.pc = 0x1234;
+	const jagce::Registers saved = registers;
+
+	const bool compress = GENERATE(false, true);
+	std::vector<uint8_t> data{};
+	state.save(data, compress);
+	if (compress) {
+		CHECK(data.size() < state.size() / 4);
+	} else {
+		CHECK(data.size() == state.size());
+	}
+
+	registers = jagce::Registers{};
+	ram->writeByte(0xC000, 0x77);
+	cartridgeRAM.writeByte(0, 0x77);
+	state.load(data);
+
+	CHECK(registers == saved);
+	CHECK(registers.get8(A) == 0x00);
+	CHECK(registers.get16(HL) == 0xC001);
+	CHECK(registers.f() == (jagce::FLAG_Z | jagce::FLAG_H | jagce::FLAG_C));
+	CHECK(ram->readByte(0xC000) == 0x00);
+	CHECK(ram->readByte(0x0005) == 0xC6);
+	CHECK(std::equal(bytes.begin(), bytes.end(), cartridgeRAM.readBytes(0, bytes.size())));
+
+	SECTION("mismatched saves are rejected without changes") {
+		registers.pc = 0x4321;
+
+		std::vector<uint8_t> badVersion = data;
+		badVersion[4] = 0xEE;
+		CHECK_THROWS_AS(state.load(badVersion), std::invalid_argument);
+
+		std::vector<uint8_t> truncated = data;
+		truncated.pop_back();
+		CHECK_THROWS_AS(state.load(truncated), std::invalid_argument);
+
+		// A payload size past the data, or too large to allocate
+		for (uint64_t payloadSize : { static_cast<uint64_t>(state.size()), ~uint64_t{0} }) {
+			std::vector<uint8_t> corrupt = data;
+			memcpy(corrupt.data() + offsetof(jagce::SaveStateHeader, payloadSize), &payloadSize, sizeof(payloadSize));
+			CHECK_THROWS_AS(state.load(corrupt), std::invalid_argument);
+		}
+
+		jagce::SaveState smaller{registers};
+		smaller.addMemory(*ram);
+		CHECK_THROWS_AS(smaller.load(data), std::invalid_argument);
+
+		CHECK(registers.pc == 0x4321);
+	}
+}
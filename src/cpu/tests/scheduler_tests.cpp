@@ -0,0 +1,159 @@
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include "interrupts.hpp"
+#include "lcd.hpp"
+#include "scheduler.hpp"
+#include "timer.hpp"
+
+namespace {
+
+	std::vector<jagce::ScheduledEvent> popAllDue(jagce::Scheduler& scheduler) {
+		std::vector<jagce::ScheduledEvent> events{};
+		while (auto event = scheduler.popDue()) {
+			events.push_back(*event);
+		}
+		return events;
+	}
+
+	// Advances to each event as the machine would, handling the LCD's
+	void runLcd(jagce::Scheduler& scheduler, jagce::Lcd& lcd, uint64_t cycles) {
+		const uint64_t end = scheduler.now() + cycles;
+		while (scheduler.nextTime() <= end) {
+			scheduler.advance(scheduler.nextTime() - scheduler.now());
+			for (jagce::ScheduledEvent event : popAllDue(scheduler)) {
+				if (event == jagce::ScheduledEvent::LCD_MODE) {
+					lcd.nextMode();
+				}
+			}
+		}
+		scheduler.advance(end - scheduler.now());
+	}
+
+}
+
+TEST_CASE("scheduler orders events by time", "[cpu], [scheduler]") {
+	using jagce::ScheduledEvent;
+	jagce::Scheduler scheduler{};
+
+	CHECK(scheduler.nextTime() == jagce::Scheduler::NEVER);
+	scheduler.schedule(ScheduledEvent::LCD_MODE, 100);
+	scheduler.schedule(ScheduledEvent::TIMER_OVERFLOW, 50);
+	CHECK(scheduler.nextTime() == 50);
+	CHECK_FALSE(scheduler.popDue().has_value());
+
+	SECTION("events come out once due") {
+		scheduler.advance(60);
+		CHECK(popAllDue(scheduler) == std::vector<ScheduledEvent>{ ScheduledEvent::TIMER_OVERFLOW });
+		scheduler.advance(40);
+		CHECK(popAllDue(scheduler) == std::vector<ScheduledEvent>{ ScheduledEvent::LCD_MODE });
+		CHECK(scheduler.nextTime() == jagce::Scheduler::NEVER);
+	}
+
+	SECTION("rescheduling replaces the pending event") {
+		scheduler.schedule(ScheduledEvent::TIMER_OVERFLOW, 150);
+		CHECK(scheduler.nextTime() == 100);
+		CHECK(scheduler.timeOf(ScheduledEvent::TIMER_OVERFLOW) == 150);
+		scheduler.advance(200);
+		CHECK(popAllDue(scheduler) == std::vector<ScheduledEvent>{ ScheduledEvent::LCD_MODE, ScheduledEvent::TIMER_OVERFLOW });
+	}
+
+	SECTION("cancelled events don't come out") {
+		scheduler.cancel(ScheduledEvent::TIMER_OVERFLOW);
+		CHECK_FALSE(scheduler.isScheduled(ScheduledEvent::TIMER_OVERFLOW));
+		CHECK_THROWS_AS(scheduler.timeOf(ScheduledEvent::TIMER_OVERFLOW), std::invalid_argument);
+		scheduler.advance(200);
+		CHECK(popAllDue(scheduler) == std::vector<ScheduledEvent>{ ScheduledEvent::LCD_MODE });
+	}
+
+	SECTION("events due together come out in event order") {
+		scheduler.schedule(ScheduledEvent::LCD_MODE, 50);
+		scheduler.advance(50);
+		CHECK(popAllDue(scheduler) == std::vector<ScheduledEvent>{ ScheduledEvent::TIMER_OVERFLOW, ScheduledEvent::LCD_MODE });
+	}
+}
+
+TEST_CASE("timer counts from the scheduler clock", "[cpu], [timer]") {
+	jagce::Scheduler scheduler{};
+	jagce::Interrupts interrupts{};
+	jagce::Timer timer{scheduler, interrupts};
+
+	SECTION("DIV counts every 256 cycles and resets on write") {
+		scheduler.advance(256 * 3 + 10);
+		CHECK(timer.read(jagce::Timer::DIV) == 3);
+		timer.write(jagce::Timer::DIV, 0x55);
+		CHECK(timer.read(jagce::Timer::DIV) == 0);
+		scheduler.advance(256);
+		CHECK(timer.read(jagce::Timer::DIV) == 1);
+	}
+
+	SECTION("TIMA only counts when enabled") {
+		scheduler.advance(4096);
+		CHECK(timer.read(jagce::Timer::TIMA) == 0);
+		CHECK_FALSE(scheduler.isScheduled(jagce::ScheduledEvent::TIMER_OVERFLOW));
+	}
+
+	SECTION("TIMA overflow is scheduled and reloads TMA") {
+		timer.write(jagce::Timer::TMA, 0xF0);
+		timer.write(jagce::Timer::TIMA, 0xFE);
+		// Enabled, incrementing every 16 cycles
+		timer.write(jagce::Timer::TAC, 0x05);
+		scheduler.advance(16);
+		CHECK(timer.read(jagce::Timer::TIMA) == 0xFF);
+		CHECK(scheduler.nextTime() == 32);
+
+		scheduler.advance(16);
+		CHECK(scheduler.popDue() == jagce::ScheduledEvent::TIMER_OVERFLOW);
+		timer.overflow();
+		CHECK(timer.read(jagce::Timer::TIMA) == 0xF0);
+		CHECK(interrupts.flags == jagce::INTERRUPT_TIMER);
+		CHECK(scheduler.nextTime() == 32 + 16 * 16);
+	}
+}
+
+TEST_CASE("LCD steps through modes on scheduled events", "[cpu], [lcd]") {
+	jagce::Scheduler scheduler{};
+	jagce::Interrupts interrupts{};
+	jagce::Lcd lcd{scheduler, interrupts};
+
+	CHECK_FALSE(scheduler.isScheduled(jagce::ScheduledEvent::LCD_MODE));
+	lcd.write(jagce::Lcd::LCDC, 0x91);
+	CHECK(lcd.getMode() == jagce::LcdMode::OAM_SEARCH);
+
+	SECTION("each line goes through OAM search, transfer and HBlank") {
+		runLcd(scheduler, lcd, 80);
+		CHECK(lcd.getMode() == jagce::LcdMode::TRANSFER);
+		runLcd(scheduler, lcd, 172);
+		CHECK(lcd.getMode() == jagce::LcdMode::HBLANK);
+		CHECK((lcd.read(jagce::Lcd::STAT) & 0x03) == 0);
+		runLcd(scheduler, lcd, 204);
+		CHECK(lcd.read(jagce::Lcd::LY) == 1);
+		CHECK(lcd.getMode() == jagce::LcdMode::OAM_SEARCH);
+	}
+
+	SECTION("VBlank starts at line 144 and the frame wraps after line 153") {
+		runLcd(scheduler, lcd, 144 * jagce::Lcd::LINE_CYCLES);
+		CHECK(lcd.getLine() == 144);
+		CHECK(lcd.getMode() == jagce::LcdMode::VBLANK);
+		CHECK(interrupts.flags == jagce::INTERRUPT_VBLANK);
+		runLcd(scheduler, lcd, 10 * jagce::Lcd::LINE_CYCLES);
+		CHECK(lcd.getLine() == 0);
+		CHECK(lcd.getMode() == jagce::LcdMode::OAM_SEARCH);
+	}
+
+	SECTION("LY coincidence requests the STAT interrupt when enabled") {
+		lcd.write(jagce::Lcd::LYC, 3);
+		lcd.write(jagce::Lcd::STAT, 0x40);
+		runLcd(scheduler, lcd, 3 * jagce::Lcd::LINE_CYCLES);
+		CHECK(interrupts.flags == jagce::INTERRUPT_STAT);
+		CHECK((lcd.read(jagce::Lcd::STAT) & 0x04) != 0);
+	}
+
+	SECTION("turning the LCD off stops it at line 0") {
+		runLcd(scheduler, lcd, 1000);
+		lcd.write(jagce::Lcd::LCDC, 0x11);
+		CHECK(lcd.getLine() == 0);
+		CHECK_FALSE(scheduler.isScheduled(jagce::ScheduledEvent::LCD_MODE));
+	}
+}
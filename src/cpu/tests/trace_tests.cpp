@@ -0,0 +1,182 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "machine.hpp"
+#include "trace.hpp"
+
+namespace {
+
+	// A path to a fresh temporary file, removed with the test
+	struct TemporaryPath {
+		std::string path;
+
+		TemporaryPath() {
+			char name[] = "/tmp/jagce_trace_XXXXXX";
+			const int fd = mkstemp(name);
+			REQUIRE(fd >= 0);
+			close(fd);
+			path = name;
+		}
+
+		~TemporaryPath() {
+			std::remove(path.c_str());
+		}
+	};
+
+	jagce::TraceRecord recordAt(uint64_t cycle) {
+		return {cycle, static_cast<uint16_t>(cycle), 0x00, 0, jagce::MicroOp{}};
+	}
+
+}
+
+TEST_CASE("trace ring passes records in order", "[cpu], [trace]") {
+	jagce::TraceRing ring{5};
+	REQUIRE(ring.capacity() == 8);
+	std::array<jagce::TraceRecord, 8> out{};
+
+	SECTION("pushes fail once the ring is full") {
+		for (uint64_t i = 0; i < 8; i++) {
+			CHECK(ring.tryPush(recordAt(i)));
+		}
+		CHECK(!ring.tryPush(recordAt(8)));
+
+		CHECK(ring.pop(out.data(), 3) == 3);
+		CHECK(out[2].cycle == 2);
+		CHECK(ring.tryPush(recordAt(8)));
+		CHECK(ring.pop(out.data(), out.size()) == 6);
+		CHECK(out[0].cycle == 3);
+		CHECK(out[5].cycle == 8);
+		CHECK(ring.pop(out.data(), out.size()) == 0);
+	}
+
+	SECTION("a consumer thread sees every record once") {
+		constexpr uint64_t COUNT = 100000;
+		std::thread producer{[&ring]() {
+			for (uint64_t i = 0; i < COUNT; i++) {
+				while (!ring.tryPush(recordAt(i))) {
+					std::this_thread::yield();
+				}
+			}
+		}};
+
+		uint64_t expected = 0;
+		bool ordered = true;
+		while (expected < COUNT) {
+			const size_t count = ring.pop(out.data(), out.size());
+			if (count == 0) {
+				std::this_thread::yield();
+			}
+			for (size_t i = 0; i < count; i++) {
+				ordered = ordered && out[i].cycle == expected;
+				expected++;
+			}
+		}
+		producer.join();
+		CHECK(ordered);
+	}
+}
+
+TEST_CASE("trace writer produces mappable trace files", "[cpu], [trace]") {
+	const TemporaryPath file{};
+
+	SECTION("records come back in order") {
+		jagce::TraceWriter writer{file.path, 16};
+		for (uint64_t i = 0; i < 1000; i++) {
+			writer.record(recordAt(i * 4));
+		}
+		writer.close();
+		CHECK(writer.getRecorded() == 1000);
+
+		const jagce::TraceFile trace{file.path};
+		REQUIRE(trace.size() == 1000);
+		CHECK(trace[0].cycle == 0);
+		CHECK(trace[999].cycle == 3996);
+		CHECK(trace[999].pc == 3996);
+	}
+
+	SECTION("the machine records each instruction it runs") {
+		jagce::Machine machine{};
+		// LD A,0x12; SWAP A; INC A; HALT
+		const std::vector<uint8_t> code{ 0x3E, 0x12, 0xCB, 0x37, 0x3C, 0x76 };
+		machine.getMemory().writeBytes(0x100, code.data(), code.size());
+		machine.getRegisters().pc = 0x100;
+
+		jagce::TraceWriter writer{file.path};
+		machine.setTrace(&writer);
+		machine.run(100);
+		writer.close();
+
+		const jagce::TraceFile trace{file.path};
+		REQUIRE(trace.size() == 4);
+		CHECK(trace[0].pc == 0x100);
+		CHECK(trace[0].op.kind == jagce::MicroOpKind::LOAD8);
+		CHECK(trace[1].pc == 0x102);
+		CHECK(trace[1].opcode == 0xCB37);
+		CHECK(trace[1].cycle == 8);
+		CHECK(trace[2].cycle == 8 + 8);
+		CHECK(trace[3].opcode == 0x76);
+	}
+
+	SECTION("blocks stopped by writes to their own code record what ran") {
+		jagce::Machine machine{};
+		// LD HL,0x106; LD (HL),0x76; INC B; INC B; HALT, where the write turns the second INC B into HALT
+		const std::vector<uint8_t> code{ 0x21, 0x06, 0x01, 0x36, 0x76, 0x04, 0x04, 0x76 };
+		machine.getMemory().writeBytes(0x100, code.data(), code.size());
+		machine.getRegisters().pc = 0x100;
+
+		jagce::TraceWriter writer{file.path};
+		machine.setTrace(&writer);
+		machine.run(100);
+		writer.close();
+
+		const jagce::TraceFile trace{file.path};
+		REQUIRE(trace.size() == 4);
+		CHECK(trace[1].pc == 0x103);
+		CHECK(trace[2].pc == 0x105);
+		CHECK(trace[2].cycle == 12 + 12);
+		CHECK(trace[3].pc == 0x106);
+		CHECK(trace[3].opcode == 0x76);
+	}
+
+	SECTION("idle loops record every iteration while tracing") {
+		jagce::Machine machine{};
+		// LDH A,(0x04); CP 0x05; JR NZ,-6; HALT, where DIV counts every 256 cycles
+		const std::vector<uint8_t> code{ 0xF0, 0x04, 0xFE, 0x05, 0x20, 0xFA, 0x76 };
+		machine.getMemory().writeBytes(0x100, code.data(), code.size());
+		machine.getRegisters().pc = 0x100;
+
+		jagce::TraceWriter writer{file.path};
+		machine.setTrace(&writer);
+		machine.run(0x800);
+		writer.close();
+		REQUIRE(machine.isHalted());
+
+		const jagce::TraceFile trace{file.path};
+		REQUIRE(trace.size() > 3 * 5 * 256 / 32);
+		REQUIRE(trace.size() % 3 == 1);
+		for (size_t i = 3; i + 1 < trace.size(); i += 3) {
+			CHECK(trace[i].pc == 0x100);
+			// LDH, CP and a taken JR
+			CHECK(trace[i].cycle - trace[i - 3].cycle == 12 + 8 + 12);
+		}
+		CHECK(trace[trace.size() - 1].opcode == 0x76);
+		CHECK(trace[trace.size() - 1].cycle - trace[trace.size() - 4].cycle == 12 + 8 + 8);
+	}
+
+	SECTION("other files are rejected") {
+		std::FILE* out = std::fopen(file.path.c_str(), "wb");
+		REQUIRE(out != nullptr);
+		std::fputs("not a trace file at all", out);
+		std::fclose(out);
+
+		CHECK_THROWS_AS(jagce::TraceFile{file.path}, std::runtime_error);
+	}
+}
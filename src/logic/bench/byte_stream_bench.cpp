@@ -0,0 +1,78 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+
+#include "byte_stream.hpp"
+
+namespace {
+
+	constexpr size_t BYTES_PER_BATCH = 4096;
+
+}
+
+static void BM_ByteStreamAdd(benchmark::State& state) {
+	for (auto _ : state) {
+		jagce::ByteStream stream{};
+		for (size_t i = 0; i < BYTES_PER_BATCH; i++) {
+			stream.add(static_cast<uint8_t>(i));
+		}
+		benchmark::DoNotOptimize(stream.size());
+	}
+	state.SetBytesProcessed(state.iterations() * BYTES_PER_BATCH);
+}
+BENCHMARK(BM_ByteStreamAdd);
+
+static void BM_ByteStreamGet(benchmark::State& state) {
+	for (auto _ : state) {
+		state.PauseTiming();
+		jagce::ByteStream stream{};
+		for (size_t i = 0; i < BYTES_PER_BATCH; i++) {
+			stream.add(static_cast<uint8_t>(i));
+		}
+		state.ResumeTiming();
+
+		uint8_t sum = 0;
+		while (!stream.empty()) {
+			sum += stream.get();
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetBytesProcessed(state.iterations() * BYTES_PER_BATCH);
+}
+BENCHMARK(BM_ByteStreamGet);
+
+// Reads of the operand sizes instructions have
+template <size_t N>
+static void BM_ByteStreamGetBytes(benchmark::State& state) {
+	std::array<uint8_t, N> buffer{};
+	for (auto _ : state) {
+		state.PauseTiming();
+		jagce::ByteStream stream{};
+		for (size_t i = 0; i < BYTES_PER_BATCH; i++) {
+			stream.add(static_cast<uint8_t>(i));
+		}
+		state.ResumeTiming();
+
+		while (stream.size() >= N) {
+			stream.getBytes<N>(buffer);
+			benchmark::DoNotOptimize(buffer.data());
+		}
+	}
+	state.SetBytesProcessed(state.iterations() * (BYTES_PER_BATCH / N * N));
+}
+BENCHMARK_TEMPLATE(BM_ByteStreamGetBytes, 1);
+BENCHMARK_TEMPLATE(BM_ByteStreamGetBytes, 2);
+BENCHMARK_TEMPLATE(BM_ByteStreamGetBytes, 3);
+
+// Refilling as a decoder drains it, the way a stream sits between memory and the decoder
+static void BM_ByteStreamAddGetInterleaved(benchmark::State& state) {
+	jagce::ByteStream stream{};
+	for (auto _ : state) {
+		for (size_t i = 0; i < BYTES_PER_BATCH; i++) {
+			stream.add(static_cast<uint8_t>(i));
+			benchmark::DoNotOptimize(stream.get());
+		}
+	}
+	state.SetBytesProcessed(state.iterations() * BYTES_PER_BATCH);
+}
+BENCHMARK(BM_ByteStreamAddGetInterleaved);
@@ -0,0 +1,187 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "decoder.hpp"
+#include "micro_op.hpp"
+#include "switch_decoder.hpp"
+
+namespace {
+
+	constexpr size_t INSTRUCTIONS_PER_BATCH = 4096;
+
+	// Every opcode followed by two operand bytes, so instructions with and without
+	// immediates are mixed in the same proportion as they appear in the opcode map.
+	std::vector<uint8_t> makeInstructionBytes() {
+		std::mt19937 rng{0x5EED};
+		std::uniform_int_distribution<int> byteDistribution{0x00, 0xFF};
+
+		std::vector<uint8_t> bytes{};
+		for (size_t i = 0; i < INSTRUCTIONS_PER_BATCH; i++) {
+			uint8_t opcode = static_cast<uint8_t>(byteDistribution(rng));
+			if (opcode == 0xCB || opcode == 0xDD || opcode == 0xED || opcode == 0xFD) {
+				opcode = 0x00;
+			}
+			bytes.push_back(opcode);
+			bytes.push_back(static_cast<uint8_t>(byteDistribution(rng)));
+			bytes.push_back(static_cast<uint8_t>(byteDistribution(rng)));
+		}
+		return bytes;
+	}
+
+	// Opcodes weighted roughly as they occur in game code: loads dominate, followed by
+	// ALU operations, jumps and calls, with CB-page bit operations mixed in
+	std::vector<uint8_t> makeRealisticInstructionBytes() {
+		struct Weighted {
+			std::vector<uint8_t> instruction;
+			int weight;
+		};
+		const std::vector<Weighted> mix{
+			{ { 0x3E, 0x10 }, 8 }, { { 0x78 }, 6 }, { { 0x7E }, 6 }, { { 0x22 }, 5 }, { { 0x2A }, 5 },
+			{ { 0xF0, 0x44 }, 4 }, { { 0xE0, 0x40 }, 3 }, { { 0xFA, 0x00, 0xC0 }, 3 }, { { 0xEA, 0x00, 0xC0 }, 3 },
+			{ { 0x21, 0x00, 0x98 }, 4 }, { { 0x11, 0x00, 0x80 }, 2 }, { { 0x01, 0x00, 0x01 }, 2 },
+			{ { 0xFE, 0x90 }, 4 }, { { 0xE6, 0x0F }, 3 }, { { 0xA7 }, 3 }, { { 0xAF }, 3 }, { { 0x80 }, 2 },
+			{ { 0x3C }, 2 }, { { 0x05 }, 3 }, { { 0x23 }, 4 }, { { 0x0B }, 2 }, { { 0x09 }, 1 },
+			{ { 0x20, 0xFA }, 5 }, { { 0x28, 0x04 }, 3 }, { { 0x18, 0x02 }, 2 }, { { 0xC3, 0x50, 0x01 }, 1 },
+			{ { 0xCD, 0x00, 0x20 }, 3 }, { { 0xC9 }, 3 }, { { 0xC5 }, 2 }, { { 0xE1 }, 2 },
+			{ { 0xCB, 0x7F }, 2 }, { { 0xCB, 0x37 }, 1 }, { { 0xCB, 0x27 }, 1 }, { { 0x00 }, 1 },
+		};
+
+		std::vector<int> weights{};
+		for (const Weighted& entry : mix) {
+			weights.push_back(entry.weight);
+		}
+		std::mt19937 rng{0x6A3E};
+		std::discrete_distribution<size_t> pick{weights.begin(), weights.end()};
+
+		std::vector<uint8_t> bytes{};
+		for (size_t i = 0; i < INSTRUCTIONS_PER_BATCH; i++) {
+			const std::vector<uint8_t>& instruction = mix[pick(rng)].instruction;
+			bytes.insert(bytes.end(), instruction.begin(), instruction.end());
+		}
+		return bytes;
+	}
+
+	template <typename D, typename Decode>
+	void decodeBatch(benchmark::State& state, Decode decode) {
+		const std::vector<uint8_t> bytes = makeInstructionBytes();
+		D decoder{};
+		int64_t decoded = 0;
+
+		for (auto _ : state) {
+			state.PauseTiming();
+			jagce::ByteStream in{};
+			for (uint8_t byte : bytes) {
+				in.add(byte);
+			}
+			state.ResumeTiming();
+
+			while (in.size() >= 3) {
+				benchmark::DoNotOptimize(decode(decoder, in));
+				decoded++;
+			}
+		}
+		state.SetItemsProcessed(decoded);
+	}
+
+}
+
+static void BM_DecodeEventTable(benchmark::State& state) {
+	decodeBatch<jagce::Decoder>(state, [](const auto& d, jagce::ByteStream& in) { return d.decodeEvent(in); });
+}
+BENCHMARK(BM_DecodeEventTable);
+
+static void BM_DecodeEventSwitch(benchmark::State& state) {
+	decodeBatch<jagce::SwitchDecoder>(state, [](const auto& d, jagce::ByteStream& in) { return d.decodeEvent(in); });
+}
+BENCHMARK(BM_DecodeEventSwitch);
+
+static void BM_DecodeMicroOp(benchmark::State& state) {
+	decodeBatch<jagce::Decoder>(state, [](const auto& d, jagce::ByteStream& in) { return d.decodeMicroOp(in); });
+}
+BENCHMARK(BM_DecodeMicroOp);
+
+static void BM_DecodeEventCursor(benchmark::State& state) {
+	const std::vector<uint8_t> bytes = makeInstructionBytes();
+	jagce::Decoder decoder{};
+	int64_t decoded = 0;
+
+	for (auto _ : state) {
+		jagce::ByteCursor in{bytes.data(), bytes.size()};
+		while (in.size() >= 3) {
+			benchmark::DoNotOptimize(decoder.decodeEvent(in));
+			decoded++;
+		}
+	}
+	state.SetItemsProcessed(decoded);
+}
+BENCHMARK(BM_DecodeEventCursor);
+
+static void BM_DecodeMicroOpCursor(benchmark::State& state) {
+	const std::vector<uint8_t> bytes = makeInstructionBytes();
+	jagce::Decoder decoder{};
+	int64_t decoded = 0;
+
+	for (auto _ : state) {
+		jagce::ByteCursor in{bytes.data(), bytes.size()};
+		while (in.size() >= 3) {
+			benchmark::DoNotOptimize(decoder.decodeMicroOp(in));
+			decoded++;
+		}
+	}
+	state.SetItemsProcessed(decoded);
+}
+BENCHMARK(BM_DecodeMicroOpCursor);
+
+static void BM_DecodeIntoBuffer(benchmark::State& state) {
+	const std::vector<uint8_t> bytes = makeInstructionBytes();
+	jagce::Decoder decoder{};
+	std::vector<jagce::MicroOp> ops(INSTRUCTIONS_PER_BATCH * 3);
+	int64_t decoded = 0;
+
+	for (auto _ : state) {
+		jagce::ByteCursor in{bytes.data(), bytes.size()};
+		const jagce::DecodeResult result = decoder.decodeInto(in, ops.data(), ops.size());
+		benchmark::DoNotOptimize(ops.data());
+		decoded += result.instructions;
+	}
+	state.SetItemsProcessed(decoded);
+}
+BENCHMARK(BM_DecodeIntoBuffer);
+
+static void BM_DecodeEventRealisticMix(benchmark::State& state) {
+	const std::vector<uint8_t> bytes = makeRealisticInstructionBytes();
+	jagce::Decoder decoder{};
+	int64_t decoded = 0;
+
+	for (auto _ : state) {
+		jagce::ByteCursor in{bytes.data(), bytes.size()};
+		while (!in.empty()) {
+			benchmark::DoNotOptimize(decoder.decodeEvent(in));
+			decoded++;
+		}
+	}
+	state.SetItemsProcessed(decoded);
+}
+BENCHMARK(BM_DecodeEventRealisticMix);
+
+// decodeEvents in batches of the argument, as a block decoder fetching ahead would
+static void BM_DecodeEventsBatch(benchmark::State& state) {
+	const std::vector<uint8_t> bytes = makeRealisticInstructionBytes();
+	const size_t batch = static_cast<size_t>(state.range(0));
+	jagce::Decoder decoder{};
+	int64_t decoded = 0;
+
+	for (auto _ : state) {
+		jagce::ByteCursor in{bytes.data(), bytes.size()};
+		// The longest instruction is 3 bytes, so a batch never runs past the end
+		while (in.size() >= batch * 3) {
+			const std::vector<jagce::Event> events = decoder.decodeEvents(in, batch);
+			benchmark::DoNotOptimize(events.data());
+			decoded += static_cast<int64_t>(events.size());
+		}
+	}
+	state.SetItemsProcessed(decoded);
+}
+BENCHMARK(BM_DecodeEventsBatch)->RangeMultiplier(4)->Range(1, 1024);
@@ -0,0 +1,74 @@
+#ifndef JAGCE_BYTE_CURSOR
+#define JAGCE_BYTE_CURSOR
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef MEM_ACCESS_ASSERTIONS
+#include <cassert>
+#endif
+
+namespace jagce {
+
+	/**
+	 * Non-owning read cursor over a contiguous buffer, for example the bytes returned by
+	 * RandomAccessMemory::readBytes at the current PC. Reads are not bounds checked, callers
+	 * are expected to check size() for everything they are about to read up front.
+	 */
+	class ByteCursor {
+	public:
+		ByteCursor(uint8_t const * bytes, size_t size) : begin{bytes}, pos{bytes}, end{bytes + size} {};
+
+		uint8_t get() {
+			#ifdef MEM_ACCESS_ASSERTIONS
+			assert(pos < end);
+			#endif
+			return *pos++;
+		}
+
+		uint8_t peek() const {
+			#ifdef MEM_ACCESS_ASSERTIONS
+			assert(pos < end);
+			#endif
+			return *pos;
+		}
+
+		// Reads a little-endian 16-bit value with a single unaligned load
+		uint16_t getImmediate16() {
+			#ifdef MEM_ACCESS_ASSERTIONS
+			assert(pos + 1 < end);
+			#endif
+			uint16_t value;
+			memcpy(&value, pos, sizeof(value));
+			pos += sizeof(value);
+			#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			value = static_cast<uint16_t>((value << 8) | (value >> 8));
+			#endif
+			return value;
+		}
+
+		void require(size_t n) const {
+			if (size() < n) {
+				throw std::out_of_range("Attempted read of " + std::to_string(n) + " bytes when only "
+						+ std::to_string(size()) + " bytes are available");
+			}
+		}
+
+		void skip(size_t n) { pos += n; }
+		size_t size() const { return static_cast<size_t>(end - pos); }
+		bool empty() const { return pos == end; }
+		size_t position() const { return static_cast<size_t>(pos - begin); }
+		uint8_t const * data() const { return pos; }
+
+	private:
+		uint8_t const * begin;
+		uint8_t const * pos;
+		uint8_t const * end;
+	};
+
+}
+
+#endif
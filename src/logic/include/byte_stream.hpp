@@ -2,7 +2,10 @@
 #define JAGCE_BYTE_STREAM
 
 #include <array>
+#include <cstdint>
 #include <queue>
+#include <stdexcept>
+#include <string>
 
 namespace jagce {
 
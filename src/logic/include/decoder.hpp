@@ -1,11 +1,15 @@
 #ifndef JAGCE_DECODER
-#define JAGCE_ENCODER
+#define JAGCE_DECODER
 
 #include <variant>
 #include <vector>
 #include <array>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
 
 #include "register_names.hpp"
+#include "byte_cursor.hpp"
 #include "byte_stream.hpp"
 
 namespace jagce {
@@ -198,7 +202,7 @@ namespace jagce {
 	constexpr FlagStateChange _addHLFlagStateChanges() {
 		FlagStateChange f{};
 		f.at(static_cast<size_t>(jagce::FlagName::S)) = jagce::FlagState::UNCH;
-		f.at(static_cast<size_t>(jagce::FlagName::Z)) = jagce::FlagState::RESET;
+		f.at(static_cast<size_t>(jagce::FlagName::Z)) = jagce::FlagState::UNCH;
 		f.at(static_cast<size_t>(jagce::FlagName::F5)) = jagce::FlagState::UNCH;
 		f.at(static_cast<size_t>(jagce::FlagName::H)) = jagce::FlagState::DEFER;
 		f.at(static_cast<size_t>(jagce::FlagName::F3)) = jagce::FlagState::UNCH;
@@ -350,7 +354,8 @@ namespace jagce {
 	enum class ShiftType {
 		LOGICAL,
 		ARITHMETIC,
-		ROTATE
+		ROTATE,
+		ROTATE_THROUGH_CARRY
 	};
 
 	struct RegisterShiftEvent {
@@ -367,16 +372,115 @@ namespace jagce {
 
 	using Event = std::variant<DecrementEvent8, IncrementEvent8, CompareEvent8, XorEvent8, OrEvent8, AndEvent8, SubEvent8, AddEvent8, PushEvent, PopEvent, RegisterShiftEvent, LoadEvent8, LoadEvent16, NopEvent, AddHLEvent, AddSPEvent, IncrementEvent16, DecrementEvent16>;
 
+	struct MicroOp;
+
+	// Limits of a batch decode, which stops before an instruction that would exceed either
+	struct DecodeLimits {
+		size_t maxBytes = std::numeric_limits<size_t>::max();
+		size_t maxInstructions = std::numeric_limits<size_t>::max();
+	};
+
+	struct DecodeResult {
+		size_t instructions;
+		size_t bytes;
+	};
+
+	class DecodeRange;
+
 	/** 
 	 * The decoder class consumes bytes from a byte stream as it's input
 	 * and produces 'events' from it. Events are state changes to RAM,
 	 * video memory or registers.
+	 *
+	 * A ByteCursor can be decoded in place of a ByteStream to decode straight
+	 * out of memory without copying. Reading past the end of either throws
+	 * std::out_of_range.
+	 *
+	 * The decodeInto overloads decode whole instructions from a cursor into
+	 * storage owned by the caller and never allocate themselves. They stop at
+	 * the limits, when the output is full or before an instruction that is cut
+	 * off by the end of the cursor, leaving the cursor after the last
+	 * instruction decoded.
 	 */
 	class Decoder {
 	public:
 		Event decodeEvent(ByteStream& in) const;
+		Event decodeEvent(ByteCursor& in) const;
+		MicroOp decodeMicroOp(ByteStream& in) const;
+		MicroOp decodeMicroOp(ByteCursor& in) const;
 		std::vector<Event> decodeEvents(ByteStream& in, size_t n) const;
+		std::vector<Event> decodeEvents(ByteCursor& in, size_t n) const;
 		std::vector<Event> decodeUntilEmpty(ByteStream& in) const;
+		std::vector<Event> decodeUntilEmpty(ByteCursor& in) const;
+
+		DecodeResult decodeInto(ByteCursor& in, Event* out, size_t capacity, DecodeLimits limits = {}) const;
+		DecodeResult decodeInto(ByteCursor& in, MicroOp* out, size_t capacity, DecodeLimits limits = {}) const;
+		// Appends to out, which allocates from its own memory resource
+		DecodeResult decodeInto(ByteCursor& in, std::pmr::vector<Event>& out, DecodeLimits limits = {}) const;
+
+		// Decodes one instruction each time the range is advanced
+		DecodeRange decodeRange(ByteCursor in, DecodeLimits limits = {}) const;
+	};
+
+	/**
+	 * Input iterator over the events decoded from a cursor, ending under the same
+	 * conditions as Decoder::decodeInto.
+	 */
+	class DecodeIterator {
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = Event;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Event*;
+		using reference = const Event&;
+
+		// The end iterator
+		DecodeIterator() : in{nullptr, 0}, limits{0, 0}, event{NopEvent{}}, done{true} {};
+		DecodeIterator(ByteCursor in, DecodeLimits limits) : in{in}, limits{limits}, event{NopEvent{}}, done{false} {
+			advance();
+		}
+
+		reference operator*() const { return event; }
+		pointer operator->() const { return &event; }
+
+		DecodeIterator& operator++() {
+			advance();
+			return *this;
+		}
+
+		DecodeIterator operator++(int) {
+			DecodeIterator previous = *this;
+			advance();
+			return previous;
+		}
+
+		bool operator==(const DecodeIterator& other) const {
+			return this->done == other.done && (this->done || this->in.data() == other.in.data());
+		}
+
+		bool operator!=(const DecodeIterator& other) const {
+			return !(*this == other);
+		}
+
+	private:
+		void advance();
+
+		ByteCursor in;
+		DecodeLimits limits;
+		Event event;
+		bool done;
+	};
+
+	class DecodeRange {
+	public:
+		DecodeRange(ByteCursor in, DecodeLimits limits) : in{in}, limits{limits} {};
+
+		DecodeIterator begin() const { return DecodeIterator{in, limits}; }
+		DecodeIterator end() const { return DecodeIterator{}; }
+
+	private:
+		ByteCursor in;
+		DecodeLimits limits;
 	};
 
 }
@@ -0,0 +1,258 @@
+#ifndef JAGCE_MICRO_OP
+#define JAGCE_MICRO_OP
+
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+#include "decoder.hpp"
+
+namespace jagce {
+
+	// Alternatives of Event, in the same order as the variant
+	enum class MicroOpKind : uint8_t {
+		DECREMENT8,
+		INCREMENT8,
+		COMPARE8,
+		XOR8,
+		OR8,
+		AND8,
+		SUB8,
+		ADD8,
+		PUSH,
+		POP,
+		REGISTER_SHIFT,
+		LOAD8,
+		LOAD16,
+		NOP,
+		ADD_HL,
+		ADD_SP,
+		INCREMENT16,
+		DECREMENT16
+	};
+
+	static_assert(std::variant_size_v<Event> == static_cast<size_t>(MicroOpKind::DECREMENT16) + 1,
+			"MicroOpKind must have one kind per Event alternative");
+
+	// Operand bytes hold the kind in the high nibble and a register id, Indirect or
+	// PartialAddress register mask in the low nibble. Operands with a value keep it
+	// in the immediate field and operands with a flag keep it in the aux field.
+	enum class OperandKind : uint8_t {
+		NONE,
+		REGISTER,
+		INDIRECT,
+		ADDRESS,
+		IMMEDIATE8,
+		IMMEDIATE16,
+		PARTIAL_ADDRESS,
+		REGISTER16_PLUS_VALUE,
+		REGISTER8_PLUS_FLAG,
+		INDIRECT_PLUS_FLAG,
+		IMMEDIATE8_PLUS_FLAG
+	};
+
+	constexpr uint8_t PARTIAL_ADDRESS_MSB_REGISTER = 0x01;
+	constexpr uint8_t PARTIAL_ADDRESS_LSB_REGISTER = 0x02;
+
+	/**
+	 * Packed, trivially copyable form of an Event. Everything an Event can hold fits
+	 * in 8 bytes as the decoder never produces more than one operand with a value.
+	 * Operand a is the destination (or only operand) and b is the source.
+	 */
+	struct MicroOp {
+		MicroOpKind kind;
+		uint8_t a;
+		uint8_t b;
+		// Flag of a *PlusFlag operand, or the direction, type and amount of a shift
+		uint8_t aux;
+		uint16_t immediate;
+		// Two bits per flag, holding the FlagState of the flag at that FlagName index
+		uint16_t flagEffects;
+
+		constexpr bool operator==(const MicroOp& other) const {
+			return this->kind == other.kind && this->a == other.a && this->b == other.b && this->aux == other.aux
+				&& this->immediate == other.immediate && this->flagEffects == other.flagEffects;
+		}
+
+		constexpr bool operator!=(const MicroOp& other) const {
+			return !(*this == other);
+		}
+
+		constexpr OperandKind operandKindA() const { return static_cast<OperandKind>(a >> 4); }
+		constexpr OperandKind operandKindB() const { return static_cast<OperandKind>(b >> 4); }
+		constexpr FlagState flagEffect(FlagName flag) const {
+			return static_cast<FlagState>((flagEffects >> (static_cast<size_t>(flag) * 2)) & 0x03);
+		}
+	};
+
+	static_assert(sizeof(MicroOp) <= 8, "MicroOp must fit in 8 bytes");
+	static_assert(std::is_trivially_copyable_v<MicroOp>, "MicroOp must be trivially copyable");
+
+	constexpr uint16_t encodeFlagStateChange(const FlagStateChange& f) {
+		uint16_t mask = 0;
+		for (size_t i = 0; i < f.size(); i++) {
+			mask |= static_cast<uint16_t>(static_cast<uint16_t>(f[i]) << (i * 2));
+		}
+		return mask;
+	}
+
+	constexpr FlagStateChange decodeFlagStateChange(uint16_t mask) {
+		FlagStateChange f{};
+		for (size_t i = 0; i < f.size(); i++) {
+			f.at(i) = static_cast<FlagState>((mask >> (i * 2)) & 0x03);
+		}
+		return f;
+	}
+
+	class MicroOpEncoder {
+	public:
+		constexpr MicroOpEncoder(MicroOpKind kind) : op{kind, 0, 0, 0, 0, 0}, immediateUsed{false} {};
+
+		constexpr MicroOp get() const { return op; }
+
+		constexpr void setA(uint8_t operand) { op.a = operand; }
+		constexpr void setB(uint8_t operand) { op.b = operand; }
+		constexpr void setFlagEffects(const FlagStateChange& f) { op.flagEffects = encodeFlagStateChange(f); }
+
+		constexpr void setShift(ShiftDirection direction, ShiftType type, unsigned int amount) {
+			if (amount > 0x1F) {
+				throw std::invalid_argument("Shift amount does not fit in a MicroOp");
+			}
+			op.aux = static_cast<uint8_t>(static_cast<uint8_t>(direction) | (static_cast<uint8_t>(type) << 1) | (amount << 3));
+		}
+
+		template <typename... Ts>
+		constexpr uint8_t operand(const std::variant<Ts...>& v) {
+			return std::visit([this](const auto& o) { return this->operand(o); }, v);
+		}
+
+		constexpr uint8_t operand(const RegisterName& r) {
+			return pack(OperandKind::REGISTER, static_cast<uint8_t>(r.getId()));
+		}
+
+		constexpr uint8_t operand(const Indirect& i) {
+			return pack(OperandKind::INDIRECT, static_cast<uint8_t>(i));
+		}
+
+		constexpr uint8_t operand(const Address& address) {
+			if (address > 0xFFFF) {
+				throw std::invalid_argument("Address does not fit in a MicroOp");
+			}
+			setImmediate(static_cast<uint16_t>(address));
+			return pack(OperandKind::ADDRESS, 0);
+		}
+
+		constexpr uint8_t operand(const Immediate8& n) {
+			setImmediate(n);
+			return pack(OperandKind::IMMEDIATE8, 0);
+		}
+
+		constexpr uint8_t operand(const Immediate16& nn) {
+			setImmediate(nn);
+			return pack(OperandKind::IMMEDIATE16, 0);
+		}
+
+		constexpr uint8_t operand(const PartialAddress& p) {
+			uint8_t registerMask = 0;
+			uint8_t msb = 0;
+			uint8_t lsb = 0;
+			if (const RegisterName8* r = std::get_if<RegisterName8>(&p.msb)) {
+				registerMask |= PARTIAL_ADDRESS_MSB_REGISTER;
+				msb = static_cast<uint8_t>(r->getId());
+			} else {
+				msb = std::get<Immediate8>(p.msb);
+			}
+			if (const RegisterName8* r = std::get_if<RegisterName8>(&p.lsb)) {
+				registerMask |= PARTIAL_ADDRESS_LSB_REGISTER;
+				lsb = static_cast<uint8_t>(r->getId());
+			} else {
+				lsb = std::get<Immediate8>(p.lsb);
+			}
+			setImmediate(static_cast<uint16_t>((msb << 8) | lsb));
+			return pack(OperandKind::PARTIAL_ADDRESS, registerMask);
+		}
+
+		constexpr uint8_t operand(const Register16PlusValue& r) {
+			setImmediate(r.val);
+			return pack(OperandKind::REGISTER16_PLUS_VALUE, static_cast<uint8_t>(r.reg.getId()));
+		}
+
+		constexpr uint8_t operand(const Register8PlusFlag& r) {
+			op.aux = static_cast<uint8_t>(r.flag);
+			return pack(OperandKind::REGISTER8_PLUS_FLAG, static_cast<uint8_t>(r.r.getId()));
+		}
+
+		constexpr uint8_t operand(const IndirectPlusFlag& i) {
+			op.aux = static_cast<uint8_t>(i.flag);
+			return pack(OperandKind::INDIRECT_PLUS_FLAG, static_cast<uint8_t>(i.i));
+		}
+
+		constexpr uint8_t operand(const Immediate8PlusFlag& n) {
+			setImmediate(n.n);
+			op.aux = static_cast<uint8_t>(n.flag);
+			return pack(OperandKind::IMMEDIATE8_PLUS_FLAG, 0);
+		}
+
+	private:
+		constexpr static uint8_t pack(OperandKind kind, uint8_t payload) {
+			return static_cast<uint8_t>((static_cast<uint8_t>(kind) << 4) | payload);
+		}
+
+		constexpr void setImmediate(uint16_t value) {
+			if (immediateUsed) {
+				throw std::invalid_argument("Event has more than one operand with a value");
+			}
+			op.immediate = value;
+			immediateUsed = true;
+		}
+
+		MicroOp op;
+		bool immediateUsed;
+	};
+
+	constexpr MicroOp toMicroOp(const Event& event) {
+		MicroOpEncoder encoder{static_cast<MicroOpKind>(event.index())};
+
+		std::visit([&encoder](const auto& e) {
+			using E = std::decay_t<decltype(e)>;
+			if constexpr (std::is_same_v<E, LoadEvent8>) {
+				encoder.setA(encoder.operand(e.dest));
+				encoder.setB(encoder.operand(e.src));
+			} else if constexpr (std::is_same_v<E, LoadEvent16>) {
+				encoder.setA(encoder.operand(e.dest));
+				encoder.setB(encoder.operand(e.src));
+				encoder.setFlagEffects(e.flagStates);
+			} else if constexpr (std::is_same_v<E, AddEvent8>) {
+				encoder.setA(encoder.operand(e.a));
+				encoder.setB(encoder.operand(e.b));
+				encoder.setFlagEffects(E::flagStates);
+			} else if constexpr (std::is_same_v<E, PushEvent>) {
+				encoder.setA(encoder.operand(e.src));
+			} else if constexpr (std::is_same_v<E, PopEvent>) {
+				encoder.setA(encoder.operand(e.dest));
+			} else if constexpr (std::is_same_v<E, RegisterShiftEvent>) {
+				encoder.setA(encoder.operand(e.registerName));
+				encoder.setShift(e.direction, e.type, e.amount);
+			} else if constexpr (std::is_same_v<E, AddSPEvent>) {
+				encoder.setA(encoder.operand(e.i));
+				encoder.setFlagEffects(E::flagStates);
+			} else if constexpr (std::is_same_v<E, AddHLEvent>) {
+				encoder.setA(encoder.operand(e.r));
+				encoder.setFlagEffects(E::flagStates);
+			} else if constexpr (std::is_same_v<E, IncrementEvent16> || std::is_same_v<E, DecrementEvent16>) {
+				encoder.setA(encoder.operand(e.r));
+			} else if constexpr (!std::is_same_v<E, NopEvent>) {
+				// The single operand 8-bit arithmetic events
+				encoder.setA(encoder.operand(e.r));
+				encoder.setFlagEffects(E::flagStates);
+			}
+		}, event);
+
+		return encoder.get();
+	}
+
+	Event toEvent(const MicroOp& op);
+
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef JAGCE_OPCODE_INFO
+#define JAGCE_OPCODE_INFO
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace jagce {
+
+	// Longest instruction, opcode plus a 16-bit immediate or prefix plus opcode
+	constexpr size_t MAX_INSTRUCTION_LENGTH = 3;
+
+	constexpr uint8_t CB_PREFIX = 0xCB;
+
+	// Length in bytes of the instruction starting with opcode, including the opcode. The CB
+	// prefix counts as the opcode of a two byte instruction.
+	constexpr size_t instructionLength(uint8_t opcode) {
+		switch (opcode) {
+			case 0x06: case 0x0E: case 0x16: case 0x1E: case 0x26: case 0x2E: case 0x36: case 0x3E:
+			case 0x10: case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+			case 0xC6: case 0xCE: case 0xD6: case 0xDE: case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+			case 0xE0: case 0xF0: case 0xE8: case 0xF8: case 0xCB:
+				return 2;
+			case 0x01: case 0x11: case 0x21: case 0x31: case 0x08:
+			case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA:
+			case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC:
+			case 0xEA: case 0xFA:
+				return 3;
+			default:
+				return 1;
+		}
+	}
+
+	namespace detail {
+
+		constexpr std::array<uint8_t, 256> makeInstructionLengths() {
+			std::array<uint8_t, 256> lengths{};
+			for (size_t opcode = 0; opcode < lengths.size(); opcode++) {
+				lengths[opcode] = static_cast<uint8_t>(instructionLength(static_cast<uint8_t>(opcode)));
+			}
+			return lengths;
+		}
+
+	}
+
+	// instructionLength of every opcode, for scanning many instructions with one load each
+	constexpr std::array<uint8_t, 256> INSTRUCTION_LENGTHS = detail::makeInstructionLengths();
+
+	// The eleven opcodes the CPU doesn't have, which lock it up
+	constexpr bool isIllegalOpcode(uint8_t opcode) {
+		switch (opcode) {
+			case 0xD3: case 0xDB: case 0xDD: case 0xE3: case 0xE4: case 0xEB:
+			case 0xEC: case 0xED: case 0xF4: case 0xFC: case 0xFD:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	// Jumps, calls, returns, restarts, HALT and STOP transfer control somewhere other than
+	// the next instruction, so a run of straight-line code ends after them.
+	constexpr bool endsBasicBlock(uint8_t opcode) {
+		switch (opcode) {
+			case 0x10: case 0x76:
+			case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+			case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: case 0xE9:
+			case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC:
+			case 0xC0: case 0xC8: case 0xC9: case 0xD0: case 0xD8: case 0xD9:
+			case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	// Transfers after which execution never falls through to the next instruction
+	constexpr bool isUnconditionalTransfer(uint8_t opcode) {
+		switch (opcode) {
+			case 0x18: case 0xC3: case 0xE9: case 0xC9: case 0xD9:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define JAGCE_REGISTER_NAMES
 
 #include <cstddef>
+#include <cstdint>
 #include <utility>
 #include <array>
 
@@ -9,6 +10,7 @@ namespace jagce {
 
 	struct RegisterName {
 		constexpr bool operator==(const RegisterName& other) const { return id == other.id; };
+		constexpr int getId() const { return id; };
 	private:
 		int id;
 	protected:
@@ -31,6 +33,12 @@ namespace jagce {
 		constexpr static RegisterName16 AF{7}, BC{8}, DE{9}, HL{10}, SP{11}, PC{12};
 	};
 
+	// Indexed by register id, 16-bit ids following on from the 8-bit ones
+	constexpr std::array<RegisterName8, 7> registerNames8{ RegisterNames::A, RegisterNames::B, RegisterNames::C,
+		RegisterNames::D, RegisterNames::E, RegisterNames::H, RegisterNames::L };
+	constexpr std::array<RegisterName16, 6> registerNames16{ RegisterNames::AF, RegisterNames::BC, RegisterNames::DE,
+		RegisterNames::HL, RegisterNames::SP, RegisterNames::PC };
+
 	// DEFER refers to FlagState events that cannot be described at the current time. For example,
 	// the H or C flag during the decoding step, as the contents of the registers is not known at
 	// that time.
@@ -0,0 +1,20 @@
+#ifndef JAGCE_SWITCH_DECODER
+#define JAGCE_SWITCH_DECODER
+
+#include "decoder.hpp"
+
+namespace jagce {
+
+	/**
+	 * Reference decoder implemented as a single switch over the opcode. It predates
+	 * the generated decode tables used by Decoder and is kept to verify them and to
+	 * serve as a benchmark baseline. It has no knowledge of the CB page.
+	 */
+	class SwitchDecoder {
+	public:
+		Event decodeEvent(ByteStream& in) const;
+	};
+
+}
+
+#endif
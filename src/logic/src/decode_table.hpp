@@ -0,0 +1,472 @@
+#ifndef JAGCE_DECODE_TABLE
+#define JAGCE_DECODE_TABLE
+
+#include <array>
+#include <utility>
+
+#include "byte_cursor.hpp"
+#include "decoder.hpp"
+#include "micro_op.hpp"
+#include "opcode_info.hpp"
+
+namespace jagce {
+
+	constexpr FlagStateChange _defaultFlagStateChange() {
+		FlagStateChange f{};
+		f.at(static_cast<size_t>(jagce::FlagName::S)) = jagce::FlagState::UNCH;
+		f.at(static_cast<size_t>(jagce::FlagName::Z)) = jagce::FlagState::UNCH;
+		f.at(static_cast<size_t>(jagce::FlagName::F5)) = jagce::FlagState::UNCH;
+		f.at(static_cast<size_t>(jagce::FlagName::H)) = jagce::FlagState::UNCH;
+		f.at(static_cast<size_t>(jagce::FlagName::F3)) = jagce::FlagState::UNCH;
+		f.at(static_cast<size_t>(jagce::FlagName::PV)) = jagce::FlagState::UNCH;
+		f.at(static_cast<size_t>(jagce::FlagName::N)) = jagce::FlagState::UNCH;
+		f.at(static_cast<size_t>(jagce::FlagName::C)) = jagce::FlagState::UNCH;
+
+		return f;
+	};
+
+	constexpr FlagStateChange _loadHLFlagStateChange() {
+		FlagStateChange f{_defaultFlagStateChange()};
+		f.at(static_cast<size_t>(jagce::FlagName::Z)) = jagce::FlagState::RESET;
+		f.at(static_cast<size_t>(jagce::FlagName::N)) = jagce::FlagState::RESET;
+		f.at(static_cast<size_t>(jagce::FlagName::H)) = jagce::FlagState::DEFER;
+		f.at(static_cast<size_t>(jagce::FlagName::C)) = jagce::FlagState::DEFER;
+
+		return f;
+	};
+
+	constexpr FlagStateChange defaultFlagStateChange = _defaultFlagStateChange();
+	constexpr FlagStateChange loadHLFlagStateChange = _loadHLFlagStateChange();
+
+	// How the operand bytes following an opcode are read
+	enum class OperandEncoding : uint8_t {
+		NONE,
+		IMMEDIATE8,
+		HIGH_PAGE,
+		IMMEDIATE16,
+		// Operands of instructions that have no event yet, read and dropped
+		UNUSED_IMMEDIATE8,
+		UNUSED_IMMEDIATE16,
+		CB_PAGE,
+		PREFIXED
+	};
+
+	constexpr size_t operandLength(OperandEncoding operands) {
+		switch (operands) {
+			case OperandEncoding::NONE: return 0;
+			case OperandEncoding::IMMEDIATE16: return 2;
+			case OperandEncoding::UNUSED_IMMEDIATE16: return 2;
+			default: return 1;
+		}
+	}
+
+	inline Immediate16 readImmediate16(ByteStream& in) {
+		uint8_t lsb = in.get();
+		uint8_t msb = in.get();
+		return (msb << (sizeof(uint8_t) * 8)) + lsb;
+	};
+
+	inline Immediate16 readImmediate16(ByteCursor& in) {
+		return in.getImmediate16();
+	};
+
+	// ByteStream checks every read itself, a ByteCursor is checked once per instruction
+	inline void requireBytes(ByteStream&, size_t) {}
+
+	inline void requireBytes(ByteCursor& in, size_t n) {
+		in.require(n);
+	}
+
+	// Reads the operand bytes of an instruction with immediates. High page operands are
+	// returned as the full address, 0xFF00 + n.
+	template <typename In>
+	uint16_t readOperand(OperandEncoding operands, In& in) {
+		requireBytes(in, operandLength(operands));
+		switch (operands) {
+			case OperandEncoding::IMMEDIATE16:
+			case OperandEncoding::UNUSED_IMMEDIATE16:
+				return readImmediate16(in);
+			case OperandEncoding::HIGH_PAGE:
+				return static_cast<uint16_t>(0xFF00 + in.get());
+			default:
+				return in.get();
+		}
+	}
+
+	// Applies the operand of an instruction with immediates to the prebuilt event of the
+	// table entry, which acts as a prototype for everything that is not read from the stream.
+	using OperandApplier = Event (*)(const Event& prototype, uint16_t operand);
+
+	struct DecodeEntry {
+		Event prototype;
+		OperandApplier applyOperand;
+		OperandEncoding operands;
+	};
+
+	inline Event applyLoad8SourceImmediate(const Event& prototype, uint16_t operand) {
+		LoadEvent8 load = std::get<LoadEvent8>(prototype);
+		load.src = static_cast<Immediate8>(operand);
+		return load;
+	}
+
+	inline Event applyLoad8SourceAddress(const Event& prototype, uint16_t operand) {
+		LoadEvent8 load = std::get<LoadEvent8>(prototype);
+		load.src = Address{operand};
+		return load;
+	}
+
+	inline Event applyLoad8DestinationAddress(const Event& prototype, uint16_t operand) {
+		LoadEvent8 load = std::get<LoadEvent8>(prototype);
+		load.dest = Address{operand};
+		return load;
+	}
+
+	inline Event applyLoad16SourceImmediate(const Event& prototype, uint16_t operand) {
+		LoadEvent16 load = std::get<LoadEvent16>(prototype);
+		load.src = Immediate16{operand};
+		return load;
+	}
+
+	inline Event applyLoad16DestinationAddress(const Event& prototype, uint16_t operand) {
+		LoadEvent16 load = std::get<LoadEvent16>(prototype);
+		load.dest = Address{operand};
+		return load;
+	}
+
+	inline Event applyLoadHLStackPlusImmediate(const Event& prototype, uint16_t operand) {
+		LoadEvent16 load = std::get<LoadEvent16>(prototype);
+		load.src = Register16PlusValue{RegisterNames::SP, operand};
+		return load;
+	}
+
+	inline Event applyAdd8Immediate(const Event&, uint16_t operand) {
+		return AddEvent8{RegisterNames::A, static_cast<Immediate8>(operand)};
+	}
+
+	inline Event applyAddCarry8Immediate(const Event&, uint16_t operand) {
+		return AddEvent8{RegisterNames::A, Immediate8PlusFlag{static_cast<Immediate8>(operand), FlagName::C}};
+	}
+
+	inline Event applySubCarry8Immediate(const Event&, uint16_t operand) {
+		return SubEvent8{Immediate8PlusFlag{static_cast<Immediate8>(operand), FlagName::C}};
+	}
+
+	inline Event applyAddSPImmediate(const Event&, uint16_t operand) {
+		return AddSPEvent{static_cast<Immediate8>(operand)};
+	}
+
+	template <typename E>
+	Event applyAlu8Immediate(const Event&, uint16_t operand) {
+		return E{static_cast<Immediate8>(operand)};
+	}
+
+	// Operand index as encoded in the low three bits of most opcodes: B, C, D, E, H, L, (HL), A
+	constexpr size_t OPERAND_INDIRECT_HL = 6;
+
+	constexpr RegisterName8 register8FromIndex(size_t i) {
+		switch (i) {
+			case 0: return RegisterNames::B;
+			case 1: return RegisterNames::C;
+			case 2: return RegisterNames::D;
+			case 3: return RegisterNames::E;
+			case 4: return RegisterNames::H;
+			case 5: return RegisterNames::L;
+			default: return RegisterNames::A;
+		}
+	}
+
+	constexpr Readable8 readable8FromIndex(size_t i) {
+		if (i == OPERAND_INDIRECT_HL) {
+			return Indirect::HL;
+		}
+		return register8FromIndex(i);
+	}
+
+	constexpr Writeable writeableFromIndex(size_t i) {
+		if (i == OPERAND_INDIRECT_HL) {
+			return Indirect::HL;
+		}
+		return register8FromIndex(i);
+	}
+
+	constexpr Readable8 readable8PlusCarryFromIndex(size_t i) {
+		if (i == OPERAND_INDIRECT_HL) {
+			return IndirectPlusFlag{Indirect::HL, FlagName::C};
+		}
+		return Register8PlusFlag{register8FromIndex(i), FlagName::C};
+	}
+
+	// Register pair as encoded in bits 4-5 of the 16-bit arithmetic and load opcodes
+	constexpr RegisterName16 register16FromIndex(size_t i) {
+		switch (i) {
+			case 0: return RegisterNames::BC;
+			case 1: return RegisterNames::DE;
+			case 2: return RegisterNames::HL;
+			default: return RegisterNames::SP;
+		}
+	}
+
+	// Register pair as encoded in bits 4-5 of the push and pop opcodes
+	constexpr RegisterName16 stackRegister16FromIndex(size_t i) {
+		return i == 3 ? RegisterNames::AF : register16FromIndex(i);
+	}
+
+	constexpr Indirect indirectFromIndex(size_t i) {
+		switch (i) {
+			case 0: return Indirect::BC;
+			case 1: return Indirect::DE;
+			case 2: return Indirect::HLI;
+			default: return Indirect::HLD;
+		}
+	}
+
+	constexpr DecodeEntry prebuilt(Event e) {
+		return {e, nullptr, OperandEncoding::NONE};
+	}
+
+	constexpr DecodeEntry withOperands(Event prototype, OperandApplier applyOperand, OperandEncoding operands) {
+		return {prototype, applyOperand, operands};
+	}
+
+	constexpr DecodeEntry nop() {
+		return prebuilt(NopEvent{});
+	}
+
+	// Instructions without events still have their operands skipped
+	constexpr DecodeEntry unsupported(uint8_t opcode) {
+		switch (instructionLength(opcode)) {
+			case 2: return withOperands(NopEvent{}, nullptr, OperandEncoding::UNUSED_IMMEDIATE8);
+			case 3: return withOperands(NopEvent{}, nullptr, OperandEncoding::UNUSED_IMMEDIATE16);
+			default: return nop();
+		}
+	}
+
+	constexpr DecodeEntry alu8Entry(size_t operation, Readable8 r, Readable8 rPlusCarry) {
+		switch (operation) {
+			case 0: return prebuilt(AddEvent8{RegisterNames::A, r});
+			case 1: return prebuilt(AddEvent8{RegisterNames::A, rPlusCarry});
+			case 2: return prebuilt(SubEvent8{r});
+			case 3: return prebuilt(SubEvent8{rPlusCarry});
+			case 4: return prebuilt(AndEvent8{r});
+			case 5: return prebuilt(XorEvent8{r});
+			case 6: return prebuilt(OrEvent8{r});
+			default: return prebuilt(CompareEvent8{r});
+		}
+	}
+
+	constexpr DecodeEntry makeMainDecodeEntry(uint8_t opcode) {
+		const size_t x = opcode >> 6;
+		const size_t y = (opcode >> 3) & 0x07;
+		const size_t z = opcode & 0x07;
+		const size_t p = y >> 1;
+
+		if (x == 1) {
+			// 0x76 is HALT, which has no event yet
+			if (opcode == 0x76) {
+				return nop();
+			}
+			return prebuilt(LoadEvent8{writeableFromIndex(y), readable8FromIndex(z)});
+		}
+
+		if (x == 2) {
+			return alu8Entry(y, readable8FromIndex(z), readable8PlusCarryFromIndex(z));
+		}
+
+		if (x == 0) {
+			switch (z) {
+				case 1:
+					if (y & 1) {
+						return prebuilt(AddHLEvent{register16FromIndex(p)});
+					}
+					return withOperands(LoadEvent16{{register16FromIndex(p)}, {Immediate16{0}}, {}},
+							applyLoad16SourceImmediate, OperandEncoding::IMMEDIATE16);
+				case 2:
+					if (y & 1) {
+						return prebuilt(LoadEvent8{{RegisterNames::A}, {indirectFromIndex(p)}});
+					}
+					return prebuilt(LoadEvent8{{indirectFromIndex(p)}, {RegisterNames::A}});
+				case 3:
+					if (y & 1) {
+						return prebuilt(DecrementEvent16{register16FromIndex(p)});
+					}
+					return prebuilt(IncrementEvent16{register16FromIndex(p)});
+				case 4:
+					return prebuilt(IncrementEvent8{writeableFromIndex(y)});
+				case 5:
+					return prebuilt(DecrementEvent8{writeableFromIndex(y)});
+				case 6:
+					return withOperands(LoadEvent8{writeableFromIndex(y), {Immediate8{0}}}, applyLoad8SourceImmediate, OperandEncoding::IMMEDIATE8);
+				default:
+					break;
+			}
+
+			if (opcode == 0x08) {
+				return withOperands(LoadEvent16{{Address{0}}, {RegisterNames::SP}, defaultFlagStateChange},
+						applyLoad16DestinationAddress, OperandEncoding::IMMEDIATE16);
+			}
+			return unsupported(opcode);
+		}
+
+		switch (opcode) {
+			case 0xC1: case 0xD1: case 0xE1: case 0xF1:
+				return prebuilt(PopEvent{stackRegister16FromIndex(p)});
+			case 0xC5: case 0xD5: case 0xE5: case 0xF5:
+				return prebuilt(PushEvent{stackRegister16FromIndex(p)});
+			case 0xC6:
+				return withOperands(AddEvent8{RegisterNames::A, Immediate8{0}}, applyAdd8Immediate, OperandEncoding::IMMEDIATE8);
+			case 0xCE:
+				return withOperands(AddEvent8{RegisterNames::A, Immediate8PlusFlag{0, FlagName::C}}, applyAddCarry8Immediate, OperandEncoding::IMMEDIATE8);
+			case 0xD6:
+				return withOperands(SubEvent8{Immediate8{0}}, applyAlu8Immediate<SubEvent8>, OperandEncoding::IMMEDIATE8);
+			case 0xDE:
+				return withOperands(SubEvent8{Immediate8PlusFlag{0, FlagName::C}}, applySubCarry8Immediate, OperandEncoding::IMMEDIATE8);
+			case 0xE6:
+				return withOperands(AndEvent8{Immediate8{0}}, applyAlu8Immediate<AndEvent8>, OperandEncoding::IMMEDIATE8);
+			case 0xEE:
+				return withOperands(XorEvent8{Immediate8{0}}, applyAlu8Immediate<XorEvent8>, OperandEncoding::IMMEDIATE8);
+			case 0xF6:
+				return withOperands(OrEvent8{Immediate8{0}}, applyAlu8Immediate<OrEvent8>, OperandEncoding::IMMEDIATE8);
+			case 0xFE:
+				return withOperands(CompareEvent8{Immediate8{0}}, applyAlu8Immediate<CompareEvent8>, OperandEncoding::IMMEDIATE8);
+			case 0xE0:
+				return withOperands(LoadEvent8{{Address{0}}, {RegisterNames::A}}, applyLoad8DestinationAddress, OperandEncoding::HIGH_PAGE);
+			case 0xF0:
+				return withOperands(LoadEvent8{{RegisterNames::A}, {Address{0}}}, applyLoad8SourceAddress, OperandEncoding::HIGH_PAGE);
+			case 0xE2:
+				// load from A to address at 0xFF00 + (contents of C)
+				return prebuilt(LoadEvent8{{PartialAddress{{Immediate8{0xFF}}, {RegisterNames::C}}}, {RegisterNames::A}});
+			case 0xF2:
+				// load from address at 0xFF00 + (contents of C) to A
+				return prebuilt(LoadEvent8{{RegisterNames::A}, {PartialAddress{{Immediate8{0xFF}}, {RegisterNames::C}}}});
+			case 0xEA:
+				return withOperands(LoadEvent8{{Address{0}}, {RegisterNames::A}}, applyLoad8DestinationAddress, OperandEncoding::IMMEDIATE16);
+			case 0xFA:
+				return withOperands(LoadEvent8{{RegisterNames::A}, {Address{0}}}, applyLoad8SourceAddress, OperandEncoding::IMMEDIATE16);
+			case 0xE8:
+				return withOperands(AddSPEvent{0}, applyAddSPImmediate, OperandEncoding::IMMEDIATE8);
+			case 0xF8:
+				return withOperands(LoadEvent16{{RegisterNames::HL}, {Register16PlusValue{RegisterNames::SP, 0}},
+						loadHLFlagStateChange}, applyLoadHLStackPlusImmediate, OperandEncoding::IMMEDIATE8);
+			case 0xF9:
+				return prebuilt(LoadEvent16{{RegisterNames::SP}, {RegisterNames::HL}, defaultFlagStateChange});
+			case 0xCB:
+				return withOperands(NopEvent{}, nullptr, OperandEncoding::CB_PAGE);
+			case 0xDD: case 0xED: case 0xFD:
+				return withOperands(NopEvent{}, nullptr, OperandEncoding::PREFIXED);
+			default:
+				return unsupported(opcode);
+		}
+	}
+
+	constexpr DecodeEntry makeCBDecodeEntry(uint8_t opcode) {
+		const size_t x = opcode >> 6;
+		const size_t y = (opcode >> 3) & 0x07;
+		const size_t z = opcode & 0x07;
+
+		// BIT, RES, SET, SWAP and the (HL) forms of the shifts have no events yet
+		if (x != 0 || y == 6 || z == OPERAND_INDIRECT_HL) {
+			return nop();
+		}
+
+		const RegisterName r = register8FromIndex(z);
+		switch (y) {
+			case 0: return prebuilt(RegisterShiftEvent{r, ShiftDirection::LEFT, ShiftType::ROTATE, 1});
+			case 1: return prebuilt(RegisterShiftEvent{r, ShiftDirection::RIGHT, ShiftType::ROTATE, 1});
+			case 2: return prebuilt(RegisterShiftEvent{r, ShiftDirection::LEFT, ShiftType::ROTATE_THROUGH_CARRY, 1});
+			case 3: return prebuilt(RegisterShiftEvent{r, ShiftDirection::RIGHT, ShiftType::ROTATE_THROUGH_CARRY, 1});
+			case 4: return prebuilt(RegisterShiftEvent{r, ShiftDirection::LEFT, ShiftType::ARITHMETIC, 1});
+			case 5: return prebuilt(RegisterShiftEvent{r, ShiftDirection::RIGHT, ShiftType::ARITHMETIC, 1});
+			default: return prebuilt(RegisterShiftEvent{r, ShiftDirection::RIGHT, ShiftType::LOGICAL, 1});
+		}
+	}
+
+	using DecodeTable = std::array<DecodeEntry, 256>;
+
+	template <size_t... I>
+	constexpr DecodeTable makeMainDecodeTable(std::index_sequence<I...>) {
+		return {{ makeMainDecodeEntry(static_cast<uint8_t>(I))... }};
+	}
+
+	template <size_t... I>
+	constexpr DecodeTable makeCBDecodeTable(std::index_sequence<I...>) {
+		return {{ makeCBDecodeEntry(static_cast<uint8_t>(I))... }};
+	}
+
+	constexpr DecodeTable mainDecodeTable = makeMainDecodeTable(std::make_index_sequence<256>{});
+	constexpr DecodeTable cbDecodeTable = makeCBDecodeTable(std::make_index_sequence<256>{});
+
+	constexpr bool decodeTableMatchesInstructionLengths() {
+		for (size_t opcode = 0; opcode < mainDecodeTable.size(); opcode++) {
+			const OperandEncoding operands = mainDecodeTable[opcode].operands;
+			if (operands != OperandEncoding::PREFIXED
+					&& 1 + operandLength(operands) != instructionLength(static_cast<uint8_t>(opcode))) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static_assert(decodeTableMatchesInstructionLengths(), "Decode table operands must match instructionLength");
+
+	struct MicroOpDecodeEntry {
+		MicroOp prototype;
+		OperandEncoding operands;
+	};
+
+	using MicroOpDecodeTable = std::array<MicroOpDecodeEntry, 256>;
+
+	template <size_t... I>
+	constexpr MicroOpDecodeTable makeMicroOpDecodeTable(const DecodeTable& table, std::index_sequence<I...>) {
+		return {{ MicroOpDecodeEntry{toMicroOp(table[I].prototype), table[I].operands}... }};
+	}
+
+	constexpr MicroOpDecodeTable mainMicroOpDecodeTable = makeMicroOpDecodeTable(mainDecodeTable, std::make_index_sequence<256>{});
+	constexpr MicroOpDecodeTable cbMicroOpDecodeTable = makeMicroOpDecodeTable(cbDecodeTable, std::make_index_sequence<256>{});
+
+	template <typename In>
+	MicroOp decodeMicroOpFromTable(const MicroOpDecodeTable& table, In& in) {
+		requireBytes(in, 1);
+		const MicroOpDecodeEntry& entry = table[in.get()];
+		switch (entry.operands) {
+			case OperandEncoding::NONE:
+				return entry.prototype;
+			case OperandEncoding::UNUSED_IMMEDIATE8:
+			case OperandEncoding::UNUSED_IMMEDIATE16:
+				readOperand(entry.operands, in);
+				return entry.prototype;
+			case OperandEncoding::CB_PAGE:
+				return decodeMicroOpFromTable(cbMicroOpDecodeTable, in);
+			case OperandEncoding::PREFIXED:
+				return decodeMicroOpFromTable(mainMicroOpDecodeTable, in);
+			default:
+				{
+					MicroOp op = entry.prototype;
+					op.immediate = readOperand(entry.operands, in);
+					return op;
+				}
+		}
+	}
+
+	template <typename In>
+	Event decodeFromTable(const DecodeTable& table, In& in) {
+		requireBytes(in, 1);
+		const DecodeEntry& entry = table[in.get()];
+		switch (entry.operands) {
+			case OperandEncoding::NONE:
+				return entry.prototype;
+			case OperandEncoding::UNUSED_IMMEDIATE8:
+			case OperandEncoding::UNUSED_IMMEDIATE16:
+				readOperand(entry.operands, in);
+				return entry.prototype;
+			case OperandEncoding::CB_PAGE:
+				return decodeFromTable(cbDecodeTable, in);
+			case OperandEncoding::PREFIXED:
+				return decodeFromTable(mainDecodeTable, in);
+			default:
+				return entry.applyOperand(entry.prototype, readOperand(entry.operands, in));
+		}
+	}
+
+}
+
+#endif
@@ -0,0 +1,164 @@
+#include "micro_op.hpp"
+
+namespace jagce {
+
+	namespace {
+
+		uint8_t payload(uint8_t operand) {
+			return operand & 0x0F;
+		}
+
+		OperandKind operandKind(uint8_t operand) {
+			return static_cast<OperandKind>(operand >> 4);
+		}
+
+		RegisterName8 register8FromId(uint8_t id) {
+			if (id >= registerNames8.size()) {
+				throw std::invalid_argument("MicroOp operand is not an 8-bit register");
+			}
+			return registerNames8[id];
+		}
+
+		RegisterName16 register16FromId(uint8_t id) {
+			if (id < registerNames8.size() || id >= registerNames8.size() + registerNames16.size()) {
+				throw std::invalid_argument("MicroOp operand is not a 16-bit register");
+			}
+			return registerNames16[id - registerNames8.size()];
+		}
+
+		RegisterName registerFromId(uint8_t id) {
+			if (id < registerNames8.size()) {
+				return register8FromId(id);
+			}
+			return register16FromId(id);
+		}
+
+		std::invalid_argument invalidOperand() {
+			return std::invalid_argument("MicroOp operand kind is not valid for its event");
+		}
+
+		PartialAddress decodePartialAddress(uint8_t operand, uint16_t immediate) {
+			const uint8_t msb = static_cast<uint8_t>(immediate >> 8);
+			const uint8_t lsb = static_cast<uint8_t>(immediate);
+			PartialAddress p{{Immediate8{msb}}, {Immediate8{lsb}}};
+			if (payload(operand) & PARTIAL_ADDRESS_MSB_REGISTER) {
+				p.msb = register8FromId(msb);
+			}
+			if (payload(operand) & PARTIAL_ADDRESS_LSB_REGISTER) {
+				p.lsb = register8FromId(lsb);
+			}
+			return p;
+		}
+
+		Writeable decodeWriteable(const MicroOp& op, uint8_t operand) {
+			switch (operandKind(operand)) {
+				case OperandKind::REGISTER: return registerFromId(payload(operand));
+				case OperandKind::INDIRECT: return static_cast<Indirect>(payload(operand));
+				case OperandKind::ADDRESS: return Address{op.immediate};
+				case OperandKind::PARTIAL_ADDRESS: return decodePartialAddress(operand, op.immediate);
+				default: throw invalidOperand();
+			}
+		}
+
+		Writeable16 decodeWriteable16(const MicroOp& op, uint8_t operand) {
+			switch (operandKind(operand)) {
+				case OperandKind::REGISTER: return register16FromId(payload(operand));
+				case OperandKind::INDIRECT: return static_cast<Indirect>(payload(operand));
+				case OperandKind::ADDRESS: return Address{op.immediate};
+				case OperandKind::PARTIAL_ADDRESS: return decodePartialAddress(operand, op.immediate);
+				default: throw invalidOperand();
+			}
+		}
+
+		Readable8 decodeReadable8(const MicroOp& op, uint8_t operand) {
+			const FlagName flag = static_cast<FlagName>(op.aux);
+			switch (operandKind(operand)) {
+				case OperandKind::REGISTER: return register8FromId(payload(operand));
+				case OperandKind::ADDRESS: return Address{op.immediate};
+				case OperandKind::IMMEDIATE8: return static_cast<Immediate8>(op.immediate);
+				case OperandKind::INDIRECT: return static_cast<Indirect>(payload(operand));
+				case OperandKind::PARTIAL_ADDRESS: return decodePartialAddress(operand, op.immediate);
+				case OperandKind::REGISTER8_PLUS_FLAG: return Register8PlusFlag{register8FromId(payload(operand)), flag};
+				case OperandKind::INDIRECT_PLUS_FLAG: return IndirectPlusFlag{static_cast<Indirect>(payload(operand)), flag};
+				case OperandKind::IMMEDIATE8_PLUS_FLAG: return Immediate8PlusFlag{static_cast<Immediate8>(op.immediate), flag};
+				default: throw invalidOperand();
+			}
+		}
+
+		Readable decodeReadable(const MicroOp& op, uint8_t operand) {
+			const FlagName flag = static_cast<FlagName>(op.aux);
+			switch (operandKind(operand)) {
+				case OperandKind::REGISTER: return registerFromId(payload(operand));
+				case OperandKind::ADDRESS: return Address{op.immediate};
+				case OperandKind::IMMEDIATE8: return static_cast<Immediate8>(op.immediate);
+				case OperandKind::IMMEDIATE16: return Immediate16{op.immediate};
+				case OperandKind::INDIRECT: return static_cast<Indirect>(payload(operand));
+				case OperandKind::PARTIAL_ADDRESS: return decodePartialAddress(operand, op.immediate);
+				case OperandKind::REGISTER16_PLUS_VALUE: return Register16PlusValue{registerFromId(payload(operand)), op.immediate};
+				case OperandKind::REGISTER8_PLUS_FLAG: return Register8PlusFlag{register8FromId(payload(operand)), flag};
+				case OperandKind::INDIRECT_PLUS_FLAG: return IndirectPlusFlag{static_cast<Indirect>(payload(operand)), flag};
+				case OperandKind::IMMEDIATE8_PLUS_FLAG: return Immediate8PlusFlag{static_cast<Immediate8>(op.immediate), flag};
+				default: throw invalidOperand();
+			}
+		}
+
+		RegisterName16 decodeRegister16(uint8_t operand) {
+			if (operandKind(operand) != OperandKind::REGISTER) {
+				throw invalidOperand();
+			}
+			return register16FromId(payload(operand));
+		}
+
+	}
+
+	Event toEvent(const MicroOp& op) {
+		switch (op.kind) {
+			case MicroOpKind::DECREMENT8:
+				return DecrementEvent8{decodeWriteable(op, op.a)};
+			case MicroOpKind::INCREMENT8:
+				return IncrementEvent8{decodeWriteable(op, op.a)};
+			case MicroOpKind::COMPARE8:
+				return CompareEvent8{decodeReadable8(op, op.a)};
+			case MicroOpKind::XOR8:
+				return XorEvent8{decodeReadable8(op, op.a)};
+			case MicroOpKind::OR8:
+				return OrEvent8{decodeReadable8(op, op.a)};
+			case MicroOpKind::AND8:
+				return AndEvent8{decodeReadable8(op, op.a)};
+			case MicroOpKind::SUB8:
+				return SubEvent8{decodeReadable8(op, op.a)};
+			case MicroOpKind::ADD8:
+				return AddEvent8{decodeReadable8(op, op.a), decodeReadable8(op, op.b)};
+			case MicroOpKind::PUSH:
+				return PushEvent{decodeReadable(op, op.a)};
+			case MicroOpKind::POP:
+				return PopEvent{decodeWriteable16(op, op.a)};
+			case MicroOpKind::REGISTER_SHIFT:
+				if (operandKind(op.a) != OperandKind::REGISTER) {
+					throw invalidOperand();
+				}
+				return RegisterShiftEvent{registerFromId(payload(op.a)), static_cast<ShiftDirection>(op.aux & 0x01),
+					static_cast<ShiftType>((op.aux >> 1) & 0x03), static_cast<unsigned int>(op.aux >> 3)};
+			case MicroOpKind::LOAD8:
+				return LoadEvent8{decodeWriteable(op, op.a), decodeReadable8(op, op.b)};
+			case MicroOpKind::LOAD16:
+				return LoadEvent16{decodeWriteable16(op, op.a), decodeReadable(op, op.b), decodeFlagStateChange(op.flagEffects)};
+			case MicroOpKind::NOP:
+				return NopEvent{};
+			case MicroOpKind::ADD_HL:
+				return AddHLEvent{decodeRegister16(op.a)};
+			case MicroOpKind::ADD_SP:
+				if (operandKind(op.a) != OperandKind::IMMEDIATE8) {
+					throw invalidOperand();
+				}
+				return AddSPEvent{static_cast<Immediate8>(op.immediate)};
+			case MicroOpKind::INCREMENT16:
+				return IncrementEvent16{decodeRegister16(op.a)};
+			case MicroOpKind::DECREMENT16:
+				return DecrementEvent16{decodeRegister16(op.a)};
+		}
+
+		throw std::invalid_argument("MicroOp has an unknown kind");
+	}
+
+}
@@ -0,0 +1,35 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+
+#include "byte_cursor.hpp"
+
+TEST_CASE("byte cursor tests work", "[byte_cursor]") {
+	constexpr std::array<uint8_t, 5> bytes{ 0x13, 0x34, 0x12, 0xFF, 0x01 };
+	jagce::ByteCursor cursor{bytes.data(), bytes.size()};
+
+	SECTION("reads advance through the buffer") {
+		REQUIRE(cursor.size() == bytes.size());
+		REQUIRE(cursor.peek() == 0x13);
+		REQUIRE(cursor.get() == 0x13);
+		REQUIRE(cursor.position() == 1);
+		REQUIRE(cursor.size() == bytes.size() - 1);
+	}
+
+	SECTION("16-bit immediates are read little-endian") {
+		cursor.skip(1);
+		REQUIRE(cursor.getImmediate16() == 0x1234);
+		REQUIRE(cursor.getImmediate16() == 0x01FF);
+		REQUIRE(cursor.empty());
+	}
+
+	SECTION("the cursor does not copy the buffer") {
+		cursor.skip(3);
+		REQUIRE(cursor.data() == bytes.data() + 3);
+	}
+
+	SECTION("requiring more bytes than are available throws") {
+		CHECK_NOTHROW(cursor.require(bytes.size()));
+		CHECK_THROWS_AS(cursor.require(bytes.size() + 1), std::out_of_range);
+	}
+}
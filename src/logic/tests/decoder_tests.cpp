@@ -1,8 +1,13 @@
 #include <catch2/catch.hpp>
 
+#include <algorithm>
+#include <iterator>
 #include <map>
 
 #include "decoder.hpp"
+#include "micro_op.hpp"
+#include "opcode_info.hpp"
+#include "switch_decoder.hpp"
 
 namespace TestConstants {
 
@@ -120,8 +125,8 @@ TEST_CASE("decoder produces correct events", "[logic], [decoder]") {
 		uint8_t partialByte = GENERATE(0x00, 0xFF, 0xA2, 0x45);
 
 		std::map<uint8_t, jagce::Event> expectedEvents{
-			{ 0xF2, {jagce::LoadEvent8{ {jagce::RegisterNames::A}, {jagce::PartialAddress{{0xFF}, {jagce::RegisterNames::C}}} }} },
-			{ 0xE2, {jagce::LoadEvent8{ {jagce::PartialAddress{{0xFF}, {jagce::RegisterNames::C}}}, {jagce::RegisterNames::A} }} }
+			{ 0xF2, {jagce::LoadEvent8{ {jagce::RegisterNames::A}, {jagce::PartialAddress{{jagce::Immediate8{0xFF}}, {jagce::RegisterNames::C}}} }} },
+			{ 0xE2, {jagce::LoadEvent8{ {jagce::PartialAddress{{jagce::Immediate8{0xFF}}, {jagce::RegisterNames::C}}}, {jagce::RegisterNames::A} }} }
 		};
 
 		jagce::ByteStream bytes{};
@@ -272,3 +277,223 @@ TEST_CASE("decoder produces correct events", "[logic], [decoder]") {
 		CHECK(decoder.decodeEvent(bytes) == expectedEvents.at(opcode));
 	}
 }
+
+TEST_CASE("decoder tables agree with the reference switch decoder", "[logic], [decoder]") {
+	jagce::Decoder decoder{};
+	jagce::SwitchDecoder switchDecoder{};
+
+	int opcode = GENERATE(range(0x00, 0x100));
+	uint8_t secondByte = GENERATE(0x00, 0x5A, 0xFF);
+	uint8_t thirdByte = 0x44;
+
+	if (opcode != 0xCB) {
+		jagce::ByteStream tableBytes{};
+		jagce::ByteStream switchBytes{};
+		for (jagce::ByteStream* bytes : { &tableBytes, &switchBytes }) {
+			bytes->add(static_cast<uint8_t>(opcode));
+			bytes->add(secondByte);
+			bytes->add(thirdByte);
+			bytes->add(0x00);
+		}
+
+		jagce::Event event = decoder.decodeEvent(tableBytes);
+		CHECK(event == switchDecoder.decodeEvent(switchBytes));
+
+		// The switch decoder does not skip the operands of instructions without events
+		if (!std::holds_alternative<jagce::NopEvent>(event)) {
+			CHECK(tableBytes.size() == switchBytes.size());
+		}
+	}
+}
+
+TEST_CASE("decoder produces correct CB page events", "[logic], [decoder]") {
+	jagce::Decoder decoder{};
+
+	SECTION("register shifts and rotates") {
+		uint8_t opcode = GENERATE(0x00, 0x0B, 0x12, 0x1F, 0x24, 0x2D, 0x38);
+
+		std::map<uint8_t, jagce::Event> expectedEvents{
+			{ 0x00, {jagce::RegisterShiftEvent{ jagce::RegisterNames::B, jagce::ShiftDirection::LEFT, jagce::ShiftType::ROTATE, 1 }} },
+			{ 0x0B, {jagce::RegisterShiftEvent{ jagce::RegisterNames::E, jagce::ShiftDirection::RIGHT, jagce::ShiftType::ROTATE, 1 }} },
+			{ 0x12, {jagce::RegisterShiftEvent{ jagce::RegisterNames::D, jagce::ShiftDirection::LEFT, jagce::ShiftType::ROTATE_THROUGH_CARRY, 1 }} },
+			{ 0x1F, {jagce::RegisterShiftEvent{ jagce::RegisterNames::A, jagce::ShiftDirection::RIGHT, jagce::ShiftType::ROTATE_THROUGH_CARRY, 1 }} },
+			{ 0x24, {jagce::RegisterShiftEvent{ jagce::RegisterNames::H, jagce::ShiftDirection::LEFT, jagce::ShiftType::ARITHMETIC, 1 }} },
+			{ 0x2D, {jagce::RegisterShiftEvent{ jagce::RegisterNames::L, jagce::ShiftDirection::RIGHT, jagce::ShiftType::ARITHMETIC, 1 }} },
+			{ 0x38, {jagce::RegisterShiftEvent{ jagce::RegisterNames::B, jagce::ShiftDirection::RIGHT, jagce::ShiftType::LOGICAL, 1 }} }
+		};
+
+		jagce::ByteStream bytes{};
+		bytes.add(0xCB);
+		bytes.add(opcode);
+
+		CHECK(decoder.decodeEvent(bytes) == expectedEvents.at(opcode));
+		CHECK(bytes.empty());
+	}
+
+	SECTION("unsupported CB page opcodes decode to nops") {
+		uint8_t opcode = GENERATE(0x06, 0x37, 0x40, 0x8F, 0xFF);
+
+		jagce::ByteStream bytes{};
+		bytes.add(0xCB);
+		bytes.add(opcode);
+
+		CHECK(decoder.decodeEvent(bytes) == jagce::Event{jagce::NopEvent{}});
+		CHECK(bytes.empty());
+	}
+}
+
+TEST_CASE("decoding from a byte cursor matches decoding from a byte stream", "[logic], [decoder]") {
+	jagce::Decoder decoder{};
+
+	uint8_t opcode = static_cast<uint8_t>(GENERATE(range(0x00, 0x100)));
+	const std::array<uint8_t, 4> instruction{ opcode, 0x5A, 0x44, 0x00 };
+
+	jagce::ByteStream bytes{};
+	bytes.addBytes<4>(instruction);
+	jagce::ByteCursor cursor{instruction.data(), instruction.size()};
+
+	CHECK(decoder.decodeEvent(cursor) == decoder.decodeEvent(bytes));
+	CHECK(cursor.size() == bytes.size());
+}
+
+TEST_CASE("decoding a truncated instruction from a byte cursor throws", "[logic], [decoder]") {
+	jagce::Decoder decoder{};
+
+	SECTION("missing opcode") {
+		jagce::ByteCursor cursor{nullptr, 0};
+		CHECK_THROWS_AS(decoder.decodeEvent(cursor), std::out_of_range);
+	}
+
+	SECTION("missing operand bytes") {
+		const std::array<uint8_t, 2> instruction{ 0xFA, 0x00 };
+		jagce::ByteCursor cursor{instruction.data(), instruction.size()};
+		CHECK_THROWS_AS(decoder.decodeEvent(cursor), std::out_of_range);
+	}
+
+	SECTION("missing CB page opcode") {
+		const std::array<uint8_t, 1> instruction{ 0xCB };
+		jagce::ByteCursor cursor{instruction.data(), instruction.size()};
+		CHECK_THROWS_AS(decoder.decodeMicroOp(cursor), std::out_of_range);
+	}
+}
+
+TEST_CASE("decoding a byte cursor until empty decodes every instruction", "[logic], [decoder]") {
+	jagce::Decoder decoder{};
+
+	const std::array<uint8_t, 6> instructions{ 0x3E, 0x12, 0xEA, 0x00, 0xC0, 0x80 };
+	jagce::ByteCursor cursor{instructions.data(), instructions.size()};
+
+	std::vector<jagce::Event> events = decoder.decodeUntilEmpty(cursor);
+
+	REQUIRE(events.size() == 3);
+	CHECK(events.at(0) == jagce::Event{jagce::LoadEvent8{ {jagce::RegisterNames::A}, {jagce::Immediate8{0x12}} }});
+	CHECK(events.at(1) == jagce::Event{jagce::LoadEvent8{ {jagce::Address{0xC000}}, {jagce::RegisterNames::A} }});
+	CHECK(events.at(2) == jagce::Event{jagce::AddEvent8{ jagce::RegisterNames::A, jagce::RegisterNames::B }});
+}
+
+TEST_CASE("decoder consumes whole instructions", "[logic], [decoder]") {
+	jagce::Decoder decoder{};
+
+	uint8_t opcode = static_cast<uint8_t>(GENERATE(range(0x00, 0x100)));
+	const std::array<uint8_t, 4> instruction{ opcode, 0x00, 0x00, 0x00 };
+	jagce::ByteCursor cursor{instruction.data(), instruction.size()};
+
+	decoder.decodeEvent(cursor);
+
+	if (opcode != 0xDD && opcode != 0xED && opcode != 0xFD) {
+		CHECK(cursor.position() == jagce::instructionLength(opcode));
+	}
+}
+
+TEST_CASE("decoding a byte stream until empty decodes every instruction", "[logic], [decoder]") {
+	jagce::Decoder decoder{};
+
+	const std::array<uint8_t, 6> instructions{ 0x3E, 0x12, 0xEA, 0x00, 0xC0, 0x80 };
+	jagce::ByteStream bytes{};
+	bytes.addBytes<6>(instructions);
+
+	std::vector<jagce::Event> events = decoder.decodeUntilEmpty(bytes);
+
+	CHECK(events.size() == 3);
+	CHECK(bytes.empty());
+}
+
+TEST_CASE("decoder decodes batches into caller storage", "[logic], [decoder]") {
+	jagce::Decoder decoder{};
+
+	// LD A,0x12; LD (0xC000),A; ADD A,B; LD BC,0x1234
+	const std::array<uint8_t, 9> instructions{ 0x3E, 0x12, 0xEA, 0x00, 0xC0, 0x80, 0x01, 0x34, 0x12 };
+	jagce::ByteCursor cursor{instructions.data(), instructions.size()};
+	const std::vector<jagce::Event> expected = decoder.decodeUntilEmpty(cursor);
+	cursor = jagce::ByteCursor{instructions.data(), instructions.size()};
+
+	std::vector<jagce::Event> events(8, jagce::NopEvent{});
+
+	SECTION("until the input ends") {
+		const jagce::DecodeResult result = decoder.decodeInto(cursor, events.data(), events.size());
+		CHECK(result.instructions == 4);
+		CHECK(result.bytes == 9);
+		CHECK(cursor.empty());
+		CHECK(std::equal(expected.begin(), expected.end(), events.begin()));
+	}
+
+	SECTION("until the output is full") {
+		const jagce::DecodeResult result = decoder.decodeInto(cursor, events.data(), 2);
+		CHECK(result.instructions == 2);
+		CHECK(result.bytes == 5);
+		CHECK(cursor.position() == 5);
+	}
+
+	SECTION("until the instruction limit") {
+		const jagce::DecodeResult result = decoder.decodeInto(cursor, events.data(), events.size(), {9, 3});
+		CHECK(result.instructions == 3);
+		CHECK(result.bytes == 6);
+	}
+
+	SECTION("before an instruction crossing the byte limit") {
+		const jagce::DecodeResult result = decoder.decodeInto(cursor, events.data(), events.size(), {4});
+		CHECK(result.instructions == 1);
+		CHECK(result.bytes == 2);
+		CHECK(cursor.position() == 2);
+	}
+
+	SECTION("before an instruction cut off by the end of the input") {
+		jagce::ByteCursor truncated{instructions.data(), 8};
+		const jagce::DecodeResult result = decoder.decodeInto(truncated, events.data(), events.size());
+		CHECK(result.instructions == 3);
+		CHECK(result.bytes == 6);
+		CHECK(truncated.size() == 2);
+	}
+
+	SECTION("as micro ops") {
+		std::array<jagce::MicroOp, 8> ops{};
+		const jagce::DecodeResult result = decoder.decodeInto(cursor, ops.data(), ops.size());
+		REQUIRE(result.instructions == 4);
+		for (size_t i = 0; i < expected.size(); i++) {
+			CHECK(ops.at(i) == jagce::toMicroOp(expected.at(i)));
+		}
+	}
+
+	SECTION("into a vector with its own memory resource") {
+		// Running out of the buffer would use the null resource, which throws
+		std::array<std::byte, sizeof(jagce::Event) * 8> buffer{};
+		std::pmr::monotonic_buffer_resource arena{buffer.data(), buffer.size(), std::pmr::null_memory_resource()};
+		std::pmr::vector<jagce::Event> arenaEvents{&arena};
+		arenaEvents.reserve(8);
+
+		const jagce::DecodeResult result = decoder.decodeInto(cursor, arenaEvents, {});
+		CHECK(result.instructions == 4);
+		CHECK(std::equal(expected.begin(), expected.end(), arenaEvents.begin(), arenaEvents.end()));
+	}
+
+	SECTION("lazily") {
+		std::vector<jagce::Event> lazyEvents{};
+		for (const jagce::Event& event : decoder.decodeRange(cursor)) {
+			lazyEvents.push_back(event);
+		}
+		CHECK(lazyEvents == expected);
+
+		const jagce::DecodeRange limited = decoder.decodeRange(cursor, {5});
+		CHECK(std::distance(limited.begin(), limited.end()) == 2);
+	}
+}
@@ -0,0 +1,79 @@
+#include <catch2/catch.hpp>
+
+#include "decoder.hpp"
+#include "micro_op.hpp"
+
+namespace {
+
+	jagce::ByteStream makeInstruction(uint8_t firstByte, uint8_t secondByte, uint8_t thirdByte) {
+		jagce::ByteStream bytes{};
+		bytes.add(firstByte);
+		bytes.add(secondByte);
+		bytes.add(thirdByte);
+		bytes.add(0x00);
+		return bytes;
+	}
+
+}
+
+TEST_CASE("micro ops round trip decoded events", "[logic], [micro_op]") {
+	jagce::Decoder decoder{};
+
+	uint8_t opcode = static_cast<uint8_t>(GENERATE(range(0x00, 0x100)));
+	uint8_t secondByte = GENERATE(0x00, 0x5A, 0xFF);
+	uint8_t thirdByte = 0x44;
+
+	SECTION("event to micro op and back is lossless") {
+		jagce::ByteStream bytes = makeInstruction(opcode, secondByte, thirdByte);
+		jagce::Event event = decoder.decodeEvent(bytes);
+
+		CHECK(jagce::toEvent(jagce::toMicroOp(event)) == event);
+	}
+
+	SECTION("decoding straight to micro ops matches converting decoded events") {
+		jagce::ByteStream eventBytes = makeInstruction(opcode, secondByte, thirdByte);
+		jagce::ByteStream microOpBytes = makeInstruction(opcode, secondByte, thirdByte);
+
+		CHECK(decoder.decodeMicroOp(microOpBytes) == jagce::toMicroOp(decoder.decodeEvent(eventBytes)));
+		CHECK(microOpBytes.size() == eventBytes.size());
+	}
+
+	SECTION("CB page events round trip") {
+		jagce::ByteStream eventBytes = makeInstruction(0xCB, opcode, thirdByte);
+		jagce::ByteStream microOpBytes = makeInstruction(0xCB, opcode, thirdByte);
+		jagce::Event event = decoder.decodeEvent(eventBytes);
+
+		CHECK(decoder.decodeMicroOp(microOpBytes) == jagce::toMicroOp(event));
+		CHECK(jagce::toEvent(jagce::toMicroOp(event)) == event);
+	}
+}
+
+TEST_CASE("micro ops encode operands and flags", "[logic], [micro_op]") {
+	SECTION("flag effects come from the event") {
+		jagce::MicroOp op = jagce::toMicroOp(jagce::AddEvent8{jagce::RegisterNames::A, jagce::RegisterNames::B});
+
+		CHECK(op.kind == jagce::MicroOpKind::ADD8);
+		CHECK(op.operandKindA() == jagce::OperandKind::REGISTER);
+		CHECK(op.operandKindB() == jagce::OperandKind::REGISTER);
+		CHECK(op.flagEffect(jagce::FlagName::Z) == jagce::FlagState::DEFER);
+		CHECK(op.flagEffect(jagce::FlagName::N) == jagce::FlagState::RESET);
+	}
+
+	SECTION("register partial addresses round trip") {
+		jagce::Event event{jagce::LoadEvent8{ {jagce::PartialAddress{{jagce::RegisterNames::B}, {jagce::RegisterNames::C}}}, {jagce::RegisterNames::A} }};
+
+		CHECK(jagce::toEvent(jagce::toMicroOp(event)) == event);
+	}
+
+	SECTION("events with two operand values cannot be encoded") {
+		jagce::Event event{jagce::LoadEvent8{ {jagce::Address{0xC000}}, {jagce::Immediate8{0x12}} }};
+
+		CHECK_THROWS_AS(jagce::toMicroOp(event), std::invalid_argument);
+	}
+
+	SECTION("addresses outside the 16-bit address space cannot be encoded") {
+		jagce::Event event{jagce::LoadEvent8{ {jagce::Address{0x10000}}, {jagce::RegisterNames::A} }};
+
+		CHECK_THROWS_AS(jagce::toMicroOp(event), std::invalid_argument);
+	}
+}
@@ -0,0 +1,141 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "static_ram.hpp"
+
+namespace {
+
+	constexpr size_t RAM_SIZE = 0x10000;
+
+	// Addresses in the proportions a CPU touches them: mostly a small working set of
+	// stack and variables, with some scattered accesses
+	std::vector<uint16_t> makeAddresses() {
+		std::mt19937 rng{0xADD5};
+		std::uniform_int_distribution<int> hot{0xC000, 0xC0FF};
+		std::uniform_int_distribution<int> anywhere{0x0000, 0xFFFF};
+		std::uniform_int_distribution<int> percent{0, 99};
+
+		std::vector<uint16_t> addresses(4096);
+		for (uint16_t& address : addresses) {
+			address = static_cast<uint16_t>(percent(rng) < 80 ? hot(rng) : anywhere(rng));
+		}
+		return addresses;
+	}
+
+	struct Tile {
+		uint8_t rows[16];
+	};
+
+}
+
+// Through the virtual interface, as code holding a RandomAccessMemory& does
+static void BM_StaticRAMReadByte(benchmark::State& state) {
+	const auto ram = std::make_unique<jagce::StaticRAM<RAM_SIZE>>();
+	const jagce::RandomAccessMemory& memory = *ram;
+	const std::vector<uint16_t> addresses = makeAddresses();
+
+	for (auto _ : state) {
+		uint8_t sum = 0;
+		for (uint16_t address : addresses) {
+			sum += memory.readByte(address);
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * addresses.size());
+}
+BENCHMARK(BM_StaticRAMReadByte);
+
+// Through the final class, where the accessors inline
+static void BM_StaticRAMReadByteDirect(benchmark::State& state) {
+	const auto ram = std::make_unique<jagce::StaticRAM<RAM_SIZE>>();
+	const std::vector<uint16_t> addresses = makeAddresses();
+
+	for (auto _ : state) {
+		uint8_t sum = 0;
+		for (uint16_t address : addresses) {
+			sum += ram->readByte(address);
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * addresses.size());
+}
+BENCHMARK(BM_StaticRAMReadByteDirect);
+
+static void BM_StaticRAMWriteByte(benchmark::State& state) {
+	const auto ram = std::make_unique<jagce::StaticRAM<RAM_SIZE>>();
+	jagce::RandomAccessMemory& memory = *ram;
+	const std::vector<uint16_t> addresses = makeAddresses();
+
+	for (auto _ : state) {
+		for (uint16_t address : addresses) {
+			memory.writeByte(address, static_cast<uint8_t>(address));
+		}
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * addresses.size());
+}
+BENCHMARK(BM_StaticRAMWriteByte);
+
+// Block copies from DMA-sized transfers up to whole banks
+static void BM_StaticRAMWriteBytes(benchmark::State& state) {
+	const auto ram = std::make_unique<jagce::StaticRAM<RAM_SIZE>>();
+	jagce::RandomAccessMemory& memory = *ram;
+	const std::vector<uint8_t> bytes(static_cast<size_t>(state.range(0)), 0x5A);
+
+	for (auto _ : state) {
+		memory.writeBytes(0x8000, bytes.data(), bytes.size());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StaticRAMWriteBytes)->RangeMultiplier(4)->Range(16, 0x4000);
+
+static void BM_StaticRAMWriteBytesDirtyPages(benchmark::State& state) {
+	const auto ram = std::make_unique<jagce::StaticRAM<RAM_SIZE, 256>>();
+	jagce::RandomAccessMemory& memory = *ram;
+	const std::vector<uint8_t> bytes(static_cast<size_t>(state.range(0)), 0x5A);
+
+	for (auto _ : state) {
+		memory.writeBytes(0x8000, bytes.data(), bytes.size());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StaticRAMWriteBytesDirtyPages)->RangeMultiplier(4)->Range(16, 0x4000);
+
+// 16-bit loads as the stack and pointer tables are read
+static void BM_StaticRAMReadBytesAsWord(benchmark::State& state) {
+	const auto ram = std::make_unique<jagce::StaticRAM<RAM_SIZE>>();
+	const jagce::RandomAccessMemory& memory = *ram;
+	const std::vector<uint16_t> addresses = makeAddresses();
+
+	for (auto _ : state) {
+		uint16_t sum = 0;
+		for (uint16_t address : addresses) {
+			sum += *memory.readBytesAsType<uint16_t>(address & 0xFFFE);
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * addresses.size());
+}
+BENCHMARK(BM_StaticRAMReadBytesAsWord);
+
+// Whole tiles of video memory, as a renderer reads them
+static void BM_StaticRAMReadBytesAsTile(benchmark::State& state) {
+	const auto ram = std::make_unique<jagce::StaticRAM<RAM_SIZE>>();
+	const jagce::RandomAccessMemory& memory = *ram;
+
+	for (auto _ : state) {
+		uint8_t sum = 0;
+		for (size_t address = 0x8000; address < 0x9800; address += sizeof(Tile)) {
+			const Tile* tile = memory.readBytesAsType<Tile>(address);
+			sum += tile->rows[0] ^ tile->rows[15];
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * (0x1800 / sizeof(Tile)));
+}
+BENCHMARK(BM_StaticRAMReadBytesAsTile);
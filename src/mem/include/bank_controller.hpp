@@ -0,0 +1,110 @@
+#ifndef JAGCE_BANK_CONTROLLER
+#define JAGCE_BANK_CONTROLLER
+
+#include <array>
+#include <vector>
+
+#include "memory_bus.hpp"
+#include "watched_memory.hpp"
+
+namespace jagce {
+
+	enum class MBCType {
+		NONE,
+		MBC1,
+		MBC3,
+		MBC5
+	};
+
+	constexpr size_t ROM_BANK_SIZE = 0x4000;
+	constexpr size_t RAM_BANK_SIZE = 0x2000;
+
+	// Memory bank controller named by the cartridge type byte at 0x147
+	constexpr MBCType mbcTypeFromHeader(uint8_t cartridgeType) {
+		switch (cartridgeType) {
+			case 0x01: case 0x02: case 0x03:
+				return MBCType::MBC1;
+			case 0x0F: case 0x10: case 0x11: case 0x12: case 0x13:
+				return MBCType::MBC3;
+			case 0x19: case 0x1A: case 0x1B: case 0x1C: case 0x1D: case 0x1E:
+				return MBCType::MBC5;
+			default:
+				return MBCType::NONE;
+		}
+	}
+
+	// Cartridge RAM size in bytes named by the RAM size byte at 0x149
+	constexpr size_t ramSizeFromHeader(uint8_t ramSize) {
+		switch (ramSize) {
+			case 0x02: return 0x2000;
+			case 0x03: return 0x8000;
+			case 0x04: return 0x20000;
+			case 0x05: return 0x10000;
+			default: return 0;
+		}
+	}
+
+	/**
+	 * Maps a cartridge into the ROM (0x0000-0x7FFF) and external RAM (0xA000-0xBFFF)
+	 * regions of a bus and emulates the bank switching registers of its memory bank
+	 * controller. Switching banks repoints the bus pages into the ROM or the cartridge
+	 * RAM, neither is ever copied. The ROM must stay alive and at the same address for
+	 * as long as the controller.
+	 *
+	 * A bank switch changes what the bus reads without writing it, so the observer, when
+	 * set, is told of every range that was remapped as though it had been written. Give
+	 * it the BlockCache decoding from the bus, or cached blocks run the previous bank.
+	 *
+	 * The MBC3 clock registers can be selected, read and written but don't count time.
+	 */
+	class BankController : public MemoryHandler {
+	public:
+		BankController(MemoryBus& bus, const RandomAccessMemory& rom, MBCType type, size_t ramSize);
+		~BankController();
+		BankController(const BankController&) = delete;
+		BankController& operator=(const BankController&) = delete;
+
+		uint8_t read(uint16_t address) override;
+		void write(uint16_t address, uint8_t value) override;
+
+		size_t getROMBank() const { return romBank; }
+		size_t getRAMBank() const { return ramBank; }
+		bool isRAMEnabled() const { return ramEnabled; }
+		std::vector<uint8_t>& getRAM() { return ram; }
+
+		// The observer to notify of remapped ranges, or nullptr for none
+		void setObserver(MemoryWriteObserver* observer) { this->observer = observer; }
+
+	private:
+		void writeRegister(uint16_t address, uint8_t value);
+		void remap();
+		uint8_t* clockRegister();
+		void notifyIfRemapped(size_t range, size_t address, size_t size, uint8_t const * pointer);
+
+		MemoryBus& bus;
+		uint8_t const * rom;
+		size_t romBanks;
+		MBCType type;
+		std::vector<uint8_t> ram;
+
+		// Bank register values as written, combined by remap
+		size_t romBankLow;
+		size_t romBankHigh;
+		size_t ramBankSelect;
+		bool ramEnabled;
+		bool bankingMode;
+
+		// Banks currently mapped at 0x4000 and 0xA000
+		size_t romBank;
+		size_t ramBank;
+
+		std::array<uint8_t, 5> clock;
+
+		MemoryWriteObserver* observer;
+		// Host memory mapped at 0x0000, 0x4000 and 0xA000, to tell which ranges a remap changed
+		std::array<uint8_t const *, 3> mapped;
+	};
+
+}
+
+#endif
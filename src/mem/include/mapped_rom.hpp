@@ -0,0 +1,91 @@
+#ifndef JAGCE_MAPPED_ROM
+#define JAGCE_MAPPED_ROM
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#ifdef MEM_ACCESS_ASSERTIONS
+#include <cassert>
+#endif
+
+#include "ram.hpp"
+
+namespace jagce {
+
+	/**
+	 * A file mapped read-only into memory. Opening a file that is already mapped returns
+	 * the existing mapping, so every instance loading the same ROM reads the same pages.
+	 * The mapping is released when the last reference to it goes.
+	 */
+	class MappedFile {
+	public:
+		static std::shared_ptr<const MappedFile> open(const std::string& path);
+
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		uint8_t const * data() const { return bytes; }
+		size_t size() const { return length; }
+
+	private:
+		MappedFile(uint8_t const * bytes, size_t length) : bytes{bytes}, length{length} {};
+
+		uint8_t const * bytes;
+		size_t length;
+	};
+
+	// Called with writes to read-only memory in place of storing them
+	using ROMWriteHandler = std::function<void(size_t index, uint8_t const * bytes, size_t num)>;
+
+	// Drops the write, as the cartridge bus does when no mapper is listening
+	void ignoreROMWrite(size_t index, uint8_t const * bytes, size_t num);
+	// Throws std::logic_error
+	void faultROMWrite(size_t index, uint8_t const * bytes, size_t num);
+
+	/**
+	 * Read-only memory backed by a MappedFile. Reads return pointers straight into the
+	 * mapping and writes are passed to the write handler.
+	 */
+	class MappedROM final : public RandomAccessMemory {
+	public:
+		MappedROM(std::shared_ptr<const MappedFile> file, ROMWriteHandler onWrite = ignoreROMWrite);
+		MappedROM(const std::string& path, ROMWriteHandler onWrite = ignoreROMWrite);
+
+		size_t size() const override { return file->size(); }
+
+		uint8_t readByte(size_t index) const override {
+			#ifdef MEM_ACCESS_ASSERTIONS
+			assert(index < file->size());
+			#endif
+			return bytes[index];
+		}
+
+		uint8_t const * readBytes(size_t index, size_t num) const override {
+			#ifdef MEM_ACCESS_ASSERTIONS
+			assert(index + num <= file->size());
+			#endif
+			return bytes + index;
+		}
+
+		void writeByte(size_t index, uint8_t byte) override {
+			onWrite(index, &byte, 1);
+		}
+
+		void writeBytes(size_t index, uint8_t const * bytes, size_t num) override {
+			onWrite(index, bytes, num);
+		}
+
+		void setWriteHandler(ROMWriteHandler onWrite);
+		const std::shared_ptr<const MappedFile>& getFile() const { return file; }
+
+	private:
+		std::shared_ptr<const MappedFile> file;
+		uint8_t const * bytes;
+		ROMWriteHandler onWrite;
+	};
+
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef JAGCE_MEMORY_BUS
+#define JAGCE_MEMORY_BUS
+
+#include <array>
+#include <vector>
+
+#include "ram.hpp"
+
+namespace jagce {
+
+	// Reads and writes of bus pages that aren't mapped to host memory
+	class MemoryHandler {
+	public:
+		virtual ~MemoryHandler() = default;
+
+		virtual uint8_t read(uint16_t address) = 0;
+		virtual void write(uint16_t address, uint8_t value) = 0;
+	};
+
+	/**
+	 * The 16-bit address space as a table of host pointers, one per 256 byte page, kept
+	 * separately for reads and writes. Accesses to a page with a pointer are a table lookup
+	 * and a load or store. Accesses to a page without one go to the page's handler, or
+	 * read 0xFF and are dropped when it has none. Remapping a page only swaps pointers,
+	 * so bank switches never copy.
+	 *
+	 * readBytes returns a pointer into host memory when the range is contiguous there,
+	 * otherwise a copy that is valid until the next call.
+	 */
+	class MemoryBus final : public RandomAccessMemory {
+	public:
+		constexpr static size_t PAGE_BITS = 8;
+		constexpr static size_t PAGE_SIZE = 1 << PAGE_BITS;
+		constexpr static size_t PAGE_COUNT = 0x10000 / PAGE_SIZE;
+
+		MemoryBus();
+
+		uint8_t read(uint16_t address) const {
+			uint8_t const * page = readPages[address >> PAGE_BITS];
+			if (page != nullptr) {
+				return page[address & (PAGE_SIZE - 1)];
+			}
+			return readUnmapped(address);
+		}
+
+		void write(uint16_t address, uint8_t value) {
+			uint8_t* page = writePages[address >> PAGE_BITS];
+			if (page != nullptr) {
+				page[address & (PAGE_SIZE - 1)] = value;
+			} else {
+				writeUnmapped(address, value);
+			}
+		}
+
+		size_t size() const override { return 0x10000; }
+		uint8_t readByte(size_t index) const override { return read(static_cast<uint16_t>(index)); }
+		void writeByte(size_t index, uint8_t byte) override { write(static_cast<uint16_t>(index), byte); }
+		uint8_t const * readBytes(size_t index, size_t num) const override;
+		void writeBytes(size_t index, uint8_t const * bytes, size_t num) override;
+
+		// Address and size must be multiples of PAGE_SIZE. Mapping nullptr sends the pages
+		// to their handler.
+		void mapRead(size_t address, size_t size, uint8_t const * bytes);
+		void mapWrite(size_t address, size_t size, uint8_t* bytes);
+		void map(size_t address, size_t size, uint8_t* bytes);
+		void mapHandler(size_t address, size_t size, MemoryHandler* handler);
+		void unmap(size_t address, size_t size);
+
+	private:
+		uint8_t readUnmapped(uint16_t address) const;
+		void writeUnmapped(uint16_t address, uint8_t value);
+		static size_t firstPage(size_t address, size_t size);
+
+		std::array<uint8_t const *, PAGE_COUNT> readPages;
+		std::array<uint8_t*, PAGE_COUNT> writePages;
+		std::array<MemoryHandler*, PAGE_COUNT> handlers;
+		mutable std::vector<uint8_t> scratch;
+	};
+
+}
+
+#endif
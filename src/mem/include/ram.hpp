@@ -1,8 +1,11 @@
 #ifndef JAGCE_RAM
 #define JAGCE_RAM
 
+#include <cstddef>
+#include <cstdint>
 #include <type_traits>
 #include <memory>
+#include <utility>
 
 namespace jagce {
 
@@ -31,6 +34,20 @@ namespace jagce {
 		return reinterpret_cast<T const *>(readBytes(index, sizeof(T)));
 	}
 
+	// Whether M has the byte accessors of RandomAccessMemory. Templates taking a memory type
+	// require this instead of the virtual interface, so final implementations bind statically.
+	template <typename M, typename = void>
+	struct IsByteMemory : std::false_type {};
+
+	template <typename M>
+	struct IsByteMemory<M, std::void_t<
+		decltype(std::declval<const M&>().size()),
+		decltype(std::declval<const M&>().readByte(size_t{})),
+		decltype(std::declval<M&>().writeByte(size_t{}, uint8_t{}))>> : std::true_type {};
+
+	template <typename M>
+	constexpr bool isByteMemory = IsByteMemory<M>::value;
+
 	template <typename T>
 	void RandomAccessMemory::writeBytesAsType(size_t index, const T& var) {
 		constexpr size_t T_SIZE = sizeof(T);
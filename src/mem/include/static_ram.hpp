@@ -1,15 +1,46 @@
 #ifndef JAGCE_STATIC_RAM
 #define JAGCE_STATIC_RAM
 
+#include <algorithm>
+#include <bitset>
 #include <cstring>
 
+#ifdef MEM_ACCESS_ASSERTIONS
+#include <cassert>
+#endif
+
 #include "ram.hpp"
 
 namespace jagce {
-	
-	template <size_t N>
-	class StaticRAM : public RandomAccessMemory {
+
+	namespace detail {
+
+		template <size_t PAGE_COUNT>
+		struct DirtyPageBitmap {
+			std::bitset<PAGE_COUNT> dirty{};
+		};
+
+		// An empty base, so RAM without dirty pages is no larger than its array
+		template <>
+		struct DirtyPageBitmap<0> {};
+
+	}
+
+	/**
+	 * RAM held in an inline array. With a DIRTY_PAGE_SIZE the writes also mark the pages
+	 * they touch in a dirty bitmap, so a checkpoint can copy just the pages that changed
+	 * since the bitmap was last cleared. Without one there is no bitmap and writes cost
+	 * nothing extra.
+	 */
+	template <size_t N, size_t DIRTY_PAGE_SIZE = 0>
+	class StaticRAM final : public RandomAccessMemory,
+			private detail::DirtyPageBitmap<DIRTY_PAGE_SIZE == 0 ? 0 : (N + DIRTY_PAGE_SIZE - 1) / DIRTY_PAGE_SIZE> {
+		static_assert(DIRTY_PAGE_SIZE == 0 || (DIRTY_PAGE_SIZE & (DIRTY_PAGE_SIZE - 1)) == 0,
+				"Dirty page size must be a power of two");
+
 	public:
+		constexpr static size_t PAGE_COUNT = DIRTY_PAGE_SIZE == 0 ? 0 : (N + DIRTY_PAGE_SIZE - 1) / DIRTY_PAGE_SIZE;
+
 		StaticRAM() : arr{} {};
 		size_t size() const override { return sizeof(arr); }
 
@@ -25,6 +56,9 @@ namespace jagce {
 			assert(index >= 0 && index < N);	
 			#endif
 			arr[index] = byte;
+			if constexpr (DIRTY_PAGE_SIZE != 0) {
+				this->dirty.set(index / DIRTY_PAGE_SIZE);
+			}
 		}
 
 		uint8_t const * readBytes(size_t index, size_t num) const override {
@@ -43,6 +77,28 @@ namespace jagce {
 			#endif
 
 			memmove(arr + index, bytes, num);
+			if constexpr (DIRTY_PAGE_SIZE != 0) {
+				for (size_t page = index / DIRTY_PAGE_SIZE; num > 0 && page <= (index + num - 1) / DIRTY_PAGE_SIZE; page++) {
+					this->dirty.set(page);
+				}
+			}
+		}
+
+		bool isPageDirty(size_t page) const { return this->dirty.test(page); }
+		size_t dirtyPageCount() const { return this->dirty.count(); }
+		const std::bitset<PAGE_COUNT>& dirtyPages() const { return this->dirty; }
+		void clearDirtyPages() { this->dirty.reset(); }
+		void markAllPagesDirty() { this->dirty.set(); }
+
+		// Calls f(index, bytes, num) with the contents of each dirty page, in address order
+		template <typename F>
+		void forEachDirtyPage(F f) const {
+			for (size_t page = 0; page < PAGE_COUNT; page++) {
+				if (this->dirty.test(page)) {
+					const size_t index = page * DIRTY_PAGE_SIZE;
+					f(index, arr + index, std::min(DIRTY_PAGE_SIZE, N - index));
+				}
+			}
 		}
 
 	private:
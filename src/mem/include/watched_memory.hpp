@@ -0,0 +1,53 @@
+#ifndef JAGCE_WATCHED_MEMORY
+#define JAGCE_WATCHED_MEMORY
+
+#include <vector>
+
+#include "ram.hpp"
+
+namespace jagce {
+
+	class MemoryWriteObserver {
+	public:
+		virtual ~MemoryWriteObserver() = default;
+
+		virtual void memoryWritten(size_t index, size_t num) = 0;
+	};
+
+	/**
+	 * Forwards all accesses to another RandomAccessMemory and notifies an observer of
+	 * writes that touch watched pages. Writes to unwatched pages only pay for a bitmap test.
+	 */
+	class WatchedMemory final : public RandomAccessMemory {
+	public:
+		constexpr static size_t PAGE_SIZE = 256;
+
+		WatchedMemory(RandomAccessMemory& memory);
+
+		size_t size() const override { return memory.size(); }
+		uint8_t readByte(size_t index) const override { return memory.readByte(index); }
+		uint8_t const * readBytes(size_t index, size_t num) const override { return memory.readBytes(index, num); }
+
+		void writeByte(size_t index, uint8_t byte) override {
+			memory.writeByte(index, byte);
+			if (watched[index / PAGE_SIZE] && observer != nullptr) {
+				observer->memoryWritten(index, 1);
+			}
+		}
+
+		void writeBytes(size_t index, uint8_t const * bytes, size_t num) override;
+
+		void setObserver(MemoryWriteObserver* observer);
+		void watchPage(size_t page);
+		void unwatchPage(size_t page);
+		bool isPageWatched(size_t page) const;
+
+	private:
+		RandomAccessMemory& memory;
+		MemoryWriteObserver* observer;
+		std::vector<bool> watched;
+	};
+
+}
+
+#endif
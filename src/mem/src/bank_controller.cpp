@@ -0,0 +1,157 @@
+#include "bank_controller.hpp"
+
+#include <stdexcept>
+
+namespace jagce {
+
+	namespace {
+
+		constexpr size_t ROM_ADDRESS = 0x0000;
+		constexpr size_t SWITCHABLE_ROM_ADDRESS = 0x4000;
+		constexpr size_t RAM_ADDRESS = 0xA000;
+
+		// MBC3 selects the clock registers through the RAM bank register
+		constexpr size_t FIRST_CLOCK_REGISTER = 0x08;
+
+	}
+
+	BankController::BankController(MemoryBus& bus, const RandomAccessMemory& rom, MBCType type, size_t ramSize)
+		: bus{bus}, rom{nullptr}, romBanks{rom.size() / ROM_BANK_SIZE}, type{type}, ram(ramSize),
+		romBankLow{1}, romBankHigh{0}, ramBankSelect{0}, ramEnabled{false}, bankingMode{false},
+		romBank{1}, ramBank{0}, clock{}, observer{nullptr}, mapped{} {
+		if (rom.size() % ROM_BANK_SIZE != 0 || romBanks < 2) {
+			throw std::invalid_argument("Cartridge ROM must be a whole number of banks, and at least two");
+		}
+		if (ramSize % RAM_BANK_SIZE != 0) {
+			throw std::invalid_argument("Cartridge RAM must be a whole number of banks");
+		}
+
+		this->rom = rom.readBytes(0, rom.size());
+		bus.mapHandler(ROM_ADDRESS, 2 * ROM_BANK_SIZE, this);
+		bus.mapHandler(RAM_ADDRESS, RAM_BANK_SIZE, this);
+		remap();
+	}
+
+	BankController::~BankController() {
+		bus.unmap(ROM_ADDRESS, 2 * ROM_BANK_SIZE);
+		bus.unmap(RAM_ADDRESS, RAM_BANK_SIZE);
+	}
+
+	uint8_t BankController::read(uint16_t address) {
+		// ROM is always mapped, so only disabled RAM and the clock get here
+		uint8_t* r = clockRegister();
+		return ramEnabled && r != nullptr ? *r : 0xFF;
+	}
+
+	void BankController::write(uint16_t address, uint8_t value) {
+		if (address < RAM_ADDRESS) {
+			writeRegister(address, value);
+			return;
+		}
+
+		uint8_t* r = clockRegister();
+		if (ramEnabled && r != nullptr) {
+			*r = value;
+		}
+	}
+
+	void BankController::writeRegister(uint16_t address, uint8_t value) {
+		if (type == MBCType::NONE) {
+			return;
+		}
+
+		if (address < 0x2000) {
+			ramEnabled = (value & 0x0F) == 0x0A;
+		} else if (address < 0x4000) {
+			switch (type) {
+				case MBCType::MBC1:
+					romBankLow = value & 0x1F;
+					romBankLow = romBankLow == 0 ? 1 : romBankLow;
+					break;
+				case MBCType::MBC3:
+					romBankLow = value & 0x7F;
+					romBankLow = romBankLow == 0 ? 1 : romBankLow;
+					break;
+				default:
+					if (address < 0x3000) {
+						romBankLow = value;
+					} else {
+						romBankHigh = value & 0x01;
+					}
+			}
+		} else if (address < 0x6000) {
+			switch (type) {
+				case MBCType::MBC1: romBankHigh = value & 0x03; break;
+				case MBCType::MBC3: ramBankSelect = value; break;
+				default: ramBankSelect = value & 0x0F;
+			}
+		} else if (type == MBCType::MBC1) {
+			bankingMode = (value & 0x01) != 0;
+		}
+
+		remap();
+	}
+
+	void BankController::remap() {
+		size_t firstBank = 0;
+		switch (type) {
+			case MBCType::NONE:
+				romBank = 1;
+				ramBank = 0;
+				break;
+			case MBCType::MBC1:
+				romBank = (romBankHigh << 5) | romBankLow;
+				ramBank = bankingMode ? romBankHigh : 0;
+				firstBank = bankingMode ? romBankHigh << 5 : 0;
+				break;
+			case MBCType::MBC3:
+				romBank = romBankLow;
+				ramBank = ramBankSelect;
+				break;
+			case MBCType::MBC5:
+				romBank = (romBankHigh << 8) | romBankLow;
+				ramBank = ramBankSelect;
+				break;
+		}
+
+		// Bank numbers wrap at the size of the cartridge, as only the connected lines decode
+		romBank %= romBanks;
+		firstBank %= romBanks;
+		uint8_t const * const first = rom + firstBank * ROM_BANK_SIZE;
+		uint8_t const * const switchable = rom + romBank * ROM_BANK_SIZE;
+		bus.mapRead(ROM_ADDRESS, ROM_BANK_SIZE, first);
+		bus.mapRead(SWITCHABLE_ROM_ADDRESS, ROM_BANK_SIZE, switchable);
+
+		const bool ramMapped = (ramEnabled || type == MBCType::NONE) && !ram.empty()
+			&& (type != MBCType::MBC3 || ramBank < FIRST_CLOCK_REGISTER);
+		uint8_t* external = nullptr;
+		if (ramMapped) {
+			ramBank %= ram.size() / RAM_BANK_SIZE;
+			external = ram.data() + ramBank * RAM_BANK_SIZE;
+		}
+		bus.map(RAM_ADDRESS, RAM_BANK_SIZE, external);
+
+		notifyIfRemapped(0, ROM_ADDRESS, ROM_BANK_SIZE, first);
+		notifyIfRemapped(1, SWITCHABLE_ROM_ADDRESS, ROM_BANK_SIZE, switchable);
+		notifyIfRemapped(2, RAM_ADDRESS, RAM_BANK_SIZE, external);
+	}
+
+	void BankController::notifyIfRemapped(size_t range, size_t address, size_t size, uint8_t const * pointer) {
+		if (pointer == mapped[range]) {
+			return;
+		}
+		mapped[range] = pointer;
+		if (observer != nullptr) {
+			observer->memoryWritten(address, size);
+		}
+	}
+
+	uint8_t* BankController::clockRegister() {
+		if (type != MBCType::MBC3 || ramBankSelect < FIRST_CLOCK_REGISTER
+				|| ramBankSelect >= FIRST_CLOCK_REGISTER + clock.size()) {
+			return nullptr;
+		}
+		return &clock[ramBankSelect - FIRST_CLOCK_REGISTER];
+	}
+
+}
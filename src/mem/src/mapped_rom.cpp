@@ -0,0 +1,103 @@
+#include "mapped_rom.hpp"
+
+#include <cerrno>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace jagce {
+
+	namespace {
+
+		// Mapped files by device and inode, so different paths to one file share a mapping
+		using FileId = std::pair<dev_t, ino_t>;
+
+		std::mutex mappedFilesMutex;
+		std::map<FileId, std::weak_ptr<const MappedFile>> mappedFiles;
+
+		std::system_error lastError(const std::string& what) {
+			return std::system_error(errno, std::generic_category(), what);
+		}
+
+		// Closes the descriptor when it leaves scope, the mapping outlives it
+		struct FileDescriptor {
+			int fd;
+			~FileDescriptor() { close(fd); }
+		};
+
+	}
+
+	std::shared_ptr<const MappedFile> MappedFile::open(const std::string& path) {
+		const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			throw lastError("Could not open " + path);
+		}
+		const FileDescriptor file{fd};
+
+		struct stat status{};
+		if (fstat(fd, &status) != 0) {
+			throw lastError("Could not stat " + path);
+		}
+
+		std::lock_guard<std::mutex> lock{mappedFilesMutex};
+		const FileId id{status.st_dev, status.st_ino};
+		auto it = mappedFiles.find(id);
+		if (it != mappedFiles.end()) {
+			if (std::shared_ptr<const MappedFile> mapped = it->second.lock()) {
+				return mapped;
+			}
+		}
+
+		const size_t length = static_cast<size_t>(status.st_size);
+		uint8_t const * bytes = nullptr;
+		if (length > 0) {
+			void* mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+			if (mapping == MAP_FAILED) {
+				throw lastError("Could not map " + path);
+			}
+			bytes = static_cast<uint8_t const *>(mapping);
+		}
+
+		std::shared_ptr<const MappedFile> mapped{new MappedFile{bytes, length}};
+		mappedFiles[id] = mapped;
+		return mapped;
+	}
+
+	MappedFile::~MappedFile() {
+		if (bytes != nullptr) {
+			munmap(const_cast<uint8_t*>(bytes), length);
+		}
+	}
+
+	void ignoreROMWrite(size_t, uint8_t const *, size_t) {
+	}
+
+	void faultROMWrite(size_t index, uint8_t const *, size_t num) {
+		throw std::logic_error("Attempted write of " + std::to_string(num) + " bytes to read-only memory at "
+				+ std::to_string(index));
+	}
+
+	MappedROM::MappedROM(std::shared_ptr<const MappedFile> file, ROMWriteHandler onWrite)
+		: file{std::move(file)}, bytes{nullptr}, onWrite{std::move(onWrite)} {
+		if (this->file == nullptr) {
+			throw std::invalid_argument("MappedROM needs a file");
+		}
+		bytes = this->file->data();
+	}
+
+	MappedROM::MappedROM(const std::string& path, ROMWriteHandler onWrite)
+		: MappedROM(MappedFile::open(path), std::move(onWrite)) {
+	}
+
+	void MappedROM::setWriteHandler(ROMWriteHandler onWrite) {
+		this->onWrite = std::move(onWrite);
+	}
+
+}
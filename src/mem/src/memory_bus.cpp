@@ -0,0 +1,119 @@
+#include "memory_bus.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace jagce {
+
+	MemoryBus::MemoryBus() : readPages{}, writePages{}, handlers{}, scratch{} {
+	}
+
+	uint8_t const * MemoryBus::readBytes(size_t index, size_t num) const {
+		if (num == 0) {
+			return nullptr;
+		}
+		if (index + num > size()) {
+			throw std::out_of_range("Attempted read of " + std::to_string(num) + " bytes at " + std::to_string(index)
+					+ " past the end of the bus");
+		}
+
+		const size_t first = index >> PAGE_BITS;
+		const size_t last = (index + num - 1) >> PAGE_BITS;
+		uint8_t const * base = readPages[first];
+
+		bool contiguous = base != nullptr;
+		for (size_t page = first + 1; contiguous && page <= last; page++) {
+			contiguous = reinterpret_cast<uintptr_t>(readPages[page])
+				== reinterpret_cast<uintptr_t>(base) + (page - first) * PAGE_SIZE;
+		}
+		if (contiguous) {
+			return base + (index & (PAGE_SIZE - 1));
+		}
+
+		scratch.resize(num);
+		for (size_t i = 0; i < num; i++) {
+			scratch[i] = read(static_cast<uint16_t>(index + i));
+		}
+		return scratch.data();
+	}
+
+	void MemoryBus::writeBytes(size_t index, uint8_t const * bytes, size_t num) {
+		if (index + num > size()) {
+			throw std::out_of_range("Attempted write of " + std::to_string(num) + " bytes at " + std::to_string(index)
+					+ " past the end of the bus");
+		}
+
+		while (num > 0) {
+			const size_t offset = index & (PAGE_SIZE - 1);
+			const size_t run = std::min(num, PAGE_SIZE - offset);
+			uint8_t* page = writePages[index >> PAGE_BITS];
+			if (page != nullptr) {
+				memmove(page + offset, bytes, run);
+			} else {
+				for (size_t i = 0; i < run; i++) {
+					writeUnmapped(static_cast<uint16_t>(index + i), bytes[i]);
+				}
+			}
+			index += run;
+			bytes += run;
+			num -= run;
+		}
+	}
+
+	void MemoryBus::mapRead(size_t address, size_t size, uint8_t const * bytes) {
+		const size_t first = firstPage(address, size);
+		for (size_t i = 0; i < size / PAGE_SIZE; i++) {
+			readPages[first + i] = bytes == nullptr ? nullptr : bytes + i * PAGE_SIZE;
+		}
+	}
+
+	void MemoryBus::mapWrite(size_t address, size_t size, uint8_t* bytes) {
+		const size_t first = firstPage(address, size);
+		for (size_t i = 0; i < size / PAGE_SIZE; i++) {
+			writePages[first + i] = bytes == nullptr ? nullptr : bytes + i * PAGE_SIZE;
+		}
+	}
+
+	void MemoryBus::map(size_t address, size_t size, uint8_t* bytes) {
+		mapRead(address, size, bytes);
+		mapWrite(address, size, bytes);
+	}
+
+	void MemoryBus::mapHandler(size_t address, size_t size, MemoryHandler* handler) {
+		const size_t first = firstPage(address, size);
+		for (size_t i = 0; i < size / PAGE_SIZE; i++) {
+			handlers[first + i] = handler;
+		}
+	}
+
+	void MemoryBus::unmap(size_t address, size_t size) {
+		map(address, size, nullptr);
+		mapHandler(address, size, nullptr);
+	}
+
+	uint8_t MemoryBus::readUnmapped(uint16_t address) const {
+		MemoryHandler* handler = handlers[address >> PAGE_BITS];
+		return handler != nullptr ? handler->read(address) : 0xFF;
+	}
+
+	void MemoryBus::writeUnmapped(uint16_t address, uint8_t value) {
+		MemoryHandler* handler = handlers[address >> PAGE_BITS];
+		if (handler != nullptr) {
+			handler->write(address, value);
+		}
+	}
+
+	size_t MemoryBus::firstPage(size_t address, size_t size) {
+		if (address % PAGE_SIZE != 0 || size % PAGE_SIZE != 0) {
+			throw std::invalid_argument("Bus mappings must be whole pages");
+		}
+		if (address + size > PAGE_COUNT * PAGE_SIZE) {
+			throw std::out_of_range("Bus mapping ends past the 16-bit address space");
+		}
+		return address / PAGE_SIZE;
+	}
+
+}
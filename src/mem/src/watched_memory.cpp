@@ -0,0 +1,38 @@
+#include "watched_memory.hpp"
+
+namespace jagce {
+
+	WatchedMemory::WatchedMemory(RandomAccessMemory& memory)
+		: memory{memory}, observer{nullptr}, watched((memory.size() + PAGE_SIZE - 1) / PAGE_SIZE, false) {}
+
+	void WatchedMemory::writeBytes(size_t index, uint8_t const * bytes, size_t num) {
+		memory.writeBytes(index, bytes, num);
+		if (observer == nullptr || num == 0) {
+			return;
+		}
+
+		for (size_t page = index / PAGE_SIZE; page <= (index + num - 1) / PAGE_SIZE; page++) {
+			if (watched[page]) {
+				observer->memoryWritten(index, num);
+				return;
+			}
+		}
+	}
+
+	void WatchedMemory::setObserver(MemoryWriteObserver* observer) {
+		this->observer = observer;
+	}
+
+	void WatchedMemory::watchPage(size_t page) {
+		watched.at(page) = true;
+	}
+
+	void WatchedMemory::unwatchPage(size_t page) {
+		watched.at(page) = false;
+	}
+
+	bool WatchedMemory::isPageWatched(size_t page) const {
+		return watched.at(page);
+	}
+
+}
@@ -0,0 +1,88 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include "mapped_rom.hpp"
+
+namespace {
+
+	// A ROM image written to a temporary file for the life of the test
+	struct TemporaryROM {
+		std::string path;
+
+		TemporaryROM(const std::vector<uint8_t>& bytes) {
+			char name[] = "/tmp/jagce_rom_XXXXXX";
+			const int fd = mkstemp(name);
+			REQUIRE(fd >= 0);
+			REQUIRE(write(fd, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size()));
+			close(fd);
+			path = name;
+		}
+
+		~TemporaryROM() {
+			std::remove(path.c_str());
+		}
+	};
+
+}
+
+TEST_CASE("mapped rom reads the file it maps", "[mapped_rom]") {
+	const TemporaryROM file{{ 0x00, 0xC3, 0x50, 0x01, 0xCE, 0xED }};
+	jagce::MappedROM rom{file.path};
+
+	REQUIRE(rom.size() == 6);
+	CHECK(rom.readByte(1) == 0xC3);
+	CHECK(*rom.readBytesAsType<uint16_t>(2) == 0x0150);
+	CHECK(rom.readBytes(4, 2) == rom.getFile()->data() + 4);
+}
+
+TEST_CASE("mapped roms of the same file share one mapping", "[mapped_rom]") {
+	const TemporaryROM file{{ 0x01, 0x02, 0x03, 0x04 }};
+	jagce::MappedROM first{file.path};
+	jagce::MappedROM second{jagce::MappedFile::open(file.path)};
+
+	CHECK(first.getFile() == second.getFile());
+	CHECK(first.readBytes(0, 4) == second.readBytes(0, 4));
+}
+
+TEST_CASE("mapped rom passes writes to its handler", "[mapped_rom]") {
+	const TemporaryROM file{{ 0x11, 0x22, 0x33, 0x44 }};
+
+	SECTION("writes are ignored by default") {
+		jagce::MappedROM rom{file.path};
+		rom.writeByte(0, 0xFF);
+		CHECK(rom.readByte(0) == 0x11);
+	}
+
+	SECTION("faulting writes throw") {
+		jagce::MappedROM rom{file.path, jagce::faultROMWrite};
+		CHECK_THROWS_AS(rom.writeByte(0, 0xFF), std::logic_error);
+		const std::array<uint8_t, 2> bytes{ 0xAA, 0xBB };
+		CHECK_THROWS_AS(rom.writeBytes(1, bytes.data(), bytes.size()), std::logic_error);
+	}
+
+	SECTION("custom handlers see every write") {
+		std::vector<std::pair<size_t, uint8_t>> writes{};
+		jagce::MappedROM rom{file.path, [&writes](size_t index, uint8_t const * bytes, size_t num) {
+			for (size_t i = 0; i < num; i++) {
+				writes.emplace_back(index + i, bytes[i]);
+			}
+		}};
+
+		rom.writeByte(0x2, 0x0A);
+		REQUIRE(writes.size() == 1);
+		CHECK(writes.at(0) == std::make_pair(size_t{2}, uint8_t{0x0A}));
+		CHECK(rom.readByte(2) == 0x33);
+	}
+}
+
+TEST_CASE("mapping a missing file throws", "[mapped_rom]") {
+	CHECK_THROWS_AS(jagce::MappedFile::open("/nonexistent/jagce.gb"), std::system_error);
+}
@@ -0,0 +1,183 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "bank_controller.hpp"
+#include "memory_bus.hpp"
+#include "static_ram.hpp"
+
+namespace {
+
+	struct RecordingHandler : public jagce::MemoryHandler {
+		std::vector<std::pair<uint16_t, uint8_t>> writes;
+
+		uint8_t read(uint16_t address) override {
+			return static_cast<uint8_t>(address);
+		}
+
+		void write(uint16_t address, uint8_t value) override {
+			writes.emplace_back(address, value);
+		}
+	};
+
+	// A ROM with its bank number in the first byte of each bank
+	template <size_t BANKS>
+	std::unique_ptr<jagce::StaticRAM<BANKS * jagce::ROM_BANK_SIZE>> makeROM() {
+		auto rom = std::make_unique<jagce::StaticRAM<BANKS * jagce::ROM_BANK_SIZE>>();
+		for (size_t bank = 0; bank < BANKS; bank++) {
+			rom->writeByte(bank * jagce::ROM_BANK_SIZE, static_cast<uint8_t>(bank));
+		}
+		return rom;
+	}
+
+}
+
+TEST_CASE("memory bus maps pages to host memory and handlers", "[memory_bus]") {
+	jagce::MemoryBus bus{};
+	std::array<uint8_t, 0x200> wram{};
+	RecordingHandler io{};
+	bus.map(0xC000, wram.size(), wram.data());
+	bus.mapHandler(0xFF00, 0x100, &io);
+
+	SECTION("mapped pages read and write host memory") {
+		bus.write(0xC1FF, 0x42);
+		CHECK(wram.at(0x1FF) == 0x42);
+		CHECK(bus.readByte(0xC1FF) == 0x42);
+	}
+
+	SECTION("handler pages call the handler") {
+		bus.writeByte(0xFF40, 0x91);
+		REQUIRE(io.writes.size() == 1);
+		CHECK(io.writes.at(0) == std::make_pair(uint16_t{0xFF40}, uint8_t{0x91}));
+		CHECK(bus.read(0xFF44) == 0x44);
+	}
+
+	SECTION("unmapped pages read open bus and drop writes") {
+		bus.write(0x8000, 0x12);
+		CHECK(bus.read(0x8000) == 0xFF);
+	}
+
+	SECTION("read-only pages send writes to the handler") {
+		bus.mapRead(0xC000, 0x100, wram.data());
+		bus.mapWrite(0xC000, 0x100, nullptr);
+		bus.mapHandler(0xC000, 0x100, &io);
+		bus.write(0xC000, 0x01);
+		CHECK(wram.at(0) == 0x00);
+		CHECK(io.writes.size() == 1);
+	}
+
+	SECTION("contiguous reads point into host memory") {
+		CHECK(bus.readBytes(0xC0F0, 0x20) == wram.data() + 0xF0);
+	}
+
+	SECTION("reads crossing into other memory are copied") {
+		wram.at(0x1FF) = 0xAB;
+		uint8_t const * bytes = bus.readBytes(0xC1FF, 2);
+		CHECK(bytes[0] == 0xAB);
+		CHECK(bytes[1] == 0xFF);
+	}
+
+	SECTION("writes are split at page boundaries") {
+		const std::array<uint8_t, 3> bytes{ 1, 2, 3 };
+		bus.writeBytes(0xC1FE, bytes.data(), bytes.size());
+		CHECK(wram.at(0x1FE) == 1);
+		CHECK(wram.at(0x1FF) == 2);
+	}
+
+	SECTION("mappings must be whole pages") {
+		CHECK_THROWS_AS(bus.map(0xC080, 0x100, wram.data()), std::invalid_argument);
+	}
+}
+
+TEST_CASE("bank controllers switch banks by remapping the bus", "[memory_bus], [bank_controller]") {
+	jagce::MemoryBus bus{};
+	auto rom = makeROM<128>();
+
+	SECTION("MBC1") {
+		jagce::BankController mbc{bus, *rom, jagce::MBCType::MBC1, 0x8000};
+		CHECK(bus.read(0x4000) == 1);
+
+		bus.write(0x2000, 0x05);
+		CHECK(bus.read(0x4000) == 5);
+		CHECK(bus.readBytes(0x4000, 0x4000) == rom->readBytes(5 * jagce::ROM_BANK_SIZE, 0x4000));
+
+		// Bank 0 selects bank 1, also with the upper bits set
+		bus.write(0x2000, 0x00);
+		bus.write(0x4000, 0x01);
+		CHECK(bus.read(0x4000) == 0x21);
+
+		// RAM banking mode also moves the first bank and selects RAM banks
+		bus.write(0x6000, 0x01);
+		CHECK(bus.read(0x0000) == 0x20);
+		CHECK(mbc.getRAMBank() == 1);
+
+		CHECK(bus.read(0xA000) == 0xFF);
+		bus.write(0x0000, 0x0A);
+		bus.write(0xA000, 0x77);
+		CHECK(mbc.getRAM().at(jagce::RAM_BANK_SIZE) == 0x77);
+
+		bus.write(0x0000, 0x00);
+		CHECK(bus.read(0xA000) == 0xFF);
+	}
+
+	SECTION("MBC3") {
+		jagce::BankController mbc{bus, *rom, jagce::MBCType::MBC3, 0x8000};
+		bus.write(0x2000, 0x7F);
+		CHECK(bus.read(0x4000) == 0x7F);
+
+		bus.write(0x0000, 0x0A);
+		bus.write(0x4000, 0x03);
+		bus.write(0xA000, 0x33);
+		CHECK(mbc.getRAM().at(3 * jagce::RAM_BANK_SIZE) == 0x33);
+
+		// Clock registers are selected through the RAM bank register
+		bus.write(0x4000, 0x08);
+		bus.write(0xA000, 0x2A);
+		CHECK(bus.read(0xA000) == 0x2A);
+		CHECK(mbc.getRAM().at(0) == 0x00);
+	}
+
+	SECTION("MBC5") {
+		auto large = makeROM<512>();
+		jagce::BankController mbc{bus, *large, jagce::MBCType::MBC5, 0x20000};
+
+		// Bank 0 can be selected in the switchable region
+		bus.write(0x2000, 0x00);
+		CHECK(bus.read(0x4000) == 0);
+
+		bus.write(0x2000, 0x02);
+		bus.write(0x3000, 0x01);
+		CHECK(mbc.getROMBank() == 0x102);
+		CHECK(bus.read(0x4000) == 0x02);
+
+		bus.write(0x0000, 0x0A);
+		bus.write(0x4000, 0x0F);
+		bus.write(0xBFFF, 0x55);
+		CHECK(mbc.getRAM().back() == 0x55);
+	}
+
+	SECTION("bank numbers wrap at the ROM size") {
+		auto small = makeROM<4>();
+		jagce::BankController mbc{bus, *small, jagce::MBCType::MBC1, 0};
+		bus.write(0x2000, 0x06);
+		CHECK(bus.read(0x4000) == 2);
+	}
+
+	SECTION("controllers unmap the cartridge when destroyed") {
+		{
+			jagce::BankController mbc{bus, *rom, jagce::MBCType::NONE, 0};
+			CHECK(bus.read(0x4000) == 1);
+		}
+		CHECK(bus.read(0x4000) == 0xFF);
+	}
+}
+
+TEST_CASE("cartridge headers name the controller and RAM size", "[bank_controller]") {
+	CHECK(jagce::mbcTypeFromHeader(0x00) == jagce::MBCType::NONE);
+	CHECK(jagce::mbcTypeFromHeader(0x03) == jagce::MBCType::MBC1);
+	CHECK(jagce::mbcTypeFromHeader(0x13) == jagce::MBCType::MBC3);
+	CHECK(jagce::mbcTypeFromHeader(0x1B) == jagce::MBCType::MBC5);
+	CHECK(jagce::ramSizeFromHeader(0x03) == 0x8000);
+}
@@ -1,6 +1,7 @@
 #include <catch2/catch.hpp>
 
 #include <cstring>
+#include <vector>
 
 #include "static_ram.hpp"
 
@@ -16,6 +17,10 @@ TEST_CASE("static ram methods work", "[static_ram]") {
 		REQUIRE(sram.size() == SIZE);
 	}
 
+	SECTION("static ram without dirty pages holds nothing but its array") {
+		static_assert(sizeof(jagce::StaticRAM<64>) == sizeof(jagce::RandomAccessMemory) + 64);
+	}
+
 	SECTION("static ram is zero initialized") {
 		uint8_t const * end = sram.readBytes(sram.size() - 1, 1) + 1;
 		for (uint8_t const * p = sram.readBytes(0, sram.size()); p != end; p++) {
@@ -48,3 +53,47 @@ TEST_CASE("static ram methods work", "[static_ram]") {
 		}
 	}
 }
+
+TEST_CASE("static ram tracks dirty pages", "[static_ram]") {
+	jagce::StaticRAM<0x2080, 0x100> sram{};
+	REQUIRE(sram.PAGE_COUNT == 0x21);
+	REQUIRE(sram.dirtyPageCount() == 0);
+
+	SECTION("byte writes mark their page") {
+		sram.writeByte(0x1FF, 0x01);
+		CHECK(sram.isPageDirty(1));
+		CHECK(sram.dirtyPageCount() == 1);
+	}
+
+	SECTION("writes spanning pages mark every page") {
+		const uint8_t bytes[0x102]{};
+		sram.writeBytes(0x0FF, bytes, sizeof(bytes));
+		CHECK(sram.isPageDirty(0));
+		CHECK(sram.isPageDirty(1));
+		CHECK(sram.isPageDirty(2));
+		CHECK(sram.dirtyPageCount() == 3);
+	}
+
+	SECTION("clearing starts a new checkpoint") {
+		sram.writeByte(0x10, 0x01);
+		sram.clearDirtyPages();
+		CHECK(sram.dirtyPageCount() == 0);
+		sram.writeByte(0x2000, 0x02);
+		CHECK(sram.dirtyPages().test(0x20));
+	}
+
+	SECTION("dirty pages are visited in order with their contents") {
+		sram.writeByte(0x2005, 0xAB);
+		sram.writeByte(0x0300, 0xCD);
+
+		std::vector<std::pair<size_t, size_t>> pages{};
+		sram.forEachDirtyPage([&pages](size_t index, uint8_t const * bytes, size_t num) {
+			pages.emplace_back(index, num);
+			CHECK(bytes[index == 0x300 ? 0 : 5] == (index == 0x300 ? 0xCD : 0xAB));
+		});
+
+		REQUIRE(pages.size() == 2);
+		CHECK(pages.at(0) == std::make_pair(size_t{0x300}, size_t{0x100}));
+		CHECK(pages.at(1) == std::make_pair(size_t{0x2000}, size_t{0x80}));
+	}
+}
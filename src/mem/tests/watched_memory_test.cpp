@@ -0,0 +1,58 @@
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include "static_ram.hpp"
+#include "watched_memory.hpp"
+
+namespace {
+
+	struct RecordingObserver : public jagce::MemoryWriteObserver {
+		std::vector<std::pair<size_t, size_t>> writes;
+
+		void memoryWritten(size_t index, size_t num) override {
+			writes.emplace_back(index, num);
+		}
+	};
+
+}
+
+TEST_CASE("watched memory notifies writes to watched pages", "[watched_memory]") {
+	jagce::StaticRAM<0x400> ram{};
+	jagce::WatchedMemory memory{ram};
+	RecordingObserver observer{};
+	memory.setObserver(&observer);
+	memory.watchPage(1);
+
+	SECTION("writes are forwarded") {
+		memory.writeByte(0x10, 0xAB);
+		REQUIRE(ram.readByte(0x10) == 0xAB);
+		REQUIRE(memory.readByte(0x10) == 0xAB);
+		REQUIRE(memory.size() == ram.size());
+	}
+
+	SECTION("only writes to watched pages are observed") {
+		memory.writeByte(0x0FF, 0x01);
+		memory.writeByte(0x100, 0x02);
+		memory.writeByte(0x200, 0x03);
+
+		REQUIRE(observer.writes.size() == 1);
+		CHECK(observer.writes.at(0) == std::make_pair<size_t, size_t>(0x100, 1));
+	}
+
+	SECTION("bulk writes spanning a watched page are observed") {
+		const uint8_t bytes[4]{ 1, 2, 3, 4 };
+		memory.writeBytes(0x0FE, bytes, sizeof(bytes));
+		memory.writeBytes(0x2FE, bytes, sizeof(bytes));
+
+		REQUIRE(observer.writes.size() == 1);
+		CHECK(observer.writes.at(0) == std::make_pair<size_t, size_t>(0x0FE, 4));
+	}
+
+	SECTION("unwatched pages are no longer observed") {
+		memory.unwatchPage(1);
+		memory.writeByte(0x100, 0x02);
+
+		CHECK(observer.writes.empty());
+	}
+}